@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "cpu.h"
+#include "macros.h"
+#include "numa.h"
+
+/*
+ * Chunk header, stored at the beginning of its mapping.
+ *
+ * Chunks are linked from the most recent to the oldest.
+ */
+struct arena_chunk {
+    struct arena_chunk *prev;
+    size_t size;
+};
+
+static void *
+arena_map(size_t size, int flags)
+{
+    void *addr;
+
+    if (flags & ARENA_HUGE_PAGES) {
+#ifdef MAP_HUGETLB
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (addr != MAP_FAILED) {
+            return addr;
+        }
+#endif /* MAP_HUGETLB */
+    }
+
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (flags & ARENA_HUGE_PAGES) {
+        /* This is only a hint, ignore errors */
+        madvise(addr, size, MADV_HUGEPAGE);
+    }
+#endif /* MADV_HUGEPAGE */
+
+    return addr;
+}
+
+/*
+ * Apply the NUMA policy of an arena to a new chunk, before the chunk
+ * header faults in its first page.
+ *
+ * Placement is best effort, ignore errors. It's skipped on single-node
+ * machines, where it can't make a difference.
+ */
+static void
+arena_bind(void *addr, size_t size, int flags)
+{
+    if (cpu_nr_nodes() <= 1) {
+        return;
+    }
+
+    if (flags & ARENA_NUMA_LOCAL) {
+        numa_bind(addr, size, NUMA_POLICY_LOCAL);
+    } else if (flags & ARENA_NUMA_INTERLEAVE) {
+        numa_bind(addr, size, NUMA_POLICY_INTERLEAVE);
+    }
+}
+
+static char *
+arena_chunk_start(struct arena_chunk *chunk)
+{
+    return (char *)(chunk + 1);
+}
+
+static char *
+arena_chunk_end(struct arena_chunk *chunk)
+{
+    return (char *)chunk + chunk->size;
+}
+
+static void
+arena_chunk_destroy(struct arena_chunk *chunk)
+{
+    munmap(chunk, chunk->size);
+}
+
+void
+arena_init(struct arena *arena, size_t chunk_size, int flags)
+{
+    assert((flags & ~(ARENA_HUGE_PAGES | ARENA_NUMA_LOCAL
+                      | ARENA_NUMA_INTERLEAVE)) == 0);
+    assert(!((flags & ARENA_NUMA_LOCAL) && (flags & ARENA_NUMA_INTERLEAVE)));
+
+    if (chunk_size == 0) {
+        chunk_size = ARENA_CHUNK_SIZE;
+    }
+
+    arena->ptr = NULL;
+    arena->end = NULL;
+    arena->chunk = NULL;
+    arena->chunk_size = chunk_size;
+    arena->flags = flags;
+}
+
+void
+arena_destroy(struct arena *arena)
+{
+    struct arena_chunk *chunk, *prev;
+
+    chunk = arena->chunk;
+
+    while (chunk != NULL) {
+        prev = chunk->prev;
+        arena_chunk_destroy(chunk);
+        chunk = prev;
+    }
+
+    arena_init(arena, arena->chunk_size, arena->flags);
+}
+
+void *
+arena_alloc_slow(struct arena *arena, size_t size, size_t align)
+{
+    struct arena_chunk *chunk;
+    size_t chunk_size, page_size;
+    uintptr_t ptr;
+
+    /*
+     * Requests larger than a regular chunk get a chunk of their own. The
+     * remaining memory of the previous chunk is lost.
+     */
+    chunk_size = sizeof(*chunk) + align - 1 + size;
+
+    if (chunk_size < size) {
+        return NULL;
+    }
+
+    chunk_size = MAX(chunk_size, arena->chunk_size);
+
+    if (arena->flags & ARENA_HUGE_PAGES) {
+        page_size = ARENA_HUGE_PAGE_SIZE;
+    } else {
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+
+    chunk_size = P2ROUND(chunk_size, page_size);
+    chunk = arena_map(chunk_size, arena->flags);
+
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    arena_bind(chunk, chunk_size, arena->flags);
+
+    chunk->prev = arena->chunk;
+    chunk->size = chunk_size;
+    arena->chunk = chunk;
+
+    ptr = P2ROUND((uintptr_t)arena_chunk_start(chunk), align);
+    arena->ptr = (char *)ptr + size;
+    arena->end = arena_chunk_end(chunk);
+    return (void *)ptr;
+}
+
+void
+arena_rewind(struct arena *arena, const struct arena_mark *mark)
+{
+    struct arena_chunk *chunk, *prev;
+
+    chunk = arena->chunk;
+
+    while (chunk != mark->chunk) {
+        assert(chunk != NULL);
+
+        /* Keep the first chunk when rewinding to the initial position */
+        if ((mark->chunk == NULL) && (chunk->prev == NULL)) {
+            arena->chunk = chunk;
+            arena->ptr = arena_chunk_start(chunk);
+            arena->end = arena_chunk_end(chunk);
+            return;
+        }
+
+        prev = chunk->prev;
+        arena_chunk_destroy(chunk);
+        chunk = prev;
+    }
+
+    arena->chunk = chunk;
+    arena->ptr = mark->ptr;
+    arena->end = (chunk == NULL) ? NULL : arena_chunk_end(chunk);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Arena allocator.
+ *
+ * An arena allocates memory by bumping a pointer inside large chunks,
+ * and releases it all at once, either entirely, or back to a previously
+ * saved position. Individual allocations can't be released. This makes
+ * allocation very cheap, and the teardown of data structures built from
+ * an arena independent of the number of their nodes.
+ *
+ * Positions are saved with arena_save(), and restored with arena_rewind().
+ * Saved positions may be nested, in which case rewinding to a position
+ * invalidates all the positions saved after it.
+ *
+ * Chunks are mapped directly from the kernel. When huge pages are requested,
+ * chunks are backed by explicitly reserved huge pages if possible, and by
+ * transparent huge pages otherwise. Chunks may also be given a NUMA
+ * placement policy, so that e.g. trees allocated from an arena are placed
+ * on the node of the thread building them. The first chunk is kept across
+ * rewinds so that an arena repeatedly filled and reset doesn't map memory
+ * again.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "macros.h"
+
+/*
+ * Default size of chunks.
+ */
+#define ARENA_CHUNK_SIZE (1UL << 20)
+
+/*
+ * Size of huge pages, to which chunk sizes are rounded if huge pages
+ * are requested.
+ */
+#define ARENA_HUGE_PAGE_SIZE (1UL << 21)
+
+/*
+ * Arena initialization flags.
+ */
+#define ARENA_HUGE_PAGES        0x1 /* Back chunks with huge pages */
+#define ARENA_NUMA_LOCAL        0x2 /* Place chunks on the local node */
+#define ARENA_NUMA_INTERLEAVE   0x4 /* Interleave chunks over all nodes */
+
+/*
+ * Arena chunk.
+ */
+struct arena_chunk;
+
+/*
+ * Arena.
+ *
+ * The ptr and end members delimit the free memory of the current chunk.
+ */
+struct arena {
+    char *ptr;
+    char *end;
+    struct arena_chunk *chunk;
+    size_t chunk_size;
+    int flags;
+};
+
+/*
+ * Saved position in an arena.
+ */
+struct arena_mark {
+    struct arena_chunk *chunk;
+    char *ptr;
+};
+
+/*
+ * Initialize an arena.
+ *
+ * If chunk_size is 0, ARENA_CHUNK_SIZE is used. No memory is allocated
+ * until the first allocation.
+ */
+void arena_init(struct arena *arena, size_t chunk_size, int flags);
+
+/*
+ * Release all the memory of an arena.
+ */
+void arena_destroy(struct arena *arena);
+
+void * arena_alloc_slow(struct arena *arena, size_t size, size_t align);
+
+/*
+ * Allocate memory from an arena.
+ *
+ * The alignment must be a power of two, or 0, in which case memory is
+ * aligned as required for any standard type. The size must not be 0.
+ *
+ * If memory can't be allocated, NULL is returned.
+ */
+static inline void *
+arena_alloc(struct arena *arena, size_t size, size_t align)
+{
+    uintptr_t ptr;
+
+    assert(size != 0);
+
+    if (align == 0) {
+        align = _Alignof(max_align_t);
+    }
+
+    assert(ISP2(align));
+
+    ptr = P2ROUND((uintptr_t)arena->ptr, align);
+
+    if (unlikely((ptr > (uintptr_t)arena->end)
+                 || (size > ((uintptr_t)arena->end - ptr)))) {
+        return arena_alloc_slow(arena, size, align);
+    }
+
+    arena->ptr = (char *)ptr + size;
+    return (void *)ptr;
+}
+
+/*
+ * Save the current position of an arena.
+ */
+static inline void
+arena_save(const struct arena *arena, struct arena_mark *mark)
+{
+    mark->chunk = arena->chunk;
+    mark->ptr = arena->ptr;
+}
+
+/*
+ * Release all memory allocated since the given position was saved.
+ *
+ * Positions saved after the given one become invalid.
+ */
+void arena_rewind(struct arena *arena, const struct arena_mark *mark);
+
+/*
+ * Release all memory allocated from an arena.
+ *
+ * The first chunk is kept for future allocations.
+ */
+static inline void
+arena_reset(struct arena *arena)
+{
+    struct arena_mark mark = { NULL, NULL };
+
+    arena_rewind(arena, &mark);
+}
+
+#endif /* ARENA_H */
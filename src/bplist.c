@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "bitmap.h"
+#include "bplist.h"
+#include "list.h"
+
+void
+bplist_init(struct bplist *bplist, struct list *buckets,
+            unsigned int nr_priorities)
+{
+    unsigned int i;
+
+    assert(nr_priorities != 0);
+    assert(nr_priorities <= BPLIST_MAX_PRIORITIES);
+
+    for (i = 0; i < nr_priorities; i++) {
+        list_init(&buckets[i]);
+    }
+
+    bplist->buckets = buckets;
+    bplist->nr_priorities = nr_priorities;
+    bplist->summary = 0;
+    bitmap_zero(bplist->map, BPLIST_MAX_PRIORITIES);
+}
+
+/*
+ * Return the lowest priority greater than or equal to the given one with
+ * a non-empty bucket, or -1 if there is none.
+ */
+static int
+bplist_find_next(const struct bplist *bplist, unsigned int priority)
+{
+    unsigned long word, summary;
+    unsigned int i;
+
+    if (priority >= bplist->nr_priorities) {
+        return -1;
+    }
+
+    i = priority / LONG_BIT;
+    word = bplist->map[i] & ~(bitmap_mask(priority % LONG_BIT) - 1);
+
+    if (word == 0) {
+        /* Exclude word i and lower */
+        summary = bplist->summary & ~((bitmap_mask(i) << 1) - 1);
+
+        if (summary == 0) {
+            return -1;
+        }
+
+        i = __builtin_ctzl(summary);
+        word = bplist->map[i];
+    }
+
+    return (i * LONG_BIT) + __builtin_ctzl(word);
+}
+
+/*
+ * Return the highest priority less than or equal to the given one with
+ * a non-empty bucket, or -1 if there is none.
+ */
+static int
+bplist_find_prev(const struct bplist *bplist, unsigned int priority)
+{
+    unsigned long word, summary;
+    unsigned int i;
+
+    i = priority / LONG_BIT;
+    word = bplist->map[i] & ((bitmap_mask(priority % LONG_BIT) << 1) - 1);
+
+    if (word == 0) {
+        /* Exclude word i and higher */
+        summary = bplist->summary & (bitmap_mask(i) - 1);
+
+        if (summary == 0) {
+            return -1;
+        }
+
+        i = LONG_BIT - 1 - __builtin_clzl(summary);
+        word = bplist->map[i];
+    }
+
+    return (i * LONG_BIT) + (LONG_BIT - 1 - __builtin_clzl(word));
+}
+
+struct bplist_node *
+bplist_last(const struct bplist *bplist)
+{
+    int priority;
+
+    priority = bplist_find_prev(bplist, bplist->nr_priorities - 1);
+
+    if (priority == -1) {
+        return NULL;
+    }
+
+    return list_last_entry(&bplist->buckets[priority],
+                           struct bplist_node, node);
+}
+
+struct bplist_node *
+bplist_next(const struct bplist *bplist, const struct bplist_node *pnode)
+{
+    const struct list *bucket;
+    int priority;
+
+    bucket = &bplist->buckets[pnode->priority];
+
+    if (!list_end(bucket, list_next(&pnode->node))) {
+        return (struct bplist_node *)list_next_entry(pnode, node);
+    }
+
+    priority = bplist_find_next(bplist, pnode->priority + 1);
+
+    if (priority == -1) {
+        return NULL;
+    }
+
+    return list_first_entry(&bplist->buckets[priority],
+                            struct bplist_node, node);
+}
+
+struct bplist_node *
+bplist_prev(const struct bplist *bplist, const struct bplist_node *pnode)
+{
+    const struct list *bucket;
+    int priority;
+
+    bucket = &bplist->buckets[pnode->priority];
+
+    if (!list_end(bucket, list_prev(&pnode->node))) {
+        return (struct bplist_node *)list_prev_entry(pnode, node);
+    }
+
+    if (pnode->priority == 0) {
+        return NULL;
+    }
+
+    priority = bplist_find_prev(bplist, pnode->priority - 1);
+
+    if (priority == -1) {
+        return NULL;
+    }
+
+    return list_last_entry(&bplist->buckets[priority],
+                           struct bplist_node, node);
+}
+
+void
+bplist_add(struct bplist *bplist, struct bplist_node *pnode)
+{
+    struct list *bucket;
+
+    assert(pnode->priority < bplist->nr_priorities);
+
+    bucket = &bplist->buckets[pnode->priority];
+
+    if (list_empty(bucket)) {
+        bitmap_set(bplist->map, pnode->priority);
+        bitmap_set(&bplist->summary, pnode->priority / LONG_BIT);
+    }
+
+    list_insert_tail(bucket, &pnode->node);
+}
+
+void
+bplist_remove(struct bplist *bplist, struct bplist_node *pnode)
+{
+    struct list *bucket;
+    unsigned int i;
+
+    bucket = &bplist->buckets[pnode->priority];
+    list_remove(&pnode->node);
+
+    if (list_empty(bucket)) {
+        bitmap_clear(bplist->map, pnode->priority);
+        i = pnode->priority / LONG_BIT;
+
+        if (bplist->map[i] == 0) {
+            bitmap_clear(&bplist->summary, i);
+        }
+    }
+}
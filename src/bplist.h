@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Bucketed priority list.
+ *
+ * This container is a variant of the priority list for a bounded range of
+ * priorities. Entries are stored in one bucket per priority, and a two-level
+ * bitmap tracks non-empty buckets, so that insertion, removal and access to
+ * the first and last entries are O(1), at the cost of memory proportional
+ * to the number of priorities.
+ *
+ * Entries of the same priority are kept in insertion order.
+ */
+
+#ifndef BPLIST_H
+#define BPLIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bitmap.h"
+#include "list.h"
+#include "macros.h"
+
+/*
+ * Maximum number of priorities, i.e. the number of bits in the second level
+ * bitmap, each bit of the first level one covering a word of it.
+ */
+#define BPLIST_MAX_PRIORITIES (LONG_BIT * LONG_BIT)
+
+/*
+ * Bucketed priority list.
+ *
+ * The summary member is the first level bitmap, where a bit is set if
+ * the matching word of the map member contains at least one set bit.
+ */
+struct bplist {
+    struct list *buckets;
+    unsigned int nr_priorities;
+    unsigned long summary;
+    BITMAP_DECLARE(map, BPLIST_MAX_PRIORITIES);
+};
+
+/*
+ * Bucketed priority list node.
+ */
+struct bplist_node {
+    unsigned int priority;
+    struct list node;
+};
+
+/*
+ * Initialize a bucketed priority list.
+ *
+ * The buckets array must contain one entry per priority, and persist in
+ * memory as long as the list is used. Valid priorities range from 0 to
+ * nr_priorities - 1, which must not be greater than BPLIST_MAX_PRIORITIES.
+ */
+void bplist_init(struct bplist *bplist, struct list *buckets,
+                 unsigned int nr_priorities);
+
+/*
+ * Initialize a bucketed priority list node.
+ */
+static inline void
+bplist_node_init(struct bplist_node *pnode, unsigned int priority)
+{
+    pnode->priority = priority;
+    list_node_init(&pnode->node);
+}
+
+/*
+ * Return the priority associated with a node.
+ */
+static inline unsigned int
+bplist_node_priority(const struct bplist_node *pnode)
+{
+    return pnode->priority;
+}
+
+/*
+ * Update the priority of a node.
+ *
+ * The node must not be in any list.
+ */
+static inline void
+bplist_node_set_priority(struct bplist_node *pnode, unsigned int priority)
+{
+    pnode->priority = priority;
+}
+
+/*
+ * Return true if pnode is in no bucketed priority lists.
+ */
+static inline bool
+bplist_node_unlinked(const struct bplist_node *pnode)
+{
+    return list_node_unlinked(&pnode->node);
+}
+
+/*
+ * Macro that evaluates to the address of the structure containing the
+ * given node based on the given type and member.
+ */
+#define bplist_entry(pnode, type, member) structof(pnode, type, member)
+
+/*
+ * Return true if bplist is empty.
+ */
+static inline bool
+bplist_empty(const struct bplist *bplist)
+{
+    return bplist->summary == 0;
+}
+
+/*
+ * Return the first node of a bucketed priority list.
+ *
+ * If the list is empty, NULL is returned.
+ */
+static inline struct bplist_node *
+bplist_first(const struct bplist *bplist)
+{
+    unsigned int i, priority;
+
+    if (bplist_empty(bplist)) {
+        return NULL;
+    }
+
+    i = __builtin_ctzl(bplist->summary);
+    priority = (i * LONG_BIT) + __builtin_ctzl(bplist->map[i]);
+    return list_first_entry(&bplist->buckets[priority],
+                            struct bplist_node, node);
+}
+
+/*
+ * Return the last node of a bucketed priority list.
+ *
+ * If the list is empty, NULL is returned.
+ */
+struct bplist_node * bplist_last(const struct bplist *bplist);
+
+/*
+ * Return the node next to/previous to the given node.
+ *
+ * If there is no such node, NULL is returned.
+ */
+struct bplist_node * bplist_next(const struct bplist *bplist,
+                                 const struct bplist_node *pnode);
+struct bplist_node * bplist_prev(const struct bplist *bplist,
+                                 const struct bplist_node *pnode);
+
+/*
+ * Add a node to a bucketed priority list.
+ *
+ * If the list already contains nodes with the same priority as the given
+ * node, it is inserted after them.
+ *
+ * The node must be initialized before calling this function.
+ */
+void bplist_add(struct bplist *bplist, struct bplist_node *pnode);
+
+/*
+ * Remove a node from a bucketed priority list.
+ *
+ * After completion, the node is stale.
+ */
+void bplist_remove(struct bplist *bplist, struct bplist_node *pnode);
+
+/*
+ * Forge a loop to process all nodes of a bucketed priority list.
+ *
+ * The node must not be altered during the loop.
+ */
+#define bplist_for_each(bplist, pnode)      \
+for (pnode = bplist_first(bplist);          \
+     pnode != NULL;                         \
+     pnode = bplist_next(bplist, pnode))
+
+/*
+ * Forge a loop to process all nodes of a bucketed priority list.
+ */
+#define bplist_for_each_safe(bplist, pnode, tmp)                            \
+for (pnode = bplist_first(bplist),                                          \
+     tmp = (pnode == NULL) ? NULL : bplist_next(bplist, pnode);             \
+     pnode != NULL;                                                         \
+     pnode = tmp,                                                           \
+     tmp = (pnode == NULL) ? NULL : bplist_next(bplist, pnode))
+
+#endif /* BPLIST_H */
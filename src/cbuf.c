@@ -31,6 +31,7 @@
 
 #include "cbuf.h"
 #include "macros.h"
+#include "numa.h"
 
 /* Negative close to 0 so that an overflow occurs early */
 #define CBUF_INIT_INDEX ((size_t)-500)
@@ -46,6 +47,27 @@ cbuf_init(struct cbuf *cbuf, void *buf, size_t capacity)
     cbuf->end = cbuf->start;
 }
 
+int
+cbuf_init_numa(struct cbuf *cbuf, size_t capacity, int policy)
+{
+    void *buf;
+
+    buf = numa_alloc(capacity, policy);
+
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+
+    cbuf_init(cbuf, buf, capacity);
+    return 0;
+}
+
+void
+cbuf_destroy_numa(struct cbuf *cbuf)
+{
+    numa_free(cbuf->buf, cbuf->capacity);
+}
+
 static size_t
 cbuf_index(const struct cbuf *cbuf, size_t abs_index)
 {
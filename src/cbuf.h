@@ -105,6 +105,23 @@ cbuf_range_valid(const struct cbuf *cbuf, size_t start, size_t end)
  */
 void cbuf_init(struct cbuf *cbuf, void *buf, size_t capacity);
 
+/*
+ * Initialize a circular buffer with its own storage.
+ *
+ * Storage is allocated with the given NUMA placement policy, see the numa
+ * module. Capacity must be a power-of-two. If memory can't be allocated,
+ * ENOMEM is returned.
+ *
+ * Such a buffer must be destroyed with cbuf_destroy_numa().
+ */
+int cbuf_init_numa(struct cbuf *cbuf, size_t capacity, int policy);
+
+/*
+ * Release the storage of a circular buffer initialized with
+ * cbuf_init_numa().
+ */
+void cbuf_destroy_numa(struct cbuf *cbuf);
+
 /*
  * Push data to a circular buffer.
  *
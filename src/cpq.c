@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpq.h"
+#include "macros.h"
+#include "percpu.h"
+#include "plist.h"
+
+static struct cpq_shard *
+cpq_get_shard(const struct cpq *cpq, unsigned int index)
+{
+    return percpu_area_ptr(&cpq->shards, index);
+}
+
+static unsigned int
+cpq_nr_shards(const struct cpq *cpq)
+{
+    return percpu_area_nr_cpus(&cpq->shards);
+}
+
+int
+cpq_init(struct cpq *cpq)
+{
+    struct cpq_shard *shard;
+    unsigned int i;
+    int error;
+
+    error = percpu_area_init(&cpq->shards, sizeof(*shard));
+
+    if (error) {
+        return error;
+    }
+
+    for (i = 0; i < cpq_nr_shards(cpq); i++) {
+        shard = cpq_get_shard(cpq, i);
+        pthread_mutex_init(&shard->lock, NULL);
+        plist_init(&shard->plist);
+        atomic_init(&shard->min, CPQ_EMPTY);
+    }
+
+    atomic_init(&cpq->hint, 0);
+    return 0;
+}
+
+void
+cpq_destroy(struct cpq *cpq)
+{
+    struct cpq_shard *shard;
+    unsigned int i;
+
+    for (i = 0; i < cpq_nr_shards(cpq); i++) {
+        shard = cpq_get_shard(cpq, i);
+        assert(plist_empty(&shard->plist));
+        pthread_mutex_destroy(&shard->lock);
+    }
+
+    percpu_area_destroy(&cpq->shards);
+}
+
+static unsigned int
+cpq_shard_get_min(const struct cpq_shard *shard)
+{
+    return atomic_load_explicit(&shard->min, memory_order_relaxed);
+}
+
+/*
+ * Publish the priority of the first node of a shard.
+ *
+ * The shard must be locked.
+ */
+static void
+cpq_shard_update_min(struct cpq_shard *shard)
+{
+    unsigned int min;
+
+    if (plist_empty(&shard->plist)) {
+        min = CPQ_EMPTY;
+    } else {
+        min = plist_node_priority(plist_first(&shard->plist));
+    }
+
+    atomic_store_explicit(&shard->min, min, memory_order_relaxed);
+}
+
+/*
+ * Return the index of the shard with the lowest first priority, or -1 if
+ * all shards are empty.
+ */
+static int
+cpq_find_min(const struct cpq *cpq)
+{
+    unsigned int i, min, shard_min;
+    int index;
+
+    index = -1;
+    min = CPQ_EMPTY;
+
+    for (i = 0; i < cpq_nr_shards(cpq); i++) {
+        shard_min = cpq_shard_get_min(cpq_get_shard(cpq, i));
+
+        if (shard_min < min) {
+            min = shard_min;
+            index = i;
+        }
+    }
+
+    return index;
+}
+
+void
+cpq_push(struct cpq *cpq, struct cpq_node *node)
+{
+    struct cpq_shard *shard;
+    unsigned int cpu, hint;
+
+    assert(cpq_node_priority(node) != CPQ_EMPTY);
+
+    cpu = percpu_area_local_cpu(&cpq->shards);
+    shard = cpq_get_shard(cpq, cpu);
+
+    pthread_mutex_lock(&shard->lock);
+    plist_add(&shard->plist, &node->plist_node);
+    cpq_shard_update_min(shard);
+    pthread_mutex_unlock(&shard->lock);
+
+    hint = atomic_load_explicit(&cpq->hint, memory_order_relaxed);
+
+    if (cpu != hint) {
+        shard = cpq_get_shard(cpq, hint);
+
+        if (cpq_node_priority(node) < cpq_shard_get_min(shard)) {
+            atomic_store_explicit(&cpq->hint, cpu, memory_order_relaxed);
+        }
+    }
+}
+
+struct cpq_node *
+cpq_pop(struct cpq *cpq)
+{
+    struct cpq_shard *shard, *local;
+    struct plist_node *pnode;
+    unsigned int hint;
+    int index;
+
+    for (;;) {
+        hint = atomic_load_explicit(&cpq->hint, memory_order_relaxed);
+        shard = cpq_get_shard(cpq, hint);
+        local = percpu_area_local_ptr(&cpq->shards);
+
+        if (cpq_shard_get_min(local) < cpq_shard_get_min(shard)) {
+            shard = local;
+        }
+
+        if (cpq_shard_get_min(shard) == CPQ_EMPTY) {
+            index = cpq_find_min(cpq);
+
+            if (index == -1) {
+                return NULL;
+            }
+
+            atomic_store_explicit(&cpq->hint, index, memory_order_relaxed);
+            continue;
+        }
+
+        pthread_mutex_lock(&shard->lock);
+
+        if (plist_empty(&shard->plist)) {
+            /* Raced with another thread */
+            pthread_mutex_unlock(&shard->lock);
+            continue;
+        }
+
+        pnode = plist_first(&shard->plist);
+        plist_remove(&shard->plist, pnode);
+        cpq_shard_update_min(shard);
+        pthread_mutex_unlock(&shard->lock);
+
+        /*
+         * The first node of the shard the hint refers to was removed, find
+         * the shard that now holds the first node of the queue.
+         */
+        if (shard == cpq_get_shard(cpq, hint)) {
+            index = cpq_find_min(cpq);
+
+            if (index != -1) {
+                atomic_store_explicit(&cpq->hint, index, memory_order_relaxed);
+            }
+        }
+
+        return structof(pnode, struct cpq_node, plist_node);
+    }
+}
+
+bool
+cpq_empty(const struct cpq *cpq)
+{
+    return cpq_find_min(cpq) == -1;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Concurrent priority queue.
+ *
+ * This queue is sharded into per-processor priority lists, each protected
+ * by its own lock, so that threads running on different processors rarely
+ * contend. Shards are allocated at initialization, one per processor as
+ * reported by cpu_count(). As with priority lists, nodes with lower
+ * priority values come first.
+ *
+ * The order of removal is relaxed : a thread removing a node picks the
+ * shard with the lowest first priority among two candidates, the shard of
+ * the local processor, and the shard believed to contain the first node
+ * of the whole queue, as tracked by a global hint. Without concurrency,
+ * nodes are removed in priority order. With concurrency, nodes may be
+ * removed before nodes of lower priority values queued on other shards.
+ */
+
+#ifndef CPQ_H
+#define CPQ_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "macros.h"
+#include "percpu.h"
+#include "plist.h"
+
+/*
+ * Priority published by empty shards.
+ */
+#define CPQ_EMPTY ((unsigned int)-1)
+
+/*
+ * Queue node.
+ */
+struct cpq_node {
+    struct plist_node plist_node;
+};
+
+/*
+ * Per-processor shard.
+ *
+ * The min member is the priority of the first node of the shard, and may
+ * be read without holding the lock.
+ */
+struct cpq_shard {
+    pthread_mutex_t lock;
+    struct plist plist;
+    atomic_uint min;
+};
+
+/*
+ * Concurrent priority queue.
+ *
+ * The shards member is a per-processor area of shards.
+ */
+struct cpq {
+    struct percpu_area shards;
+    atomic_uint hint __cacheline_aligned;
+};
+
+/*
+ * Initialize a queue.
+ *
+ * If memory can't be allocated, ENOMEM is returned.
+ */
+int cpq_init(struct cpq *cpq);
+
+/*
+ * Destroy a queue.
+ *
+ * The queue must be empty.
+ */
+void cpq_destroy(struct cpq *cpq);
+
+/*
+ * Initialize a queue node.
+ */
+static inline void
+cpq_node_init(struct cpq_node *node, unsigned int priority)
+{
+    plist_node_init(&node->plist_node, priority);
+}
+
+/*
+ * Return the priority associated with a node.
+ */
+static inline unsigned int
+cpq_node_priority(const struct cpq_node *node)
+{
+    return plist_node_priority(&node->plist_node);
+}
+
+/*
+ * Macro that evaluates to the address of the structure containing the
+ * given node based on the given type and member.
+ */
+#define cpq_entry(node, type, member) structof(node, type, member)
+
+/*
+ * Add a node to a queue.
+ *
+ * The node is added to the shard of the local processor. Its priority
+ * must be less than CPQ_EMPTY.
+ */
+void cpq_push(struct cpq *cpq, struct cpq_node *node);
+
+/*
+ * Remove a node from a queue and return it.
+ *
+ * If the queue is empty, NULL is returned.
+ */
+struct cpq_node * cpq_pop(struct cpq *cpq);
+
+/*
+ * Return true if a queue is empty.
+ *
+ * The result may be outdated as soon as this function returns.
+ */
+bool cpq_empty(const struct cpq *cpq);
+
+#endif /* CPQ_H */
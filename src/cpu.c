@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Processor topology is obtained from sysfs on first use. Missing
+ * information is replaced with values describing a machine with a single
+ * NUMA node and a last level cache shared by all processors.
+ */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "macros.h"
+
+#define CPU_SYSFS_PATH "/sys/devices/system/cpu"
+
+struct cpu_info {
+    unsigned int node;
+    unsigned int llc;
+};
+
+struct cpu_topology {
+    unsigned int nr_possible;
+    bool possible_known;
+    unsigned int nr_cpus;
+    unsigned int l1_size;
+    unsigned int nr_nodes;
+    struct cpu_info cpus[NR_CPUS];
+};
+
+static struct cpu_topology cpu_topology;
+static pthread_once_t cpu_topology_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Read the first line of a sysfs file, without the newline character.
+ */
+static int
+cpu_read_line(const char *path, char *buf, size_t size)
+{
+    char *ptr;
+    FILE *file;
+
+    file = fopen(path, "r");
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    ptr = fgets(buf, size, file);
+    fclose(file);
+
+    if (ptr == NULL) {
+        return -1;
+    }
+
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static int
+cpu_read_uint(const char *path, unsigned int *valuep)
+{
+    char buf[32], *end;
+    unsigned long value;
+    int error;
+
+    error = cpu_read_line(path, buf, sizeof(buf));
+
+    if (error) {
+        return error;
+    }
+
+    value = strtoul(buf, &end, 10);
+
+    if ((end == buf) || (*end != '\0')) {
+        return -1;
+    }
+
+    *valuep = value;
+    return 0;
+}
+
+/*
+ * Return the first and last processors of a list such as "0-3,8-11".
+ */
+static int
+cpu_parse_list(const char *list, unsigned int *firstp, unsigned int *lastp)
+{
+    unsigned long first, last;
+    const char *ptr;
+    char *end;
+
+    first = strtoul(list, &end, 10);
+
+    if (end == list) {
+        return -1;
+    }
+
+    ptr = strrchr(list, ',');
+    ptr = (ptr == NULL) ? list : (ptr + 1);
+    last = strtoul(ptr, &end, 10);
+
+    if (*end == '-') {
+        ptr = end + 1;
+        last = strtoul(ptr, &end, 10);
+    }
+
+    if (end == ptr) {
+        return -1;
+    }
+
+    *firstp = first;
+    *lastp = last;
+    return 0;
+}
+
+/*
+ * Return the last processor of a sysfs processor list.
+ */
+static int
+cpu_read_last(const char *path, unsigned int *lastp)
+{
+    unsigned int first;
+    char buf[256];
+    int error;
+
+    error = cpu_read_line(path, buf, sizeof(buf));
+
+    if (error) {
+        return error;
+    }
+
+    return cpu_parse_list(buf, &first, lastp);
+}
+
+/*
+ * Return the number of processor IDs, i.e. the highest possible processor
+ * ID plus one.
+ *
+ * If possible processors can't be listed, the highest ID among present
+ * processors and processors the calling thread may run on is used, or the
+ * number of configured processors if greater. Processors with higher IDs
+ * may then exist.
+ */
+static unsigned int
+cpu_detect_count(bool *knownp)
+{
+    unsigned int i, last;
+    cpu_set_t set;
+    long count;
+    int error;
+
+    error = cpu_read_last(CPU_SYSFS_PATH "/possible", &last);
+    *knownp = !error;
+
+    if (!error) {
+        return last + 1;
+    }
+
+    count = sysconf(_SC_NPROCESSORS_CONF);
+    error = cpu_read_last(CPU_SYSFS_PATH "/present", &last);
+
+    if (!error) {
+        count = MAX(count, (long)last + 1);
+    }
+
+    error = sched_getaffinity(0, sizeof(set), &set);
+
+    if (!error) {
+        for (i = CPU_SETSIZE; i > 0; i--) {
+            if (CPU_ISSET(i - 1, &set)) {
+                count = MAX(count, (long)i);
+                break;
+            }
+        }
+    }
+
+    if (count < 1) {
+        count = 1;
+    }
+
+    return count;
+}
+
+static unsigned int
+cpu_detect_l1_size(void)
+{
+    unsigned int size;
+    long value;
+    int error;
+
+    error = cpu_read_uint(CPU_SYSFS_PATH "/cpu0/cache/index0/"
+                          "coherency_line_size", &size);
+
+    if (!error && (size != 0) && ISP2(size)) {
+        return size;
+    }
+
+    value = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+
+    if ((value > 0) && ISP2(value)) {
+        return value;
+    }
+
+    return CPU_L1_SIZE;
+}
+
+static unsigned int
+cpu_detect_node(unsigned int cpu)
+{
+    struct dirent *entry;
+    unsigned int node;
+    char path[64];
+    DIR *dir;
+
+    snprintf(path, sizeof(path), CPU_SYSFS_PATH "/cpu%u", cpu);
+    dir = opendir(path);
+
+    if (dir == NULL) {
+        return 0;
+    }
+
+    node = 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (sscanf(entry->d_name, "node%u", &node) == 1) {
+            break;
+        }
+    }
+
+    closedir(dir);
+    return node;
+}
+
+/*
+ * The last level cache is the cache with the highest level, among those
+ * listed for the processor.
+ */
+static unsigned int
+cpu_detect_llc(unsigned int cpu)
+{
+    unsigned int i, level, max_level, first, last, llc;
+    char path[96], buf[256];
+    int error;
+
+    llc = 0;
+    max_level = 0;
+
+    for (i = 0; /* no condition */; i++) {
+        snprintf(path, sizeof(path),
+                 CPU_SYSFS_PATH "/cpu%u/cache/index%u/level", cpu, i);
+        error = cpu_read_uint(path, &level);
+
+        if (error) {
+            break;
+        }
+
+        if (level <= max_level) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path),
+                 CPU_SYSFS_PATH "/cpu%u/cache/index%u/shared_cpu_list", cpu, i);
+        error = cpu_read_line(path, buf, sizeof(buf));
+
+        if (!error) {
+            error = cpu_parse_list(buf, &first, &last);
+        }
+
+        if (!error) {
+            max_level = level;
+            llc = first;
+        }
+    }
+
+    return llc;
+}
+
+static void
+cpu_setup_topology(void)
+{
+    struct cpu_topology *topology;
+    struct cpu_info *info;
+    unsigned int cpu;
+
+    topology = &cpu_topology;
+    topology->nr_possible = cpu_detect_count(&topology->possible_known);
+    topology->nr_cpus = MIN(topology->nr_possible, NR_CPUS);
+    topology->l1_size = cpu_detect_l1_size();
+    topology->nr_nodes = 1;
+
+    for (cpu = 0; cpu < topology->nr_cpus; cpu++) {
+        info = &topology->cpus[cpu];
+        info->node = cpu_detect_node(cpu);
+        info->llc = cpu_detect_llc(cpu);
+
+        if (info->llc >= topology->nr_cpus) {
+            info->llc = 0;
+        }
+
+        topology->nr_nodes = MAX(topology->nr_nodes, info->node + 1);
+    }
+}
+
+static const struct cpu_topology *
+cpu_get_topology(void)
+{
+    pthread_once(&cpu_topology_once, cpu_setup_topology);
+    return &cpu_topology;
+}
+
+unsigned int
+cpu_count(void)
+{
+    return cpu_get_topology()->nr_cpus;
+}
+
+unsigned int
+cpu_nr_possible(void)
+{
+    return cpu_get_topology()->nr_possible;
+}
+
+bool
+cpu_ids_bounded(void)
+{
+    return cpu_get_topology()->possible_known;
+}
+
+unsigned int
+cpu_l1_size(void)
+{
+    return cpu_get_topology()->l1_size;
+}
+
+unsigned int
+cpu_nr_nodes(void)
+{
+    return cpu_get_topology()->nr_nodes;
+}
+
+unsigned int
+cpu_node(unsigned int cpu)
+{
+    const struct cpu_topology *topology;
+
+    topology = cpu_get_topology();
+    return (cpu < topology->nr_cpus) ? topology->cpus[cpu].node : 0;
+}
+
+unsigned int
+cpu_llc(unsigned int cpu)
+{
+    const struct cpu_topology *topology;
+
+    topology = cpu_get_topology();
+    return (cpu < topology->nr_cpus) ? topology->cpus[cpu].llc : 0;
+}
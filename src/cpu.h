@@ -27,11 +27,16 @@
 #define CPU_H
 
 #include <sched.h>
+#include <stdbool.h>
 
 #include "macros.h"
+#include "rseq.h"
 
 /*
  * Maximum number of supported processors.
+ *
+ * This value is used to size static per-processor data. The actual number
+ * of processors is detected at run time, see cpu_count().
  */
 #define NR_CPUS CONFIG_NR_CPUS
 
@@ -47,6 +52,9 @@
 
 /*
  * L1 cache line shift and size.
+ *
+ * These values are used for static alignment. The actual cache line size
+ * is detected at run time, see cpu_l1_size().
  */
 #define CPU_L1_SHIFT    CONFIG_CPU_L1_SHIFT
 #define CPU_L1_SIZE     (1 << CPU_L1_SHIFT)
@@ -54,9 +62,11 @@
 /*
  * Return the ID of the currently running CPU.
  *
- * This implementation uses a glibc-specific function that relies on a
- * Linux-specific system call to obtain the CPU ID. If this function fails
- * (e.g. when run in valgrind), 0 is returned.
+ * The CPU ID is read from the restartable sequence area of the calling
+ * thread when available. Otherwise, this implementation uses a
+ * glibc-specific function that relies on a Linux-specific system call to
+ * obtain the CPU ID. If this function fails (e.g. when run in valgrind),
+ * 0 is returned.
  *
  * The returned CPU ID cannot be greater than the maximum number of supported
  * processors.
@@ -69,11 +79,17 @@ cpu_id(void)
 #else
     int id;
 
-    id = sched_getcpu();
+    id = rseq_cpu_id();
 
     if (id == -1) {
-        return 0;
-    } else if (id >= NR_CPUS) {
+        id = sched_getcpu();
+
+        if (id == -1) {
+            return 0;
+        }
+    }
+
+    if (id >= NR_CPUS) {
         id &= (NR_CPUS - 1);
     }
 
@@ -81,4 +97,53 @@ cpu_id(void)
 #endif
 }
 
+/*
+ * Return the number of processors.
+ *
+ * This is the number of possible processors as reported by the system,
+ * bounded by NR_CPUS. Processor IDs returned by cpu_id() are lower than
+ * this value, unless the system doesn't report possible processors, in
+ * which case the count is a best effort estimate. Users indexing arrays
+ * sized with this value must therefore bound processor IDs, as done by
+ * per-processor areas.
+ */
+unsigned int cpu_count(void);
+
+/*
+ * Return the number of possible processors as reported by the system.
+ *
+ * Unlike cpu_count(), this value isn't bounded by NR_CPUS. If it's greater
+ * than NR_CPUS, several processors share the same ID.
+ */
+unsigned int cpu_nr_possible(void);
+
+/*
+ * Return true if processor IDs are known to be lower than the number of
+ * possible processors, i.e. if the system reports possible processors.
+ */
+bool cpu_ids_bounded(void);
+
+/*
+ * Return the L1 cache line size.
+ */
+unsigned int cpu_l1_size(void);
+
+/*
+ * Return the number of NUMA nodes.
+ */
+unsigned int cpu_nr_nodes(void);
+
+/*
+ * Return the NUMA node of the given processor.
+ */
+unsigned int cpu_node(unsigned int cpu);
+
+/*
+ * Return the ID of the last level cache shared by the given processor.
+ *
+ * This ID is the lowest ID among the processors sharing that cache, so
+ * that processors sharing a last level cache have the same ID.
+ */
+unsigned int cpu_llc(unsigned int cpu);
+
 #endif /* CPU_H */
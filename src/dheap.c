@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+
+#include "dheap.h"
+
+#define DHEAP_ARITY 4
+
+static inline unsigned int
+dheap_parent(unsigned int index)
+{
+    return (index - 1) / DHEAP_ARITY;
+}
+
+static inline unsigned int
+dheap_first_child(unsigned int index)
+{
+    return (index * DHEAP_ARITY) + 1;
+}
+
+static inline void
+dheap_set(struct dheap *heap, unsigned int index, struct dheap_node *node)
+{
+    heap->nodes[index] = node;
+    node->index = index;
+}
+
+/*
+ * Move a node toward the root, starting at the given index, which is
+ * considered empty.
+ */
+static void
+dheap_sift_up(struct dheap *heap, unsigned int index, struct dheap_node *node)
+{
+    struct dheap_node *parent;
+    unsigned int parent_index;
+
+    while (index != 0) {
+        parent_index = dheap_parent(index);
+        parent = heap->nodes[parent_index];
+
+        if (heap->cmp_fn(node, parent) >= 0) {
+            break;
+        }
+
+        dheap_set(heap, index, parent);
+        index = parent_index;
+    }
+
+    dheap_set(heap, index, node);
+}
+
+/*
+ * Move a node toward the leaves, starting at the given index, which is
+ * considered empty.
+ */
+static void
+dheap_sift_down(struct dheap *heap, unsigned int index,
+                struct dheap_node *node)
+{
+    unsigned int i, child_index, end;
+    struct dheap_node *child;
+
+    for (;;) {
+        child_index = dheap_first_child(index);
+
+        if (child_index >= heap->size) {
+            break;
+        }
+
+        end = child_index + DHEAP_ARITY;
+
+        if (end > heap->size) {
+            end = heap->size;
+        }
+
+        for (i = child_index + 1; i < end; i++) {
+            if (heap->cmp_fn(heap->nodes[i], heap->nodes[child_index]) < 0) {
+                child_index = i;
+            }
+        }
+
+        child = heap->nodes[child_index];
+
+        if (heap->cmp_fn(child, node) >= 0) {
+            break;
+        }
+
+        dheap_set(heap, index, child);
+        index = child_index;
+    }
+
+    dheap_set(heap, index, node);
+}
+
+int
+dheap_insert(struct dheap *heap, struct dheap_node *node)
+{
+    if (heap->size == heap->capacity) {
+        return EAGAIN;
+    }
+
+    heap->size++;
+    dheap_sift_up(heap, heap->size - 1, node);
+    return 0;
+}
+
+void
+dheap_remove(struct dheap *heap, struct dheap_node *node)
+{
+    struct dheap_node *last;
+    unsigned int index;
+
+    index = node->index;
+    assert(index < heap->size);
+    assert(heap->nodes[index] == node);
+
+    heap->size--;
+
+    if (index == heap->size) {
+        return;
+    }
+
+    last = heap->nodes[heap->size];
+
+    if ((index != 0)
+        && (heap->cmp_fn(last, heap->nodes[dheap_parent(index)]) < 0)) {
+        dheap_sift_up(heap, index, last);
+    } else {
+        dheap_sift_down(heap, index, last);
+    }
+}
+
+struct dheap_node *
+dheap_remove_first(struct dheap *heap)
+{
+    struct dheap_node *node;
+
+    node = dheap_first(heap);
+
+    if (node != NULL) {
+        dheap_remove(heap, node);
+    }
+
+    return node;
+}
+
+void
+dheap_decrease(struct dheap *heap, struct dheap_node *node)
+{
+    dheap_sift_up(heap, node->index, node);
+}
+
+void
+dheap_update(struct dheap *heap, struct dheap_node *node)
+{
+    unsigned int index;
+
+    index = node->index;
+
+    if ((index != 0)
+        && (heap->cmp_fn(node, heap->nodes[dheap_parent(index)]) < 0)) {
+        dheap_sift_up(heap, index, node);
+    } else {
+        dheap_sift_down(heap, index, node);
+    }
+}
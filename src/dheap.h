@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ *
+ * 4-ary heap.
+ *
+ * This container is an implicit min-heap, i.e. stored in an array, with
+ * intrusive nodes which record their position in the array, so that nodes
+ * can be removed, or have their key changed, in O(log n). Using four
+ * children per node makes the heap shallower than a binary heap, and
+ * places siblings next to each other in memory, which makes it cache
+ * friendly.
+ *
+ * The array is provided by the user, which means the capacity of a heap
+ * is fixed.
+ *
+ * The order of nodes is defined by a comparison function given when
+ * initializing the heap, which returns a negative value if its first
+ * argument comes before the second, and a positive value if it comes after.
+ */
+
+#ifndef DHEAP_H
+#define DHEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "macros.h"
+
+/*
+ * Heap node.
+ */
+struct dheap_node {
+    unsigned int index;
+};
+
+/*
+ * Type for comparison functions.
+ */
+typedef int (*dheap_cmp_fn_t)(const struct dheap_node *a,
+                              const struct dheap_node *b);
+
+/*
+ * 4-ary heap.
+ */
+struct dheap {
+    struct dheap_node **nodes;
+    unsigned int size;
+    unsigned int capacity;
+    dheap_cmp_fn_t cmp_fn;
+};
+
+/*
+ * Initialize a heap.
+ *
+ * The nodes array must contain capacity entries, and persist in memory
+ * as long as the heap is used.
+ */
+static inline void
+dheap_init(struct dheap *heap, struct dheap_node **nodes,
+           unsigned int capacity, dheap_cmp_fn_t cmp_fn)
+{
+    heap->nodes = nodes;
+    heap->size = 0;
+    heap->capacity = capacity;
+    heap->cmp_fn = cmp_fn;
+}
+
+/*
+ * Macro that evaluates to the address of the structure containing the
+ * given node based on the given type and member.
+ */
+#define dheap_entry(node, type, member) structof(node, type, member)
+
+/*
+ * Return true if heap is empty.
+ */
+static inline bool
+dheap_empty(const struct dheap *heap)
+{
+    return heap->size == 0;
+}
+
+/*
+ * Return the number of nodes in a heap.
+ */
+static inline unsigned int
+dheap_size(const struct dheap *heap)
+{
+    return heap->size;
+}
+
+/*
+ * Return the first node of a heap.
+ *
+ * If the heap is empty, NULL is returned.
+ */
+static inline struct dheap_node *
+dheap_first(const struct dheap *heap)
+{
+    return dheap_empty(heap) ? NULL : heap->nodes[0];
+}
+
+/*
+ * Insert a node in a heap.
+ *
+ * If the heap is full, EAGAIN is returned.
+ */
+int dheap_insert(struct dheap *heap, struct dheap_node *node);
+
+/*
+ * Remove a node from a heap.
+ */
+void dheap_remove(struct dheap *heap, struct dheap_node *node);
+
+/*
+ * Remove the first node of a heap and return it.
+ *
+ * If the heap is empty, NULL is returned.
+ */
+struct dheap_node * dheap_remove_first(struct dheap *heap);
+
+/*
+ * Restore the heap property after the key of a node has decreased.
+ */
+void dheap_decrease(struct dheap *heap, struct dheap_node *node);
+
+/*
+ * Restore the heap property after the key of a node has changed.
+ */
+void dheap_update(struct dheap *heap, struct dheap_node *node);
+
+#endif /* DHEAP_H */
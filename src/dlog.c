@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "dlog.h"
+#include "fmt.h"
+#include "list.h"
+#include "macros.h"
+#include "mbuf.h"
+
+/*
+ * Period at which the rendering thread polls buffers, in milliseconds.
+ *
+ * Producers never wake up the rendering thread, as doing so would add
+ * a system call to their path.
+ */
+#define DLOG_PERIOD_MS 10
+
+/*
+ * Call site states.
+ */
+enum {
+    DLOG_SITE_NEW,
+    DLOG_SITE_COMPILING,
+    DLOG_SITE_READY,
+    DLOG_SITE_INVALID,
+};
+
+static __thread struct dlog_buffer *dlog_buffer;
+
+/*
+ * Return the compiled format of a call site.
+ *
+ * The first thread to use a call site compiles its format. Other threads
+ * using the call site concurrently compile the format in the given
+ * temporary storage instead of waiting.
+ */
+static const struct fmt_args *
+dlog_site_get_args(struct dlog_site *site, struct fmt_args *tmp)
+{
+    int state, error;
+
+    state = atomic_load_explicit(&site->state, memory_order_acquire);
+
+    if (likely(state == DLOG_SITE_READY)) {
+        return &site->args;
+    } else if (state == DLOG_SITE_INVALID) {
+        return NULL;
+    }
+
+    if ((state == DLOG_SITE_NEW)
+        && atomic_compare_exchange_strong_explicit(&site->state, &state,
+                                                   DLOG_SITE_COMPILING,
+                                                   memory_order_acquire,
+                                                   memory_order_relaxed)) {
+        error = fmt_args_compile(&site->args, site->format);
+        atomic_store_explicit(&site->state,
+                              error ? DLOG_SITE_INVALID : DLOG_SITE_READY,
+                              memory_order_release);
+        return error ? NULL : &site->args;
+    }
+
+    error = fmt_args_compile(tmp, site->format);
+    return error ? NULL : tmp;
+}
+
+int
+dlog_log(struct dlog_site *site, ...)
+{
+    const struct fmt_args *args;
+    struct dlog_buffer *buffer;
+    char msg[DLOG_MAX_MSG_SIZE];
+    struct fmt_args tmp;
+    size_t size;
+    va_list ap;
+    int error;
+
+    buffer = dlog_buffer;
+
+    if (buffer == NULL) {
+        return ENOENT;
+    }
+
+    args = dlog_site_get_args(site, &tmp);
+
+    if (args == NULL) {
+        return EINVAL;
+    }
+
+    memcpy(msg, &site, sizeof(site));
+    size = sizeof(msg) - sizeof(site);
+
+    va_start(ap, site);
+    error = fmt_args_vpack(args, &msg[sizeof(site)], &size, ap);
+    va_end(ap);
+
+    pthread_mutex_lock(&buffer->lock);
+
+    if (!error) {
+        error = mbuf_push(&buffer->mbuf, msg, sizeof(site) + size, false);
+    }
+
+    if (error) {
+        buffer->nr_drops++;
+    }
+
+    pthread_mutex_unlock(&buffer->lock);
+
+    return error;
+}
+
+static void
+dlog_render(struct dlog *dlog, const char *msg)
+{
+    const struct dlog_site *site;
+    char line[DLOG_MAX_LINE_SIZE];
+    size_t size;
+
+    memcpy(&site, msg, sizeof(site));
+    size = fmt_snprintf_packed(line, sizeof(line), site->format,
+                               &msg[sizeof(site)]);
+
+    if (size >= sizeof(line)) {
+        size = sizeof(line) - 1;
+    }
+
+    dlog->write_fn(dlog->arg, line, size);
+}
+
+static void
+dlog_drain_buffer(struct dlog *dlog, struct dlog_buffer *buffer)
+{
+    char msg[DLOG_MAX_MSG_SIZE];
+    size_t size;
+    int error;
+
+    for (;;) {
+        size = sizeof(msg);
+
+        pthread_mutex_lock(&buffer->lock);
+        error = mbuf_pop(&buffer->mbuf, msg, &size);
+        pthread_mutex_unlock(&buffer->lock);
+
+        if (error) {
+            assert(error == EAGAIN);
+            break;
+        }
+
+        dlog_render(dlog, msg);
+    }
+}
+
+/*
+ * Render all pending messages.
+ *
+ * The logger must be locked.
+ */
+static void
+dlog_drain(struct dlog *dlog)
+{
+    struct dlog_buffer *buffer;
+
+    list_for_each_entry(&dlog->buffers, buffer, node) {
+        dlog_drain_buffer(dlog, buffer);
+    }
+}
+
+static void
+dlog_compute_deadline(struct timespec *ts)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_nsec += DLOG_PERIOD_MS * 1000000L;
+
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void *
+dlog_run(void *arg)
+{
+    struct dlog *dlog;
+    struct timespec ts;
+
+    dlog = arg;
+
+    pthread_mutex_lock(&dlog->lock);
+
+    for (;;) {
+        dlog_drain(dlog);
+
+        if (!dlog->running) {
+            break;
+        }
+
+        dlog_compute_deadline(&ts);
+        pthread_cond_timedwait(&dlog->cond, &dlog->lock, &ts);
+    }
+
+    pthread_mutex_unlock(&dlog->lock);
+
+    return NULL;
+}
+
+void
+dlog_init(struct dlog *dlog, dlog_write_fn_t write_fn, void *arg)
+{
+    pthread_mutex_init(&dlog->lock, NULL);
+    pthread_cond_init(&dlog->cond, NULL);
+    list_init(&dlog->buffers);
+    dlog->write_fn = write_fn;
+    dlog->arg = arg;
+    dlog->running = false;
+}
+
+int
+dlog_start(struct dlog *dlog)
+{
+    int error;
+
+    assert(!dlog->running);
+
+    dlog->running = true;
+    error = pthread_create(&dlog->thread, NULL, dlog_run, dlog);
+
+    if (error) {
+        dlog->running = false;
+    }
+
+    return error;
+}
+
+void
+dlog_stop(struct dlog *dlog)
+{
+    pthread_mutex_lock(&dlog->lock);
+    assert(dlog->running);
+    dlog->running = false;
+    pthread_cond_signal(&dlog->cond);
+    pthread_mutex_unlock(&dlog->lock);
+
+    pthread_join(dlog->thread, NULL);
+}
+
+void
+dlog_flush(struct dlog *dlog)
+{
+    pthread_mutex_lock(&dlog->lock);
+    dlog_drain(dlog);
+    pthread_mutex_unlock(&dlog->lock);
+}
+
+void
+dlog_register(struct dlog *dlog, struct dlog_buffer *buffer,
+              void *buf, size_t capacity)
+{
+    assert(dlog_buffer == NULL);
+
+    buffer->dlog = dlog;
+    pthread_mutex_init(&buffer->lock, NULL);
+    mbuf_init(&buffer->mbuf, buf, capacity, DLOG_MAX_MSG_SIZE);
+    buffer->nr_drops = 0;
+
+    pthread_mutex_lock(&dlog->lock);
+    list_insert_tail(&dlog->buffers, &buffer->node);
+    pthread_mutex_unlock(&dlog->lock);
+
+    dlog_buffer = buffer;
+}
+
+void
+dlog_unregister(struct dlog_buffer *buffer)
+{
+    struct dlog *dlog;
+
+    assert(dlog_buffer == buffer);
+
+    dlog_buffer = NULL;
+    dlog = buffer->dlog;
+
+    pthread_mutex_lock(&dlog->lock);
+    dlog_drain_buffer(dlog, buffer);
+    list_remove(&buffer->node);
+    pthread_mutex_unlock(&dlog->lock);
+
+    pthread_mutex_destroy(&buffer->lock);
+}
+
+unsigned long
+dlog_buffer_nr_drops(struct dlog_buffer *buffer)
+{
+    unsigned long nr_drops;
+
+    pthread_mutex_lock(&buffer->lock);
+    nr_drops = buffer->nr_drops;
+    pthread_mutex_unlock(&buffer->lock);
+
+    return nr_drops;
+}
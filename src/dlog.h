@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Deferred logging.
+ *
+ * This module moves the cost of formatting log messages out of the threads
+ * producing them. Producers only pack the raw arguments of a message, along
+ * with the address of its call site, into a message buffer private to the
+ * calling thread. A background thread then formats messages and passes the
+ * resulting text to an output function.
+ *
+ * The argument types of a call site are obtained by compiling its format
+ * string the first time the call site is used.
+ *
+ * Messages from a given thread are rendered in order, but there is no
+ * ordering between messages from different threads. When the buffer of
+ * a thread is full, new messages are dropped and accounted.
+ */
+
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fmt.h"
+#include "list.h"
+#include "macros.h"
+#include "mbuf.h"
+
+/*
+ * Maximum size of a packed message, including the call site address.
+ */
+#define DLOG_MAX_MSG_SIZE 256
+
+/*
+ * Maximum size of a rendered message, including the null character.
+ *
+ * Longer messages are truncated.
+ */
+#define DLOG_MAX_LINE_SIZE 512
+
+/*
+ * Type for output functions.
+ *
+ * The given string is null-terminated, and its size doesn't include the
+ * null character.
+ */
+typedef void (*dlog_write_fn_t)(void *arg, const char *str, size_t size);
+
+/*
+ * Call site.
+ *
+ * Call sites are statically allocated by dlog_printf().
+ */
+struct dlog_site {
+    const char *format;
+    atomic_int state;
+    struct fmt_args args;
+};
+
+#define DLOG_SITE_INITIALIZER(format) { format, 0, { 0 } }
+
+/*
+ * Per-thread buffer.
+ *
+ * The lock serializes accesses to the message buffer between its producer
+ * and the rendering thread.
+ */
+struct dlog_buffer {
+    struct list node;
+    struct dlog *dlog;
+    pthread_mutex_t lock;
+    struct mbuf mbuf;
+    unsigned long nr_drops;
+};
+
+/*
+ * Deferred logger.
+ */
+struct dlog {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct list buffers;
+    dlog_write_fn_t write_fn;
+    void *arg;
+    pthread_t thread;
+    bool running;
+};
+
+/*
+ * Initialize a logger.
+ */
+void dlog_init(struct dlog *dlog, dlog_write_fn_t write_fn, void *arg);
+
+/*
+ * Start/stop the rendering thread of a logger.
+ *
+ * Stopping the rendering thread renders all pending messages.
+ */
+int dlog_start(struct dlog *dlog);
+void dlog_stop(struct dlog *dlog);
+
+/*
+ * Render all pending messages.
+ */
+void dlog_flush(struct dlog *dlog);
+
+/*
+ * Register/unregister the buffer of the calling thread.
+ *
+ * The buffer is set to use the given storage, which must persist in memory
+ * until the buffer is unregistered. Capacity must be a power-of-two.
+ *
+ * Unregistering a buffer renders its pending messages.
+ */
+void dlog_register(struct dlog *dlog, struct dlog_buffer *buffer,
+                   void *buf, size_t capacity);
+void dlog_unregister(struct dlog_buffer *buffer);
+
+/*
+ * Return the number of messages dropped because the buffer was full.
+ */
+unsigned long dlog_buffer_nr_drops(struct dlog_buffer *buffer);
+
+/*
+ * Log a message.
+ *
+ * If the calling thread has no registered buffer, ENOENT is returned.
+ * If the format is invalid for deferred formatting, EINVAL is returned.
+ * If the message is too large, or the buffer is full, EMSGSIZE is
+ * returned.
+ *
+ * The format must be a string literal.
+ */
+#define dlog_printf(format, ...)                                \
+MACRO_BEGIN                                                     \
+    static struct dlog_site dlog_site_                          \
+        = DLOG_SITE_INITIALIZER(format);                        \
+                                                                \
+    if (0) {                                                    \
+        dlog_check_format(format, ## __VA_ARGS__);              \
+    }                                                           \
+                                                                \
+    dlog_log(&dlog_site_, ## __VA_ARGS__);                      \
+MACRO_END
+
+/*
+ * Log a message for the given call site.
+ *
+ * See dlog_printf().
+ */
+int dlog_log(struct dlog_site *site, ...);
+
+/*
+ * Compile-time format checking.
+ *
+ * This function is private.
+ */
+static inline void __attribute__((format(printf, 1, 2)))
+dlog_check_format(const char *format __unused, ...)
+{
+}
+
+#endif /* DLOG_H */
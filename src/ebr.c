@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * The global epoch is only advanced with the registry lock held, by
+ * scanning all registered threads and checking that those inside critical
+ * sections have observed its current value. Since objects retired during
+ * the same epoch all share the same limbo list, and there are as many
+ * limbo lists as epochs with unreleased objects, a list can be reused
+ * for a new epoch once its objects are released.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ebr.h"
+#include "list.h"
+#include "macros.h"
+#include "slist.h"
+
+/*
+ * Global epoch.
+ *
+ * It is read by all threads when entering critical sections, and rarely
+ * written, so keep it on its own cache line.
+ */
+atomic_ulong ebr_global_epoch __cacheline_aligned = 1;
+
+__thread struct ebr_thread ebr_thread;
+
+static pthread_mutex_t ebr_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct list ebr_registry = LIST_INITIALIZER(ebr_registry);
+
+static void
+ebr_limbo_init(struct ebr_limbo *limbo)
+{
+    slist_init(&limbo->list);
+    limbo->epoch = 0;
+}
+
+static void
+ebr_limbo_flush(struct ebr_limbo *limbo)
+{
+    struct ebr_node *node, *tmp;
+    struct slist list;
+
+    /*
+     * Detach the list first, so that release functions may retire other
+     * objects.
+     */
+    slist_set_head(&list, &limbo->list);
+    slist_init(&limbo->list);
+
+    slist_for_each_entry_safe(&list, node, tmp, node) {
+        node->fn(node);
+    }
+}
+
+static bool
+ebr_limbo_ready(const struct ebr_limbo *limbo, unsigned long epoch)
+{
+    return (epoch - limbo->epoch) >= 2;
+}
+
+void
+ebr_register_thread(void)
+{
+    struct ebr_thread *thread;
+    unsigned int i;
+
+    thread = &ebr_thread;
+    assert(!thread->registered);
+
+    atomic_init(&thread->state, EBR_STATE_INACTIVE);
+    thread->nesting = 0;
+    thread->nr_pending = 0;
+    thread->registered = true;
+
+    for (i = 0; i < ARRAY_SIZE(thread->limbos); i++) {
+        ebr_limbo_init(&thread->limbos[i]);
+    }
+
+    pthread_mutex_lock(&ebr_registry_lock);
+    list_insert_tail(&ebr_registry, &thread->node);
+    pthread_mutex_unlock(&ebr_registry_lock);
+}
+
+void
+ebr_unregister_thread(void)
+{
+    struct ebr_thread *thread;
+
+    thread = &ebr_thread;
+    assert(thread->registered);
+
+    ebr_barrier();
+
+    pthread_mutex_lock(&ebr_registry_lock);
+    list_remove(&thread->node);
+    pthread_mutex_unlock(&ebr_registry_lock);
+
+    thread->registered = false;
+}
+
+/*
+ * Return the current global epoch, after attempting to advance it.
+ *
+ * The attempt is abandoned if another thread is already doing it.
+ */
+static unsigned long
+ebr_try_advance(void)
+{
+    struct ebr_thread *thread;
+    unsigned long epoch, state;
+    int error;
+
+    error = pthread_mutex_trylock(&ebr_registry_lock);
+
+    if (error) {
+        return atomic_load_explicit(&ebr_global_epoch, memory_order_acquire);
+    }
+
+    epoch = atomic_load_explicit(&ebr_global_epoch, memory_order_relaxed);
+
+    /*
+     * Pairs with the fence in ebr_enter(), so that either a thread entering
+     * a critical section is seen as active, or it observes the objects
+     * removed from shared structures before the scan.
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    list_for_each_entry(&ebr_registry, thread, node) {
+        state = atomic_load_explicit(&thread->state, memory_order_relaxed);
+
+        if ((state != EBR_STATE_INACTIVE)
+            && (state != ebr_state_active(epoch))) {
+            goto out;
+        }
+    }
+
+    /*
+     * Make sure the critical sections of the scanned threads complete
+     * before the new epoch is published.
+     */
+    atomic_thread_fence(memory_order_acquire);
+    epoch++;
+    atomic_store_explicit(&ebr_global_epoch, epoch, memory_order_release);
+
+out:
+    pthread_mutex_unlock(&ebr_registry_lock);
+    return epoch;
+}
+
+void
+ebr_retire(struct ebr_node *node, ebr_fn_t fn)
+{
+    struct ebr_thread *thread;
+    struct ebr_limbo *limbo;
+    unsigned long epoch;
+
+    thread = &ebr_thread;
+    assert(thread->registered);
+
+    node->fn = fn;
+
+    /*
+     * Make sure the object is removed from shared structures before
+     * reading the epoch during which it's retired.
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    epoch = atomic_load_explicit(&ebr_global_epoch, memory_order_acquire);
+
+    limbo = &thread->limbos[epoch % ARRAY_SIZE(thread->limbos)];
+
+    if (limbo->epoch != epoch) {
+        /*
+         * The limbo list was last used at least EBR_NR_LIMBOS epochs ago.
+         */
+        assert(slist_empty(&limbo->list) || ebr_limbo_ready(limbo, epoch));
+        ebr_limbo_flush(limbo);
+        limbo->epoch = epoch;
+    }
+
+    slist_insert_tail(&limbo->list, &node->node);
+    thread->nr_pending++;
+
+    if (thread->nr_pending >= EBR_BATCH_SIZE) {
+        ebr_collect();
+    }
+}
+
+void
+ebr_collect(void)
+{
+    struct ebr_thread *thread;
+    struct ebr_limbo *limbo;
+    unsigned long epoch;
+    unsigned int i;
+
+    thread = &ebr_thread;
+    assert(thread->registered);
+
+    thread->nr_pending = 0;
+    epoch = ebr_try_advance();
+
+    for (i = 0; i < ARRAY_SIZE(thread->limbos); i++) {
+        limbo = &thread->limbos[i];
+
+        if (ebr_limbo_ready(limbo, epoch)) {
+            ebr_limbo_flush(limbo);
+        }
+    }
+}
+
+static bool
+ebr_thread_idle(const struct ebr_thread *thread)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(thread->limbos); i++) {
+        if (!slist_empty(&thread->limbos[i].list)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+ebr_barrier(void)
+{
+    struct ebr_thread *thread;
+
+    thread = &ebr_thread;
+    assert(thread->registered);
+    assert(thread->nesting == 0);
+
+    for (;;) {
+        ebr_collect();
+
+        if (ebr_thread_idle(thread)) {
+            break;
+        }
+
+        sched_yield();
+    }
+}
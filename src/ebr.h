@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Epoch-based reclamation.
+ *
+ * This module provides safe memory reclamation for lockless data
+ * structures, such as those built on the lockless variants of the list,
+ * hlist and slist interfaces, or radix trees initialized with RDXTREE_EBR.
+ * It implements epoch-based reclamation (EBR), as described in "Practical
+ * lock-freedom", by Keir Fraser.
+ *
+ * Threads must register before accessing shared objects, and delimit
+ * their accesses with ebr_enter() and ebr_exit(). On entry, a thread
+ * publishes the value of the global epoch it observed. Objects removed
+ * from shared structures are retired with ebr_retire(), which queues them
+ * on a limbo list of the calling thread, along with the current global
+ * epoch. The global epoch may only be advanced once all threads inside
+ * critical sections have observed it, so that objects retired during
+ * epoch e can't be referenced any more once it reaches e + 2.
+ *
+ * Unlike QSBR, as provided by the rcu module, threads outside critical
+ * sections never delay reclamation, so that they don't need to report
+ * quiescent states or go offline, at the cost of a full memory barrier
+ * when entering critical sections. Unlike hazard pointers, the cost of
+ * a critical section doesn't depend on the number of objects it accesses,
+ * but a thread that stays inside a critical section prevents the release
+ * of all objects retired meanwhile.
+ *
+ * Reclamation is batched : threads only attempt to advance the global
+ * epoch and process their limbo lists every EBR_BATCH_SIZE retired
+ * objects, or when explicitly requested with ebr_collect() or
+ * ebr_barrier(). Objects are released by the thread that retired them.
+ */
+
+#ifndef EBR_H
+#define EBR_H
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#include "slist.h"
+
+/*
+ * Number of objects a thread may retire before attempting to release
+ * them.
+ */
+#define EBR_BATCH_SIZE 64
+
+struct ebr_node;
+
+/*
+ * Type for release functions.
+ */
+typedef void (*ebr_fn_t)(struct ebr_node *node);
+
+/*
+ * Retired object.
+ *
+ * This structure should be embedded in objects to release.
+ */
+struct ebr_node {
+    struct slist_node node;
+    ebr_fn_t fn;
+};
+
+#include "ebr_i.h"
+
+/*
+ * Register/unregister the calling thread.
+ *
+ * Unregistering waits for the release of all the objects retired by the
+ * calling thread, which must be outside critical sections.
+ */
+void ebr_register_thread(void);
+void ebr_unregister_thread(void);
+
+/*
+ * Enter/leave a critical section.
+ *
+ * Objects obtained from shared structures inside a critical section may
+ * only be accessed until the critical section is left. Critical sections
+ * may be nested, and the calling thread must be registered.
+ */
+static inline void
+ebr_enter(void)
+{
+    struct ebr_thread *thread;
+    unsigned long epoch;
+
+    thread = &ebr_thread;
+    assert(thread->registered);
+
+    if (thread->nesting == 0) {
+        epoch = atomic_load_explicit(&ebr_global_epoch, memory_order_relaxed);
+        atomic_store_explicit(&thread->state, ebr_state_active(epoch),
+                              memory_order_relaxed);
+
+        /*
+         * Make sure the epoch is published before accessing shared
+         * objects. Pairs with the fence in ebr_try_advance().
+         */
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+
+    thread->nesting++;
+}
+
+static inline void
+ebr_exit(void)
+{
+    struct ebr_thread *thread;
+
+    thread = &ebr_thread;
+    assert(thread->nesting != 0);
+
+    thread->nesting--;
+
+    if (thread->nesting == 0) {
+        atomic_store_explicit(&thread->state, EBR_STATE_INACTIVE,
+                              memory_order_release);
+    }
+}
+
+/*
+ * Retire an object.
+ *
+ * The object must have been removed from all shared structures, so that
+ * no new reference to it may be obtained. The given function is called,
+ * by the calling thread, once all critical sections that may still
+ * reference the object have completed, and may release it.
+ *
+ * The calling thread must be registered, and may be inside a critical
+ * section.
+ */
+void ebr_retire(struct ebr_node *node, ebr_fn_t fn);
+
+/*
+ * Attempt to advance the global epoch, and release the objects retired
+ * by the calling thread that may safely be.
+ *
+ * The calling thread must be registered.
+ */
+void ebr_collect(void);
+
+/*
+ * Wait for the release of all the objects retired by the calling thread.
+ *
+ * The calling thread must be registered and outside critical sections.
+ */
+void ebr_barrier(void);
+
+#endif /* EBR_H */
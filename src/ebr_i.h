@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#ifndef EBR_I_H
+#define EBR_I_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "list.h"
+#include "slist.h"
+
+/*
+ * Number of limbo lists per thread.
+ *
+ * Objects retired during epoch e may be released once the global epoch
+ * reaches e + 2, which means at most three epochs may have unreleased
+ * objects at any time.
+ */
+#define EBR_NR_LIMBOS 3
+
+/*
+ * Thread state when outside critical sections.
+ *
+ * Inside critical sections, the state is the epoch observed on entry,
+ * shifted left by one, with the lowest bit set.
+ */
+#define EBR_STATE_INACTIVE 0
+
+/*
+ * List of objects retired during the same epoch.
+ */
+struct ebr_limbo {
+    struct slist list;
+    unsigned long epoch;
+};
+
+/*
+ * Per-thread data.
+ *
+ * The state member is written by its owner only, and read by threads
+ * advancing the global epoch. The other members are private.
+ */
+struct ebr_thread {
+    atomic_ulong state;
+    unsigned int nesting;
+    unsigned int nr_pending;
+    bool registered;
+    struct list node;
+    struct ebr_limbo limbos[EBR_NR_LIMBOS];
+};
+
+extern atomic_ulong ebr_global_epoch;
+
+extern __thread struct ebr_thread ebr_thread;
+
+static inline unsigned long
+ebr_state_active(unsigned long epoch)
+{
+    return (epoch << 1) | 1;
+}
+
+#endif /* EBR_I_H */
@@ -85,6 +85,40 @@ enum {
     FMT_SPECIFIER_PERCENT,
 };
 
+/*
+ * Escaping modes of %s-like conversions, selected with %pJ, %pE and %pH.
+ */
+enum {
+    FMT_ESCAPE_NONE,
+    FMT_ESCAPE_JSON,
+    FMT_ESCAPE_C,
+    FMT_ESCAPE_HEX,
+};
+
+enum {
+    FMT_ARG_INT,
+    FMT_ARG_LONG,
+    FMT_ARG_LONGLONG,
+    FMT_ARG_PTR,
+    FMT_ARG_SIZE,
+    FMT_ARG_PTRDIFF,
+    FMT_ARG_STR,
+};
+
+enum {
+    FMT_SCAN_SPACE,
+    FMT_SCAN_LITERAL,
+    FMT_SCAN_CONV,
+};
+
+/*
+ * Escaping scans strings a word at a time to find runs of characters that
+ * can be copied as is. The ones and highs values have respectively the
+ * lowest and highest bit of each byte set.
+ */
+#define FMT_WORD_ONES   ((unsigned long)-1 / 0xff)
+#define FMT_WORD_HIGHS  (FMT_WORD_ONES * 0x80)
+
 /*
  * Note that copies of the original va_list object are made, because va_arg()
  * may not reliably be used by different callee functions, and despite the
@@ -92,25 +126,43 @@ enum {
  * very difficult for implementations to provide and is best avoided.
  */
 
+/*
+ * When formatting packed arguments, the args member points to the next
+ * packed argument, and the va_list object is left uninitialized.
+ */
 struct fmt_sprintf_state {
     const char *format;
     va_list ap;
+    const char *args;
     unsigned int flags;
     int width;
     int precision;
     unsigned int modifier;
     unsigned int specifier;
+    unsigned int escape;
     unsigned int base;
     char *str;
     char *start;
     char *end;
 };
 
+/*
+ * The end member is the end of the input, or NULL if the input is only
+ * terminated by a null character.
+ *
+ * When scanning into objects, the obj member is the base address of the
+ * current object, and arguments are obtained from the offsets array instead
+ * of the va_list object, which is then left uninitialized.
+ */
 struct fmt_sscanf_state {
     const char *str;
     const char *start;
+    const char *end;
     const char *format;
     va_list ap;
+    char *obj;
+    const size_t *offsets;
+    unsigned int arg_index;
     unsigned int flags;
     int width;
     unsigned int modifier;
@@ -162,12 +214,10 @@ fmt_isxdigit(char c)
 }
 
 static void
-fmt_sprintf_state_init(struct fmt_sprintf_state *state,
-                       char *str, size_t size,
-                       const char *format, va_list ap)
+fmt_sprintf_state_init_common(struct fmt_sprintf_state *state,
+                              char *str, size_t size, const char *format)
 {
     state->format = format;
-    va_copy(state->ap, ap);
     state->str = str;
     state->start = str;
 
@@ -180,10 +230,32 @@ fmt_sprintf_state_init(struct fmt_sprintf_state *state,
     }
 }
 
+static void
+fmt_sprintf_state_init(struct fmt_sprintf_state *state,
+                       char *str, size_t size,
+                       const char *format, va_list ap)
+{
+    fmt_sprintf_state_init_common(state, str, size, format);
+    va_copy(state->ap, ap);
+    state->args = NULL;
+}
+
+static void
+fmt_sprintf_state_init_packed(struct fmt_sprintf_state *state,
+                              char *str, size_t size,
+                              const char *format, const void *args)
+{
+    assert(args != NULL);
+    fmt_sprintf_state_init_common(state, str, size, format);
+    state->args = args;
+}
+
 static int
 fmt_sprintf_state_finalize(struct fmt_sprintf_state *state)
 {
-    va_end(state->ap);
+    if (state->args == NULL) {
+        va_end(state->ap);
+    }
 
     if (state->str < state->end) {
         *state->str = '\0';
@@ -194,6 +266,27 @@ fmt_sprintf_state_finalize(struct fmt_sprintf_state *state)
     return state->str - state->start;
 }
 
+/*
+ * Obtain the next argument, either from the va_list object or from
+ * packed arguments.
+ *
+ * Packed arguments are stored without padding, so they are copied out
+ * to avoid unaligned accesses.
+ */
+#define fmt_sprintf_state_get_arg(state, type)          \
+MACRO_BEGIN                                             \
+    type arg_;                                          \
+                                                        \
+    if ((state)->args == NULL) {                        \
+        arg_ = va_arg((state)->ap, type);               \
+    } else {                                            \
+        memcpy(&arg_, (state)->args, sizeof(arg_));     \
+        (state)->args += sizeof(arg_);                  \
+    }                                                   \
+                                                        \
+    arg_;                                               \
+MACRO_END
+
 static char
 fmt_sprintf_state_consume_format(struct fmt_sprintf_state *state)
 {
@@ -260,7 +353,7 @@ fmt_sprintf_state_consume_width(struct fmt_sprintf_state *state)
 
         fmt_sprintf_state_restore_format(state);
     } else if (c == '*') {
-        state->width = va_arg(state->ap, int);
+        state->width = fmt_sprintf_state_get_arg(state, int);
 
         if (state->width < 0) {
             state->flags |= FMT_FORMAT_LEFT_JUSTIFY;
@@ -292,7 +385,7 @@ fmt_sprintf_state_consume_precision(struct fmt_sprintf_state *state)
 
             fmt_sprintf_state_restore_format(state);
         } else if (c == '*') {
-            state->precision = va_arg(state->ap, int);
+            state->precision = fmt_sprintf_state_get_arg(state, int);
 
             if (state->precision < 0) {
                 state->precision = 0;
@@ -343,12 +436,29 @@ fmt_sprintf_state_consume_modifier(struct fmt_sprintf_state *state)
     }
 }
 
+static unsigned int
+fmt_sprintf_state_consume_escape(struct fmt_sprintf_state *state)
+{
+    switch (fmt_sprintf_state_consume_format(state)) {
+    case 'J':
+        return FMT_ESCAPE_JSON;
+    case 'E':
+        return FMT_ESCAPE_C;
+    case 'H':
+        return FMT_ESCAPE_HEX;
+    default:
+        fmt_sprintf_state_restore_format(state);
+        return FMT_ESCAPE_NONE;
+    }
+}
+
 static void
 fmt_sprintf_state_consume_specifier(struct fmt_sprintf_state *state)
 {
     char c;
 
     c = fmt_sprintf_state_consume_format(state);
+    state->escape = FMT_ESCAPE_NONE;
 
     switch (c) {
     case 'd':
@@ -364,6 +474,13 @@ fmt_sprintf_state_consume_specifier(struct fmt_sprintf_state *state)
         state->specifier = FMT_SPECIFIER_INT;
         break;
     case 'p':
+        state->escape = fmt_sprintf_state_consume_escape(state);
+
+        if (state->escape != FMT_ESCAPE_NONE) {
+            state->specifier = FMT_SPECIFIER_STR;
+            break;
+        }
+
         state->flags |= FMT_FORMAT_ALT_FORM;
         state->modifier = FMT_MODIFIER_PTR;
         __fallthrough;
@@ -399,6 +516,13 @@ fmt_sprintf_state_produce_raw_char(struct fmt_sprintf_state *state, char c)
     fmt_vsnprintf_produce(&state->str, state->end, c);
 }
 
+static void
+fmt_sprintf_state_produce_raw(struct fmt_sprintf_state *state,
+                              const char *s, size_t size)
+{
+    state->str = fmt_spec_emit_raw(state->str, state->end, s, size);
+}
+
 static int
 fmt_sprintf_state_consume(struct fmt_sprintf_state *state)
 {
@@ -434,55 +558,55 @@ fmt_sprintf_state_produce_int(struct fmt_sprintf_state *state)
     switch (state->modifier) {
     case FMT_MODIFIER_CHAR:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            n = (signed char)va_arg(state->ap, int);
+            n = (signed char)fmt_sprintf_state_get_arg(state, int);
         } else {
-            n = (unsigned char)va_arg(state->ap, int);
+            n = (unsigned char)fmt_sprintf_state_get_arg(state, int);
         }
 
         break;
     case FMT_MODIFIER_SHORT:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            n = (short)va_arg(state->ap, int);
+            n = (short)fmt_sprintf_state_get_arg(state, int);
         } else {
-            n = (unsigned short)va_arg(state->ap, int);
+            n = (unsigned short)fmt_sprintf_state_get_arg(state, int);
         }
 
         break;
     case FMT_MODIFIER_LONG:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            n = va_arg(state->ap, long);
+            n = fmt_sprintf_state_get_arg(state, long);
         } else {
-            n = va_arg(state->ap, unsigned long);
+            n = fmt_sprintf_state_get_arg(state, unsigned long);
         }
 
         break;
     case FMT_MODIFIER_LONGLONG:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            n = va_arg(state->ap, long long);
+            n = fmt_sprintf_state_get_arg(state, long long);
         } else {
-            n = va_arg(state->ap, unsigned long long);
+            n = fmt_sprintf_state_get_arg(state, unsigned long long);
         }
 
         break;
     case FMT_MODIFIER_PTR:
-        n = (uintptr_t)va_arg(state->ap, void *);
+        n = (uintptr_t)fmt_sprintf_state_get_arg(state, void *);
         break;
     case FMT_MODIFIER_SIZE:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            n = va_arg(state->ap, ssize_t);
+            n = fmt_sprintf_state_get_arg(state, ssize_t);
         } else {
-            n = va_arg(state->ap, size_t);
+            n = fmt_sprintf_state_get_arg(state, size_t);
         }
 
         break;
     case FMT_MODIFIER_PTRDIFF:
-        n = va_arg(state->ap, ptrdiff_t);
+        n = fmt_sprintf_state_get_arg(state, ptrdiff_t);
         break;
     default:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            n = va_arg(state->ap, int);
+            n = fmt_sprintf_state_get_arg(state, int);
         } else {
-            n = va_arg(state->ap, unsigned int);
+            n = fmt_sprintf_state_get_arg(state, unsigned int);
         }
 
         break;
@@ -633,7 +757,7 @@ fmt_sprintf_state_produce_char(struct fmt_sprintf_state *state)
 {
     char c;
 
-    c = va_arg(state->ap, int);
+    c = fmt_sprintf_state_get_arg(state, int);
 
     if (!(state->flags & FMT_FORMAT_LEFT_JUSTIFY)) {
         for (;;) {
@@ -660,16 +784,196 @@ fmt_sprintf_state_produce_char(struct fmt_sprintf_state *state)
     }
 }
 
+static unsigned long
+fmt_word_load(const char *s)
+{
+    unsigned long word;
+
+    memcpy(&word, s, sizeof(word));
+    return word;
+}
+
+/*
+ * Return non-zero if any byte of the given word is less than n, which
+ * must not be greater than 128.
+ */
+static unsigned long
+fmt_word_has_less(unsigned long word, unsigned char n)
+{
+    return (word - (FMT_WORD_ONES * n)) & ~word & FMT_WORD_HIGHS;
+}
+
+static unsigned long
+fmt_word_has_byte(unsigned long word, unsigned char c)
+{
+    return fmt_word_has_less(word ^ (FMT_WORD_ONES * c), 1);
+}
+
+static bool
+fmt_escape_word_needed(unsigned long word, unsigned int escape)
+{
+    unsigned long needed;
+
+    needed = fmt_word_has_less(word, 0x20)
+             | fmt_word_has_byte(word, '"')
+             | fmt_word_has_byte(word, '\\');
+
+    if (escape == FMT_ESCAPE_C) {
+        needed |= fmt_word_has_byte(word, 0x7f) | (word & FMT_WORD_HIGHS);
+    }
+
+    return needed != 0;
+}
+
+static bool
+fmt_escape_needed(unsigned char c, unsigned int escape)
+{
+    if ((c < 0x20) || (c == '"') || (c == '\\')) {
+        return true;
+    }
+
+    return (escape == FMT_ESCAPE_C) && (c >= 0x7f);
+}
+
+static void
+fmt_sprintf_state_produce_escape(struct fmt_sprintf_state *state,
+                                 unsigned char c, unsigned int escape)
+{
+    char tmp[6];
+    size_t size;
+
+    tmp[0] = '\\';
+    size = 2;
+
+    switch (c) {
+    case '"':
+    case '\\':
+        tmp[1] = c;
+        break;
+    case '\b':
+        tmp[1] = 'b';
+        break;
+    case '\f':
+        tmp[1] = 'f';
+        break;
+    case '\n':
+        tmp[1] = 'n';
+        break;
+    case '\r':
+        tmp[1] = 'r';
+        break;
+    case '\t':
+        tmp[1] = 't';
+        break;
+    default:
+        if (escape == FMT_ESCAPE_JSON) {
+            tmp[1] = 'u';
+            tmp[2] = '0';
+            tmp[3] = '0';
+            tmp[4] = fmt_digits[c >> 4] | FMT_FORMAT_LOWER;
+            tmp[5] = fmt_digits[c & 0xf] | FMT_FORMAT_LOWER;
+            size = 6;
+        } else {
+            tmp[1] = '0' + (c >> 6);
+            tmp[2] = '0' + ((c >> 3) & 7);
+            tmp[3] = '0' + (c & 7);
+            size = 4;
+        }
+    }
+
+    fmt_sprintf_state_produce_raw(state, tmp, size);
+}
+
+static void
+fmt_sprintf_state_produce_hex(struct fmt_sprintf_state *state,
+                              const unsigned char *s, size_t size)
+{
+    char tmp[48];
+    size_t i, j;
+
+    j = 0;
+
+    for (i = 0; i < size; i++) {
+        if (j > (sizeof(tmp) - 3)) {
+            fmt_sprintf_state_produce_raw(state, tmp, j);
+            j = 0;
+        }
+
+        if (i != 0) {
+            tmp[j] = ' ';
+            j++;
+        }
+
+        tmp[j] = fmt_digits[s[i] >> 4] | FMT_FORMAT_LOWER;
+        tmp[j + 1] = fmt_digits[s[i] & 0xf] | FMT_FORMAT_LOWER;
+        j += 2;
+    }
+
+    fmt_sprintf_state_produce_raw(state, tmp, j);
+}
+
+/*
+ * Produce an escaped string.
+ *
+ * Characters that don't need escaping are copied in runs, which are found
+ * by scanning whole words where possible.
+ */
+static void
+fmt_sprintf_state_produce_escaped(struct fmt_sprintf_state *state,
+                                  const char *s)
+{
+    size_t i, run, size;
+    unsigned char c;
+
+    if (state->escape == FMT_ESCAPE_HEX) {
+        size = (state->precision < 0) ? 0 : state->precision;
+        fmt_sprintf_state_produce_hex(state, (const unsigned char *)s, size);
+        return;
+    }
+
+    size = (state->precision < 0) ? strlen(s) : strnlen(s, state->precision);
+    run = 0;
+    i = 0;
+
+    while (i < size) {
+        if (((size - i) >= sizeof(unsigned long))
+            && !fmt_escape_word_needed(fmt_word_load(&s[i]), state->escape)) {
+            i += sizeof(unsigned long);
+            continue;
+        }
+
+        c = s[i];
+
+        if (fmt_escape_needed(c, state->escape)) {
+            fmt_sprintf_state_produce_raw(state, &s[run], i - run);
+            fmt_sprintf_state_produce_escape(state, c, state->escape);
+            run = i + 1;
+        }
+
+        i++;
+    }
+
+    fmt_sprintf_state_produce_raw(state, &s[run], i - run);
+}
+
 static void
 fmt_sprintf_state_produce_str(struct fmt_sprintf_state *state)
 {
     int i, len;
     char *s;
 
-    s = va_arg(state->ap, char *);
+    if (state->args == NULL) {
+        s = va_arg(state->ap, char *);
+    } else {
+        s = (char *)state->args;
+        state->args += strlen(s) + 1;
+    }
 
     if (s == NULL) {
         s = "(null)";
+    } else if (state->escape != FMT_ESCAPE_NONE) {
+        fmt_sprintf_state_produce_escaped(state, s);
+        return;
     }
 
     for (len = 0; s[len] != '\0'; len++) {
@@ -699,6 +1003,11 @@ fmt_sprintf_state_produce_str(struct fmt_sprintf_state *state)
 static void
 fmt_sprintf_state_produce_nrchars(struct fmt_sprintf_state *state)
 {
+    /* Packed arguments never refer to objects of the caller */
+    if (state->args != NULL) {
+        return;
+    }
+
     if (state->modifier == FMT_MODIFIER_CHAR) {
         signed char *ptr = va_arg(state->ap, signed char *);
         *ptr = state->str - state->start;
@@ -778,27 +1087,381 @@ fmt_snprintf(char *str, size_t size, const char *format, ...)
     return length;
 }
 
+static void
+fmt_sprintf_state_run(struct fmt_sprintf_state *state)
+{
+    int error;
+
+    for (;;) {
+        error = fmt_sprintf_state_consume(state);
+
+        if (error == EAGAIN) {
+            continue;
+        } else if (error) {
+            break;
+        }
+
+        fmt_sprintf_state_produce(state);
+    }
+}
+
 int
 fmt_vsnprintf(char *str, size_t size, const char *format, va_list ap)
 {
     struct fmt_sprintf_state state;
-    int error;
 
     fmt_sprintf_state_init(&state, str, size, format, ap);
+    fmt_sprintf_state_run(&state);
+    return fmt_sprintf_state_finalize(&state);
+}
+
+int
+fmt_snprintf_packed(char *str, size_t size, const char *format,
+                    const void *args)
+{
+    struct fmt_sprintf_state state;
+
+    fmt_sprintf_state_init_packed(&state, str, size, format, args);
+    fmt_sprintf_state_run(&state);
+    return fmt_sprintf_state_finalize(&state);
+}
+
+char *
+fmt_spec_emit_raw(char *str, char *end, const char *s, size_t size)
+{
+    if (str < end) {
+        memcpy(str, s, MIN(size, (size_t)(end - str)));
+    }
+
+    return str + size;
+}
+
+char *
+fmt_spec_emit_char(char *str, char *end, char c)
+{
+    fmt_vsnprintf_produce(&str, end, c);
+    return str;
+}
+
+char *
+fmt_spec_emit_str(char *str, char *end, const char *s)
+{
+    if (s == NULL) {
+        s = "(null)";
+    }
+
+    return fmt_spec_emit_raw(str, end, s, strlen(s));
+}
+
+char *
+fmt_spec_emit_dec(char *str, char *end, long long n)
+{
+    if (n >= 0) {
+        return fmt_spec_emit_udec(str, end, n);
+    }
+
+    str = fmt_spec_emit_char(str, end, '-');
+    return fmt_spec_emit_udec(str, end, -(unsigned long long)n);
+}
+
+char *
+fmt_spec_emit_udec(char *str, char *end, unsigned long long n)
+{
+    char tmp[FMT_MAX_NUM_SIZE];
+    size_t i;
+
+    /* Conversion, in reverse order */
+
+    i = sizeof(tmp);
+
+    do {
+        i--;
+        tmp[i] = fmt_digits[n % 10];
+        n /= 10;
+    } while (n != 0);
+
+    return fmt_spec_emit_raw(str, end, &tmp[i], sizeof(tmp) - i);
+}
+
+char *
+fmt_spec_emit_hex(char *str, char *end, unsigned long long n, bool upper)
+{
+    char tmp[FMT_MAX_NUM_SIZE];
+    unsigned int lower;
+    size_t i;
+
+    lower = upper ? 0 : FMT_FORMAT_LOWER;
+    i = sizeof(tmp);
+
+    do {
+        i--;
+        tmp[i] = fmt_digits[n & 0xf] | lower;
+        n >>= 4;
+    } while (n != 0);
+
+    return fmt_spec_emit_raw(str, end, &tmp[i], sizeof(tmp) - i);
+}
+
+char *
+fmt_spec_emit_ptr(char *str, char *end, uintptr_t ptr)
+{
+    str = fmt_spec_emit_raw(str, end, "0x", STRLEN("0x"));
+    return fmt_spec_emit_hex(str, end, ptr, false);
+}
+
+static int
+fmt_args_add_common(struct fmt_args *args, unsigned char type, int precision)
+{
+    if (args->nr_args == ARRAY_SIZE(args->types)) {
+        return E2BIG;
+    }
+
+    args->types[args->nr_args] = type;
+    args->precisions[args->nr_args] = precision;
+    args->nr_args++;
+    return 0;
+}
+
+static int
+fmt_args_add(struct fmt_args *args, unsigned char type)
+{
+    return fmt_args_add_common(args, type, -1);
+}
+
+static unsigned char
+fmt_args_get_int_type(unsigned int modifier)
+{
+    switch (modifier) {
+    case FMT_MODIFIER_LONG:
+        return FMT_ARG_LONG;
+    case FMT_MODIFIER_LONGLONG:
+        return FMT_ARG_LONGLONG;
+    case FMT_MODIFIER_PTR:
+        return FMT_ARG_PTR;
+    case FMT_MODIFIER_SIZE:
+        return FMT_ARG_SIZE;
+    case FMT_MODIFIER_PTRDIFF:
+        return FMT_ARG_PTRDIFF;
+    default:
+        return FMT_ARG_INT;
+    }
+}
+
+/*
+ * Consume a field width or precision given as an argument, if any.
+ *
+ * This prevents the regular parsing functions from fetching a value
+ * from the uninitialized va_list object.
+ */
+static int
+fmt_args_consume_star(struct fmt_args *args, struct fmt_sprintf_state *state,
+                      const char *prefix, bool *foundp)
+{
+    size_t size;
+
+    size = strlen(prefix);
+    *foundp = (strncmp(state->format, prefix, size) == 0)
+              && (state->format[size] == '*');
+
+    if (!*foundp) {
+        return 0;
+    }
+
+    state->format += size + 1;
+    return fmt_args_add(args, FMT_ARG_INT);
+}
+
+int
+fmt_args_compile(struct fmt_args *args, const char *format)
+{
+    struct fmt_sprintf_state state;
+    bool star_precision, found;
+    int error, precision;
+    char c;
+
+    state.format = format;
+    args->nr_args = 0;
 
     for (;;) {
-        error = fmt_sprintf_state_consume(&state);
+        c = fmt_sprintf_state_consume_format(&state);
 
-        if (error == EAGAIN) {
+        if (c == '\0') {
+            break;
+        } else if (c != '%') {
             continue;
-        } else if (error) {
+        }
+
+        fmt_sprintf_state_consume_flags(&state);
+
+        error = fmt_args_consume_star(args, &state, "", &found);
+
+        if (error) {
+            return error;
+        }
+
+        fmt_sprintf_state_consume_width(&state);
+
+        error = fmt_args_consume_star(args, &state, ".", &star_precision);
+
+        if (error) {
+            return error;
+        }
+
+        fmt_sprintf_state_consume_precision(&state);
+        fmt_sprintf_state_consume_modifier(&state);
+        fmt_sprintf_state_consume_specifier(&state);
+
+        switch (state.specifier) {
+        case FMT_SPECIFIER_INT:
+            error = fmt_args_add(args, fmt_args_get_int_type(state.modifier));
+            break;
+        case FMT_SPECIFIER_CHAR:
+            error = fmt_args_add(args, FMT_ARG_INT);
             break;
+        case FMT_SPECIFIER_STR:
+            precision = star_precision
+                        ? FMT_ARGS_PRECISION_STAR
+                        : state.precision;
+            error = (state.escape == FMT_ESCAPE_HEX)
+                    ? EINVAL
+                    : fmt_args_add_common(args, FMT_ARG_STR, precision);
+            break;
+        case FMT_SPECIFIER_NRCHARS:
+            error = EINVAL;
+            break;
+        default:
+            error = 0;
         }
 
-        fmt_sprintf_state_produce(&state);
+        if (error) {
+            return error;
+        }
     }
 
-    return fmt_sprintf_state_finalize(&state);
+    return 0;
+}
+
+static int
+fmt_args_push(char **bufp, const char *end, const void *arg, size_t size)
+{
+    if (size > (size_t)(end - *bufp)) {
+        return EMSGSIZE;
+    }
+
+    memcpy(*bufp, arg, size);
+    *bufp += size;
+    return 0;
+}
+
+/*
+ * Push the given number of bytes of a string, followed by a null
+ * character, so that strings that aren't null-terminated within their
+ * precision are never read past it.
+ */
+static int
+fmt_args_push_str(char **bufp, const char *end, const char *s, size_t size)
+{
+    if (size >= (size_t)(end - *bufp)) {
+        return EMSGSIZE;
+    }
+
+    memcpy(*bufp, s, size);
+    (*bufp)[size] = '\0';
+    *bufp += size + 1;
+    return 0;
+}
+
+#define fmt_args_push_arg(bufp, end, ap, type)      \
+MACRO_BEGIN                                         \
+    type arg_;                                      \
+                                                    \
+    arg_ = va_arg(ap, type);                        \
+    fmt_args_push(bufp, end, &arg_, sizeof(arg_));  \
+MACRO_END
+
+int
+fmt_args_pack(const struct fmt_args *args, void *buf, size_t *sizep, ...)
+{
+    va_list ap;
+    int error;
+
+    va_start(ap, sizep);
+    error = fmt_args_vpack(args, buf, sizep, ap);
+    va_end(ap);
+
+    return error;
+}
+
+int
+fmt_args_vpack(const struct fmt_args *args, void *buf, size_t *sizep,
+               va_list ap)
+{
+    int error, prev_int, precision;
+    const char *end, *s;
+    unsigned int i;
+    va_list ap2;
+    size_t size;
+    char *ptr;
+
+    ptr = buf;
+    end = ptr + *sizep;
+    error = 0;
+    prev_int = 0;
+    va_copy(ap2, ap);
+
+    for (i = 0; i < args->nr_args; i++) {
+        switch (args->types[i]) {
+        case FMT_ARG_INT:
+            prev_int = va_arg(ap2, int);
+            error = fmt_args_push(&ptr, end, &prev_int, sizeof(prev_int));
+            break;
+        case FMT_ARG_LONG:
+            error = fmt_args_push_arg(&ptr, end, ap2, long);
+            break;
+        case FMT_ARG_LONGLONG:
+            error = fmt_args_push_arg(&ptr, end, ap2, long long);
+            break;
+        case FMT_ARG_PTR:
+            error = fmt_args_push_arg(&ptr, end, ap2, void *);
+            break;
+        case FMT_ARG_SIZE:
+            error = fmt_args_push_arg(&ptr, end, ap2, size_t);
+            break;
+        case FMT_ARG_PTRDIFF:
+            error = fmt_args_push_arg(&ptr, end, ap2, ptrdiff_t);
+            break;
+        case FMT_ARG_STR:
+            s = va_arg(ap2, const char *);
+
+            if (s == NULL) {
+                s = "(null)";
+            }
+
+            precision = args->precisions[i];
+
+            /*
+             * A precision given as an argument is the argument that
+             * immediately precedes the string.
+             */
+            if (precision == FMT_ARGS_PRECISION_STAR) {
+                precision = (prev_int < 0) ? 0 : prev_int;
+            }
+
+            size = (precision < 0) ? strlen(s) : strnlen(s, precision);
+            error = fmt_args_push_str(&ptr, end, s, size);
+            break;
+        default:
+            assert(!"invalid argument type");
+        }
+
+        if (error) {
+            break;
+        }
+    }
+
+    va_end(ap2);
+    *sizep = ptr - (char *)buf;
+    return error;
 }
 
 static char
@@ -829,34 +1492,75 @@ fmt_isspace(char c)
     return false;
 }
 
+/*
+ * Skip white spaces, not going beyond end unless it's NULL.
+ */
 static void
-fmt_skip(const char **strp)
+fmt_skip(const char **strp, const char *end)
 {
-    while (fmt_isspace(**strp)) {
+    while (((end == NULL) || (*strp < end)) && fmt_isspace(**strp)) {
         (*strp)++;
     }
 }
 
 static void
-fmt_sscanf_state_init(struct fmt_sscanf_state *state, const char *str,
-                      const char *format, va_list ap)
+fmt_sscanf_state_init_common(struct fmt_sscanf_state *state,
+                             const char *str, const char *end)
 {
     state->str = str;
     state->start = str;
-    state->format = format;
+    state->end = end;
+    state->format = NULL;
     state->flags = 0;
     state->width = 0;
-    va_copy(state->ap, ap);
     state->nr_convs = 0;
 }
 
+static void
+fmt_sscanf_state_init(struct fmt_sscanf_state *state, const char *str,
+                      const char *format, va_list ap)
+{
+    fmt_sscanf_state_init_common(state, str, NULL);
+    state->format = format;
+    va_copy(state->ap, ap);
+    state->obj = NULL;
+}
+
+static void
+fmt_sscanf_state_init_obj(struct fmt_sscanf_state *state,
+                          const char *str, const char *end,
+                          void *obj, const size_t *offsets)
+{
+    fmt_sscanf_state_init_common(state, str, end);
+    state->obj = obj;
+    state->offsets = offsets;
+    state->arg_index = 0;
+}
+
 static int
 fmt_sscanf_state_finalize(struct fmt_sscanf_state *state)
 {
-    va_end(state->ap);
+    if (state->obj == NULL) {
+        va_end(state->ap);
+    }
+
     return state->nr_convs;
 }
 
+static void *
+fmt_sscanf_state_get_arg(struct fmt_sscanf_state *state)
+{
+    void *arg;
+
+    if (state->obj == NULL) {
+        return va_arg(state->ap, void *);
+    }
+
+    arg = state->obj + state->offsets[state->arg_index];
+    state->arg_index++;
+    return arg;
+}
+
 static void
 fmt_sscanf_state_report_conv(struct fmt_sscanf_state *state)
 {
@@ -881,7 +1585,7 @@ fmt_sscanf_state_report_error(struct fmt_sscanf_state *state)
 static void
 fmt_sscanf_state_skip_space(struct fmt_sscanf_state *state)
 {
-    fmt_skip(&state->str);
+    fmt_skip(&state->str, state->end);
 }
 
 static int
@@ -889,7 +1593,16 @@ fmt_sscanf_state_consume_string(struct fmt_sscanf_state *state)
 {
     int c;
 
-    c = fmt_consume(&state->str);
+    /*
+     * Past the end of the string, act as if a null character was found,
+     * but still advance so that restoring remains consistent.
+     */
+    if ((state->end == NULL) || (state->str < state->end)) {
+        c = fmt_consume(&state->str);
+    } else {
+        c = '\0';
+        state->str++;
+    }
 
     if (state->flags & FMT_FORMAT_CHECK_WIDTH) {
         if (state->width == 0) {
@@ -1115,6 +1828,7 @@ fmt_sscanf_state_produce_int(struct fmt_sscanf_state *state)
     unsigned long long n, m, tmp;
     char buf[FMT_MAX_NUM_SIZE];
     bool negative;
+    void *ptr;
     size_t i;
     int c;
 
@@ -1154,6 +1868,10 @@ fmt_sscanf_state_produce_int(struct fmt_sscanf_state *state)
         }
     }
 
+    if (state->base == 0) {
+        state->base = 10;
+    }
+
     i = 0;
 
     while (c != '\0') {
@@ -1257,53 +1975,55 @@ fmt_sscanf_state_produce_int(struct fmt_sscanf_state *state)
         n = -n;
     }
 
+    ptr = fmt_sscanf_state_get_arg(state);
+
     switch (state->modifier) {
     case FMT_MODIFIER_CHAR:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            *va_arg(state->ap, char *) = n;
+            *(char *)ptr = n;
         } else {
-            *va_arg(state->ap, unsigned char *) = n;
+            *(unsigned char *)ptr = n;
         }
 
         break;
     case FMT_MODIFIER_SHORT:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            *va_arg(state->ap, short *) = n;
+            *(short *)ptr = n;
         } else {
-            *va_arg(state->ap, unsigned short *) = n;
+            *(unsigned short *)ptr = n;
         }
 
         break;
     case FMT_MODIFIER_LONG:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            *va_arg(state->ap, long *) = n;
+            *(long *)ptr = n;
         } else {
-            *va_arg(state->ap, unsigned long *) = n;
+            *(unsigned long *)ptr = n;
         }
 
         break;
     case FMT_MODIFIER_LONGLONG:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            *va_arg(state->ap, long long *) = n;
+            *(long long *)ptr = n;
         } else {
-            *va_arg(state->ap, unsigned long long *) = n;
+            *(unsigned long long *)ptr = n;
         }
 
         break;
     case FMT_MODIFIER_PTR:
-        *va_arg(state->ap, uintptr_t *) = n;
+        *(uintptr_t *)ptr = n;
         break;
     case FMT_MODIFIER_SIZE:
-        *va_arg(state->ap, size_t *) = n;
+        *(size_t *)ptr = n;
         break;
     case FMT_MODIFIER_PTRDIFF:
-        *va_arg(state->ap, ptrdiff_t *) = n;
+        *(ptrdiff_t *)ptr = n;
         break;
     default:
         if (state->flags & FMT_FORMAT_CONV_SIGNED) {
-            *va_arg(state->ap, int *) = n;
+            *(int *)ptr = n;
         } else {
-            *va_arg(state->ap, unsigned int *) = n;
+            *(unsigned int *)ptr = n;
         }
     }
 
@@ -1320,7 +2040,7 @@ fmt_sscanf_state_produce_char(struct fmt_sscanf_state *state)
     if (state->flags & FMT_FORMAT_DISCARD) {
         dest = NULL;
     } else {
-        dest = va_arg(state->ap, char *);
+        dest = fmt_sscanf_state_get_arg(state);
     }
 
     if (state->flags & FMT_FORMAT_CHECK_WIDTH) {
@@ -1367,7 +2087,7 @@ fmt_sscanf_state_produce_str(struct fmt_sscanf_state *state)
     if (state->flags & FMT_FORMAT_DISCARD) {
         dest = NULL;
     } else {
-        dest = va_arg(state->ap, char *);
+        dest = fmt_sscanf_state_get_arg(state);
     }
 
     for (;;) {
@@ -1401,7 +2121,10 @@ fmt_sscanf_state_produce_str(struct fmt_sscanf_state *state)
 static int
 fmt_sscanf_state_produce_nrchars(struct fmt_sscanf_state *state)
 {
-    *va_arg(state->ap, int *) = state->str - state->start;
+    int *ptr;
+
+    ptr = fmt_sscanf_state_get_arg(state);
+    *ptr = state->str - state->start;
     return 0;
 }
 
@@ -1465,3 +2188,203 @@ fmt_vsscanf(const char *str, const char *format, va_list ap)
 
     return fmt_sscanf_state_finalize(&state);
 }
+
+static void
+fmt_scan_directive_init_conv(struct fmt_scan_directive *directive,
+                             const struct fmt_sscanf_state *state)
+{
+    directive->type = FMT_SCAN_CONV;
+    directive->str = NULL;
+    directive->width = state->width;
+    directive->flags = state->flags;
+    directive->modifier = state->modifier;
+    directive->specifier = state->specifier;
+    directive->base = state->base;
+}
+
+static bool
+fmt_scan_directive_is_literal(char c)
+{
+    return (c != '\0') && (c != '%') && !fmt_isspace(c);
+}
+
+int
+fmt_scan_compile(struct fmt_scan *scan, const char *format)
+{
+    struct fmt_scan_directive *directive;
+    struct fmt_sscanf_state state;
+    char c;
+
+    state.format = format;
+    scan->nr_directives = 0;
+    scan->nr_convs = 0;
+    scan->nr_args = 0;
+
+    for (;;) {
+        c = fmt_sscanf_state_consume_format(&state);
+
+        if (c == '\0') {
+            break;
+        }
+
+        if (scan->nr_directives == ARRAY_SIZE(scan->directives)) {
+            return E2BIG;
+        }
+
+        directive = &scan->directives[scan->nr_directives];
+        scan->nr_directives++;
+
+        if (fmt_isspace(c)) {
+            directive->type = FMT_SCAN_SPACE;
+            fmt_skip(&state.format, NULL);
+            continue;
+        }
+
+        if (c != '%') {
+            directive->type = FMT_SCAN_LITERAL;
+            directive->str = state.format - 1;
+
+            while (fmt_scan_directive_is_literal(*state.format)) {
+                state.format++;
+            }
+
+            directive->width = state.format - directive->str;
+            continue;
+        }
+
+        state.flags = 0;
+        fmt_sscanf_state_consume_flags(&state);
+        fmt_sscanf_state_consume_width(&state);
+        fmt_sscanf_state_consume_modifier(&state);
+        fmt_sscanf_state_consume_specifier(&state);
+
+        if (state.specifier == FMT_SPECIFIER_INVALID) {
+            return EINVAL;
+        }
+
+        fmt_scan_directive_init_conv(directive, &state);
+
+        if (state.specifier == FMT_SPECIFIER_NRCHARS) {
+            scan->nr_args++;
+        } else if ((state.specifier != FMT_SPECIFIER_PERCENT)
+                   && !(state.flags & FMT_FORMAT_DISCARD)) {
+            scan->nr_args++;
+            scan->nr_convs++;
+        }
+    }
+
+    return 0;
+}
+
+static int
+fmt_sscanf_state_run(struct fmt_sscanf_state *state,
+                     const struct fmt_scan *scan)
+{
+    const struct fmt_scan_directive *directive;
+    unsigned int i;
+    int j, error;
+
+    for (i = 0; i < scan->nr_directives; i++) {
+        directive = &scan->directives[i];
+
+        switch (directive->type) {
+        case FMT_SCAN_SPACE:
+            fmt_sscanf_state_skip_space(state);
+            break;
+        case FMT_SCAN_LITERAL:
+            state->flags = 0;
+
+            for (j = 0; j < directive->width; j++) {
+                error = fmt_sscanf_state_discard_char(state,
+                                                      directive->str[j]);
+
+                if (error) {
+                    return error;
+                }
+            }
+
+            break;
+        default:
+            state->flags = directive->flags;
+            state->width = directive->width;
+            state->modifier = directive->modifier;
+            state->specifier = directive->specifier;
+            state->base = directive->base;
+
+            error = fmt_sscanf_state_produce(state);
+
+            if (error) {
+                return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int
+fmt_scan_sscanf(const struct fmt_scan *scan, const char *str, ...)
+{
+    va_list ap;
+    int ret;
+
+    va_start(ap, str);
+    ret = fmt_scan_vsscanf(scan, str, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+int
+fmt_scan_vsscanf(const struct fmt_scan *scan, const char *str, va_list ap)
+{
+    struct fmt_sscanf_state state;
+
+    fmt_sscanf_state_init(&state, str, NULL, ap);
+    fmt_sscanf_state_run(&state, scan);
+    return fmt_sscanf_state_finalize(&state);
+}
+
+int
+fmt_scan_lines(const struct fmt_scan *scan, const char *buf, size_t *sizep,
+               void *objs, size_t obj_size, size_t *nr_objsp,
+               const size_t *offsets)
+{
+    struct fmt_sscanf_state state;
+    const char *line, *end, *buf_end;
+    int error, nr_convs;
+    size_t i;
+
+    line = buf;
+    buf_end = buf + *sizep;
+    error = 0;
+
+    for (i = 0; i < *nr_objsp; i++) {
+        end = memchr(line, '\n', buf_end - line);
+
+        if (end == NULL) {
+            break;
+        }
+
+        fmt_sscanf_state_init_obj(&state, line, end,
+                                  (char *)objs + (i * obj_size), offsets);
+        error = fmt_sscanf_state_run(&state, scan);
+        nr_convs = fmt_sscanf_state_finalize(&state);
+        fmt_sscanf_state_skip_space(&state);
+
+        /*
+         * A literal mismatch is an error even if the format has no
+         * conversion, and so is trailing text.
+         */
+        if (error || (nr_convs != scan->nr_convs) || (state.str != end)) {
+            error = EINVAL;
+            break;
+        }
+
+        line = end + 1;
+    }
+
+    *sizep = line - buf;
+    *nr_objsp = i;
+    return error;
+}
@@ -40,6 +40,30 @@
  * common:
  *  - modifiers: hh h l ll z t
  *  - specifiers: d i o u x X c s p n %
+ *
+ * In addition, sprintf supports the following escaping conversions, which
+ * take a pointer to the data to escape, and ignore flags and field width :
+ *  - %pJ: string escaped for inclusion in a JSON string
+ *  - %pE: string escaped for inclusion in a C string literal, non-printable
+ *    and non-ASCII characters being written as octal escape sequences
+ *  - %pH: hexadecimal dump of a byte range, bytes separated by spaces
+ * The precision is the maximum number of characters of a string to escape,
+ * and the number of bytes to dump, which defaults to zero, for %pH.
+ *
+ * Print format arguments may be packed into a buffer and formatted later,
+ * e.g. to move formatting out of the path of a time-sensitive producer.
+ * Strings are copied when packed, including those escaped with %pJ and %pE,
+ * which must then be null-terminated. The %n and %pH specifiers aren't
+ * supported in this case.
+ *
+ * Scan formats may also be compiled once and applied many times, which
+ * saves parsing the format string on every call. Compiled formats can
+ * be applied to buffers of newline-separated records, storing the
+ * results in arrays of structures.
+ *
+ * Finally, snprintf-like calls with constant formats may be specialized at
+ * compile time, turning simple conversions into direct calls to integer and
+ * string emitters.
  */
 
 #ifndef FMT_H
@@ -48,6 +72,18 @@
 #include <stdarg.h>
 #include <stddef.h>
 
+/*
+ * Compiled print format, used to pack arguments.
+ */
+struct fmt_args;
+
+/*
+ * Compiled scan format.
+ */
+struct fmt_scan;
+
+#include "fmt_i.h"
+
 int fmt_sprintf(char *str, const char *format, ...)
     __attribute__((format(printf, 2, 3)));
 
@@ -60,10 +96,112 @@ int fmt_snprintf(char *str, size_t size, const char *format, ...)
 int fmt_vsnprintf(char *str, size_t size, const char *format, va_list ap)
     __attribute__((format(printf, 3, 0)));
 
+/*
+ * snprintf-like macro, specialized for constant formats.
+ *
+ * When the format is a string literal made of ordinary characters and
+ * conversion specifications without flags, field width or precision, using
+ * the d, i, u, x and X specifiers with any modifier, or the c, s, p and %
+ * specifiers without modifier, the call is expanded at compile time into
+ * direct calls to emitters, with no argument list processing. Otherwise,
+ * including when the format is too long, it falls back to fmt_snprintf().
+ * Note that the expansion relies on constant folding, and is only efficient
+ * when building with optimizations.
+ *
+ * Arguments are checked against the format as for fmt_snprintf(). At most
+ * FMT_SPEC_MAX_ARGS arguments may be passed.
+ */
+#define fmt_snprintf_spec(str, size, format, ...)                       \
+    ((__builtin_constant_p(format) && fmt_spec_simple(format))          \
+     ? fmt_spec_snprintf(str, size, format,                             \
+                         (const unsigned long long[]) {                 \
+                             FMT_SPEC_ARGS(__VA_ARGS__) 0               \
+                         })                                             \
+     : fmt_snprintf(str, size, format, ## __VA_ARGS__))
+
+/*
+ * Compile a print format for argument packing.
+ *
+ * If the format contains the %n or %pH specifiers, EINVAL is returned. If it
+ * consumes too many arguments, E2BIG is returned.
+ */
+int fmt_args_compile(struct fmt_args *args, const char *format);
+
+/*
+ * Pack arguments according to a compiled print format.
+ *
+ * On entry, the sizep argument points to the size of the output buffer.
+ * On return, it is updated to the size of the packed arguments. If the
+ * arguments don't fit in the output buffer, EMSGSIZE is returned.
+ */
+int fmt_args_pack(const struct fmt_args *args, void *buf, size_t *sizep, ...);
+int fmt_args_vpack(const struct fmt_args *args, void *buf, size_t *sizep,
+                   va_list ap);
+
+/*
+ * snprintf-like function using packed arguments.
+ *
+ * The format must be the one used to compile the print format with which
+ * the arguments were packed.
+ */
+int fmt_snprintf_packed(char *str, size_t size, const char *format,
+                        const void *args);
+
 int fmt_sscanf(const char *str, const char *format, ...)
     __attribute__((format(scanf, 2, 3)));
 
 int fmt_vsscanf(const char *str, const char *format, va_list ap)
     __attribute__((format(scanf, 2, 0)));
 
+/*
+ * Compile a scan format.
+ *
+ * The format string must persist in memory as long as the compiled format
+ * is used.
+ *
+ * If the format contains an invalid conversion specification, EINVAL is
+ * returned. If it's too complex to be compiled, E2BIG is returned.
+ */
+int fmt_scan_compile(struct fmt_scan *scan, const char *format);
+
+/*
+ * Return the number of pointer arguments consumed by a compiled format.
+ */
+static inline unsigned int
+fmt_scan_nr_args(const struct fmt_scan *scan)
+{
+    return scan->nr_args;
+}
+
+/*
+ * sscanf-like functions using a compiled format.
+ */
+int fmt_scan_sscanf(const struct fmt_scan *scan, const char *str, ...);
+int fmt_scan_vsscanf(const struct fmt_scan *scan, const char *str,
+                     va_list ap);
+
+/*
+ * Scan newline-separated records using a compiled format.
+ *
+ * On entry, the sizep argument points to the size of the input buffer,
+ * and the nr_objsp argument to the number of objects in the output array,
+ * each obj_size bytes large. For each record, the result of the i-th
+ * argument-consuming conversion is stored at offsets[i] bytes from the
+ * start of the matching object. The offsets array must contain
+ * fmt_scan_nr_args() entries.
+ *
+ * Only complete records, i.e. terminated by a newline character, are
+ * scanned, so that an incomplete record at the end of the buffer can be
+ * retried once completed, e.g. when streaming from a circular buffer.
+ *
+ * On return, sizep is updated to the number of bytes consumed, and
+ * nr_objsp to the number of records scanned. If a record doesn't match
+ * the format, including its ordinary characters, or if it contains
+ * characters other than white space after the end of the format, scanning
+ * stops before that record and EINVAL is returned.
+ */
+int fmt_scan_lines(const struct fmt_scan *scan, const char *buf,
+                   size_t *sizep, void *objs, size_t obj_size,
+                   size_t *nr_objsp, const size_t *offsets);
+
 #endif /* FMT_H */
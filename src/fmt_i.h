@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#ifndef FMT_I_H
+#define FMT_I_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "macros.h"
+
+/*
+ * Maximum number of directives in a compiled scan format.
+ *
+ * A directive is either a run of white spaces, a run of ordinary
+ * characters, or a conversion specification.
+ */
+#define FMT_SCAN_MAX_DIRECTIVES 32
+
+/*
+ * Compiled scan directive.
+ *
+ * For ordinary character runs, the str member points to the first
+ * character of the run inside the original format string, and the
+ * width member is the length of the run.
+ */
+struct fmt_scan_directive {
+    const char *str;
+    int width;
+    unsigned short flags;
+    unsigned char type;
+    unsigned char modifier;
+    unsigned char specifier;
+    unsigned char base;
+};
+
+/*
+ * Compiled scan format.
+ *
+ * The nr_convs member is the number of conversions reported by a successful
+ * scan, and nr_args the number of pointer arguments the format consumes.
+ */
+struct fmt_scan {
+    unsigned int nr_directives;
+    int nr_convs;
+    unsigned int nr_args;
+    struct fmt_scan_directive directives[FMT_SCAN_MAX_DIRECTIVES];
+};
+
+/*
+ * Maximum number of arguments in a compiled print format.
+ */
+#define FMT_ARGS_MAX 16
+
+/*
+ * Precision of a string argument given by the preceding argument.
+ */
+#define FMT_ARGS_PRECISION_STAR -2
+
+/*
+ * Compiled print format.
+ *
+ * The types member describes how each argument is packed. For string
+ * arguments, the precisions member is the precision of the conversion,
+ * which bounds the number of bytes packed, or -1 if there is none.
+ */
+struct fmt_args {
+    unsigned int nr_args;
+    unsigned char types[FMT_ARGS_MAX];
+    int precisions[FMT_ARGS_MAX];
+};
+
+/*
+ * Maximum number of arguments of a specialized format.
+ *
+ * The number of steps of a specialized format is bounded by the expansion
+ * of FMT_SPEC_UNROLL(), where a step consumes either an ordinary character
+ * or a conversion specification.
+ */
+#define FMT_SPEC_MAX_ARGS   8
+
+enum {
+    FMT_SPEC_MODIFIER_NONE,
+    FMT_SPEC_MODIFIER_CHAR,
+    FMT_SPEC_MODIFIER_SHORT,
+    FMT_SPEC_MODIFIER_LONG,
+    FMT_SPEC_MODIFIER_LONGLONG,
+    FMT_SPEC_MODIFIER_SIZE,
+    FMT_SPEC_MODIFIER_PTRDIFF,
+};
+
+/*
+ * Specialized format state.
+ *
+ * Specialized formats are interpreted by a fixed sequence of inline steps.
+ * When the format is constant, the state never escapes, and the compiler
+ * folds the steps into direct calls to the emitters below.
+ *
+ * The lit member is the position of the first character of the pending run
+ * of ordinary characters.
+ */
+struct fmt_spec {
+    const char *format;
+    unsigned int pos;
+    unsigned int lit;
+    unsigned int arg;
+    bool done;
+    bool simple;
+    char *str;
+    char *start;
+    char *end;
+};
+
+/*
+ * Emitters.
+ *
+ * The output is written at str, but not beyond end, which may be NULL if
+ * nothing may be written. The return value is str advanced by the full
+ * length of the output, whether it was truncated or not.
+ *
+ * These functions are private.
+ */
+char * fmt_spec_emit_raw(char *str, char *end, const char *s, size_t size);
+char * fmt_spec_emit_char(char *str, char *end, char c);
+char * fmt_spec_emit_str(char *str, char *end, const char *s);
+char * fmt_spec_emit_dec(char *str, char *end, long long n);
+char * fmt_spec_emit_udec(char *str, char *end, unsigned long long n);
+char * fmt_spec_emit_hex(char *str, char *end, unsigned long long n,
+                         bool upper);
+char * fmt_spec_emit_ptr(char *str, char *end, uintptr_t ptr);
+
+#define FMT_SPEC_UNROLL4(expr)  expr; expr; expr; expr
+#define FMT_SPEC_UNROLL16(expr)                 \
+    FMT_SPEC_UNROLL4(expr);                     \
+    FMT_SPEC_UNROLL4(expr);                     \
+    FMT_SPEC_UNROLL4(expr);                     \
+    FMT_SPEC_UNROLL4(expr)
+#define FMT_SPEC_UNROLL(expr)                   \
+    FMT_SPEC_UNROLL16(expr);                    \
+    FMT_SPEC_UNROLL16(expr);                    \
+    FMT_SPEC_UNROLL16(expr);                    \
+    FMT_SPEC_UNROLL16(expr)
+
+/*
+ * Arguments are passed to specialized formats as an array of unsigned long
+ * long integers. Integer arguments are converted, which preserves their
+ * value once truncated back to the type given by the conversion
+ * specification, whereas pointers are converted through uintptr_t.
+ */
+#define fmt_spec_arg(x)                                 \
+    _Generic((x),                                       \
+             _Bool: (unsigned long long)(x),            \
+             char: (unsigned long long)(x),             \
+             signed char: (unsigned long long)(x),      \
+             unsigned char: (unsigned long long)(x),    \
+             short: (unsigned long long)(x),            \
+             unsigned short: (unsigned long long)(x),   \
+             int: (unsigned long long)(x),              \
+             unsigned int: (unsigned long long)(x),     \
+             long: (unsigned long long)(x),             \
+             unsigned long: (unsigned long long)(x),    \
+             long long: (unsigned long long)(x),        \
+             unsigned long long: (unsigned long long)(x), \
+             default: (unsigned long long)(uintptr_t)(x))
+
+#define FMT_SPEC_NR_ARGS(...) \
+    FMT_SPEC_NR_ARGS_(0, ## __VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define FMT_SPEC_NR_ARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+
+#define FMT_SPEC_CONCAT_(a, b)  a ## b
+#define FMT_SPEC_CONCAT(a, b)   FMT_SPEC_CONCAT_(a, b)
+
+/*
+ * Build the initializer list of an argument array, with a trailing comma.
+ */
+#define FMT_SPEC_ARGS(...) \
+    FMT_SPEC_CONCAT(FMT_SPEC_ARGS_, FMT_SPEC_NR_ARGS(__VA_ARGS__))(__VA_ARGS__)
+#define FMT_SPEC_ARGS_0()
+#define FMT_SPEC_ARGS_1(a)      fmt_spec_arg(a),
+#define FMT_SPEC_ARGS_2(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_1(__VA_ARGS__)
+#define FMT_SPEC_ARGS_3(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_2(__VA_ARGS__)
+#define FMT_SPEC_ARGS_4(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_3(__VA_ARGS__)
+#define FMT_SPEC_ARGS_5(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_4(__VA_ARGS__)
+#define FMT_SPEC_ARGS_6(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_5(__VA_ARGS__)
+#define FMT_SPEC_ARGS_7(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_6(__VA_ARGS__)
+#define FMT_SPEC_ARGS_8(a, ...) fmt_spec_arg(a), FMT_SPEC_ARGS_7(__VA_ARGS__)
+
+/*
+ * Parse the modifier of a conversion specification.
+ *
+ * The given format points to the character following the percent sign.
+ * Return the length of the modifier.
+ */
+static __always_inline unsigned int
+fmt_spec_parse_modifier(const char *format, unsigned int *modifierp)
+{
+    switch (format[0]) {
+    case 'h':
+        if (format[1] == 'h') {
+            *modifierp = FMT_SPEC_MODIFIER_CHAR;
+            return 2;
+        }
+
+        *modifierp = FMT_SPEC_MODIFIER_SHORT;
+        return 1;
+    case 'l':
+        if (format[1] == 'l') {
+            *modifierp = FMT_SPEC_MODIFIER_LONGLONG;
+            return 2;
+        }
+
+        *modifierp = FMT_SPEC_MODIFIER_LONG;
+        return 1;
+    case 'z':
+        *modifierp = FMT_SPEC_MODIFIER_SIZE;
+        return 1;
+    case 't':
+        *modifierp = FMT_SPEC_MODIFIER_PTRDIFF;
+        return 1;
+    default:
+        *modifierp = FMT_SPEC_MODIFIER_NONE;
+        return 0;
+    }
+}
+
+static __always_inline long long
+fmt_spec_get_signed(unsigned long long n, unsigned int modifier)
+{
+    switch (modifier) {
+    case FMT_SPEC_MODIFIER_CHAR:
+        return (signed char)n;
+    case FMT_SPEC_MODIFIER_SHORT:
+        return (short)n;
+    case FMT_SPEC_MODIFIER_LONG:
+        return (long)n;
+    case FMT_SPEC_MODIFIER_LONGLONG:
+        return (long long)n;
+    case FMT_SPEC_MODIFIER_SIZE:
+    case FMT_SPEC_MODIFIER_PTRDIFF:
+        return (ptrdiff_t)n;
+    default:
+        return (int)n;
+    }
+}
+
+static __always_inline unsigned long long
+fmt_spec_get_unsigned(unsigned long long n, unsigned int modifier)
+{
+    switch (modifier) {
+    case FMT_SPEC_MODIFIER_CHAR:
+        return (unsigned char)n;
+    case FMT_SPEC_MODIFIER_SHORT:
+        return (unsigned short)n;
+    case FMT_SPEC_MODIFIER_LONG:
+        return (unsigned long)n;
+    case FMT_SPEC_MODIFIER_LONGLONG:
+        return n;
+    case FMT_SPEC_MODIFIER_SIZE:
+    case FMT_SPEC_MODIFIER_PTRDIFF:
+        return (size_t)n;
+    default:
+        return (unsigned int)n;
+    }
+}
+
+static __always_inline void
+fmt_spec_check_step(struct fmt_spec *spec)
+{
+    unsigned int modifier, length;
+    const char *format;
+
+    if (spec->done) {
+        return;
+    }
+
+    format = &spec->format[spec->pos];
+
+    if (format[0] == '\0') {
+        spec->done = true;
+        return;
+    } else if (format[0] != '%') {
+        spec->pos++;
+        return;
+    }
+
+    length = fmt_spec_parse_modifier(&format[1], &modifier);
+
+    switch (format[1 + length]) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 'X':
+        break;
+    case 'p':
+        if ((format[2] == 'J') || (format[2] == 'E') || (format[2] == 'H')) {
+            spec->simple = false;
+            spec->done = true;
+            return;
+        }
+
+        __fallthrough;
+    case 'c':
+    case 's':
+    case '%':
+        if (modifier == FMT_SPEC_MODIFIER_NONE) {
+            break;
+        }
+
+        __fallthrough;
+    default:
+        spec->simple = false;
+        spec->done = true;
+        return;
+    }
+
+    spec->pos += 2 + length;
+}
+
+/*
+ * Return true if a format can be specialized.
+ *
+ * Only ordinary characters and conversion specifications without flags,
+ * field width or precision are allowed.
+ */
+static __always_inline bool
+fmt_spec_simple(const char *format)
+{
+    struct fmt_spec spec;
+
+    spec.format = format;
+    spec.pos = 0;
+    spec.done = false;
+    spec.simple = true;
+
+    FMT_SPEC_UNROLL(fmt_spec_check_step(&spec));
+
+    return spec.done && spec.simple;
+}
+
+static __always_inline void
+fmt_spec_step(struct fmt_spec *spec, const unsigned long long *args)
+{
+    unsigned int modifier, length;
+    const char *format;
+    char *str, *end;
+
+    if (spec->done) {
+        return;
+    }
+
+    format = &spec->format[spec->pos];
+
+    if ((format[0] != '\0') && (format[0] != '%')) {
+        spec->pos++;
+        return;
+    }
+
+    str = spec->str;
+    end = spec->end;
+
+    if (spec->lit != spec->pos) {
+        str = fmt_spec_emit_raw(str, end, &spec->format[spec->lit],
+                                spec->pos - spec->lit);
+    }
+
+    if (format[0] == '\0') {
+        spec->str = str;
+        spec->done = true;
+        return;
+    }
+
+    length = fmt_spec_parse_modifier(&format[1], &modifier);
+
+    switch (format[1 + length]) {
+    case 'd':
+    case 'i':
+        str = fmt_spec_emit_dec(str, end,
+                                fmt_spec_get_signed(args[spec->arg],
+                                                    modifier));
+        spec->arg++;
+        break;
+    case 'u':
+        str = fmt_spec_emit_udec(str, end,
+                                 fmt_spec_get_unsigned(args[spec->arg],
+                                                       modifier));
+        spec->arg++;
+        break;
+    case 'x':
+    case 'X':
+        str = fmt_spec_emit_hex(str, end,
+                                fmt_spec_get_unsigned(args[spec->arg],
+                                                      modifier),
+                                format[1 + length] == 'X');
+        spec->arg++;
+        break;
+    case 'c':
+        str = fmt_spec_emit_char(str, end, (char)args[spec->arg]);
+        spec->arg++;
+        break;
+    case 's':
+        str = fmt_spec_emit_str(str, end,
+                                (const char *)(uintptr_t)args[spec->arg]);
+        spec->arg++;
+        break;
+    case 'p':
+        str = fmt_spec_emit_ptr(str, end, (uintptr_t)args[spec->arg]);
+        spec->arg++;
+        break;
+    default:
+        str = fmt_spec_emit_char(str, end, '%');
+        break;
+    }
+
+    spec->str = str;
+    spec->pos += 2 + length;
+    spec->lit = spec->pos;
+}
+
+/*
+ * Format a specialized format.
+ *
+ * The format must have been accepted by fmt_spec_simple().
+ */
+static __always_inline int
+fmt_spec_snprintf(char *str, size_t size, const char *format,
+                  const unsigned long long *args)
+{
+    struct fmt_spec spec;
+
+    spec.format = format;
+    spec.pos = 0;
+    spec.lit = 0;
+    spec.arg = 0;
+    spec.done = false;
+    spec.str = str;
+    spec.start = str;
+    spec.end = (size == 0) ? NULL : str + size - 1;
+
+    FMT_SPEC_UNROLL(fmt_spec_step(&spec, args));
+
+    if (spec.str < spec.end) {
+        *spec.str = '\0';
+    } else if (spec.end != NULL) {
+        *spec.end = '\0';
+    }
+
+    return spec.str - spec.start;
+}
+
+#endif /* FMT_I_H */
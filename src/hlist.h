@@ -33,6 +33,7 @@
 #include <stddef.h>
 
 #include "macros.h"
+#include "rcu.h"
 
 /*
  * List node.
@@ -283,13 +284,6 @@ for (entry = hlist_first_entry(list, typeof(*entry), member),           \
  * The hlist_end() function may be used from read-side critical sections.
  */
 
-/*
- * These macros can be replaced by actual functions in an environment
- * that provides lockless synchronization such as RCU.
- */
-#define rcu_store_ptr(ptr, value)       ((ptr) = (value))
-#define rcu_load_ptr(ptr)               (ptr)
-
 /*
  * Return the first node of a list.
  */
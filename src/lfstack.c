@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lfstack.h"
+#include "macros.h"
+#include "slist.h"
+
+void
+lfstack_init(struct lfstack *stack)
+{
+    struct lfstack_top top;
+
+    top.node = NULL;
+    top.gen = 0;
+    atomic_init(&stack->top, top);
+}
+
+void
+lfstack_push(struct lfstack *stack, struct slist_node *node)
+{
+    struct lfstack_top top, new_top;
+
+    top = atomic_load_explicit(&stack->top, memory_order_relaxed);
+    new_top.node = node;
+
+    do {
+        __atomic_store_n(&node->next, top.node, __ATOMIC_RELAXED);
+        new_top.gen = top.gen + 1;
+    } while (!atomic_compare_exchange_weak_explicit(&stack->top, &top,
+                                                    new_top,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+struct slist_node *
+lfstack_pop(struct lfstack *stack)
+{
+    struct lfstack_top top, new_top;
+
+    top = atomic_load_explicit(&stack->top, memory_order_acquire);
+
+    do {
+        if (top.node == NULL) {
+            return NULL;
+        }
+
+        /*
+         * The node may have been popped and its next pointer changed since
+         * the top was read, in which case the generation has changed too,
+         * and the compare-and-swap fails.
+         */
+        new_top.node = __atomic_load_n(&top.node->next, __ATOMIC_RELAXED);
+        new_top.gen = top.gen + 1;
+    } while (!atomic_compare_exchange_weak_explicit(&stack->top, &top,
+                                                    new_top,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+
+    return top.node;
+}
+
+void
+lfstack_pop_all(struct lfstack *stack, struct slist *list)
+{
+    struct lfstack_top top, new_top;
+    struct slist_node *node;
+    struct slist tmp;
+
+    top = atomic_load_explicit(&stack->top, memory_order_acquire);
+    new_top.node = NULL;
+
+    do {
+        if (top.node == NULL) {
+            return;
+        }
+
+        new_top.gen = top.gen + 1;
+    } while (!atomic_compare_exchange_weak_explicit(&stack->top, &top,
+                                                    new_top,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+
+    node = top.node;
+
+    while (node->next != NULL) {
+        node = node->next;
+    }
+
+    tmp.first = top.node;
+    tmp.last = node;
+    slist_concat(list, &tmp);
+}
+
+bool
+lfstack_empty(struct lfstack *stack)
+{
+    struct lfstack_top top;
+
+    top = atomic_load_explicit(&stack->top, memory_order_relaxed);
+    return top.node == NULL;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Lock-free stack.
+ *
+ * This intrusive stack of singly-linked list nodes is a Treiber stack,
+ * where the top pointer is paired with a generation counter incremented
+ * on every update, and both are atomically updated with a double-width
+ * compare-and-swap. This prevents the ABA problem, where a pop operation
+ * would succeed after the top node was popped and pushed again, and the
+ * next node it read was stale.
+ *
+ * Popping reads the node at the top of the stack, which may concurrently
+ * be popped by another thread. As a result, the memory of nodes must
+ * remain accessible as long as the stack is used, which is normally the
+ * case with object pools.
+ *
+ * Double-width atomic operations are provided by libatomic, which uses
+ * lock-free instructions when the processor supports them, e.g. cmpxchg16b
+ * on x86_64.
+ */
+
+#ifndef LFSTACK_H
+#define LFSTACK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "macros.h"
+#include "slist.h"
+
+/*
+ * Top of a stack.
+ */
+struct lfstack_top {
+    struct slist_node *node;
+    uintptr_t gen;
+} __attribute__((aligned(2 * sizeof(uintptr_t))));
+
+/*
+ * Lock-free stack.
+ */
+struct lfstack {
+    _Atomic struct lfstack_top top;
+};
+
+/*
+ * Initialize a stack.
+ */
+void lfstack_init(struct lfstack *stack);
+
+/*
+ * Push a node on a stack.
+ */
+void lfstack_push(struct lfstack *stack, struct slist_node *node);
+
+/*
+ * Pop the node at the top of a stack.
+ *
+ * If the stack is empty, NULL is returned.
+ */
+struct slist_node * lfstack_pop(struct lfstack *stack);
+
+/*
+ * Pop all nodes of a stack and append them to the given list.
+ *
+ * Nodes are appended in the order they would have been popped, i.e. the
+ * most recently pushed first.
+ */
+void lfstack_pop_all(struct lfstack *stack, struct slist *list);
+
+/*
+ * Return true if a stack is empty.
+ *
+ * Nodes may be pushed or popped as soon as this function returns.
+ */
+bool lfstack_empty(struct lfstack *stack);
+
+#endif /* LFSTACK_H */
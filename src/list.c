@@ -33,109 +33,340 @@
  *  - It only requires constant additional space (as it works on linked lists).
  *  - It performs at O(n log n) for average and worst cases.
  *  - It is adaptive, performing faster on already sorted lists.
+ *
+ * The list is processed in a single pass. It is scanned for natural runs,
+ * i.e. sequences of entries already in order, or in strictly reverse order,
+ * in which case they're reversed. Runs are pushed on a stack of pending
+ * runs, where the run at index i results from the merge of 2^i runs, and
+ * merged with pending runs the same way a binary counter is incremented.
+ * During sorting, lists are handled as NULL-terminated chains of next
+ * pointers, and previous pointers are only restored once sorting is
+ * complete.
+ *
+ * The parallel variant splits the list into contiguous chunks, which are
+ * sorted concurrently, and then merged pairwise, merges of the same level
+ * of the merge tree also running concurrently. Since chunks are contiguous
+ * and merges always give precedence to the chunk that comes first, the
+ * parallel sort is stable too.
  */
 
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "list.h"
+#include "macros.h"
+
+/*
+ * Maximum number of pending runs, which bounds the number of runs to
+ * 2^LIST_SORT_MAX_PENDING.
+ */
+#define LIST_SORT_MAX_PENDING (sizeof(size_t) * 8)
+
+/*
+ * Maximum number of threads used by the parallel sort.
+ */
+#define LIST_SORT_MAX_THREADS 64
 
 /*
- * Split input_list into two lists.
+ * Minimum number of entries per chunk for the parallel sort, below which
+ * the cost of creating threads isn't worth it.
+ */
+#define LIST_SORT_MIN_CHUNK_SIZE 4096
+
+/*
+ * Unit of work of the parallel sort.
  *
- * The list_size first entries of input_list are moved into left_list while
- * the "right" list is actually the list_size first entries of input_list
- * after completion.
+ * If b is NULL, the a chain is sorted, otherwise the a and b chains are
+ * merged. The result is stored in a.
  */
-static void
-_list_divide(struct list *input_list, struct list *left_list,
-             unsigned int list_size)
+struct list_sort_work {
+    struct list *a;
+    struct list *b;
+    list_sort_cmp_fn_t cmp_fn;
+    pthread_t thread;
+    bool threaded;
+};
+
+/*
+ * Merge two NULL-terminated chains and return the resulting chain.
+ *
+ * Entries of the a chain come first in case of equality, in order for the
+ * sort to be stable.
+ */
+static struct list *
+list_sort_merge(struct list *a, struct list *b, list_sort_cmp_fn_t cmp_fn)
 {
-    struct list *node;
-    unsigned int i;
+    struct list *head, **tail;
 
-    node = input_list->next;
+    tail = &head;
+
+    for (;;) {
+        if (cmp_fn(a, b) <= 0) {
+            *tail = a;
+            tail = &a->next;
+            a = a->next;
+
+            if (a == NULL) {
+                *tail = b;
+                break;
+            }
+        } else {
+            *tail = b;
+            tail = &b->next;
+            b = b->next;
 
-    for (i = 0; (i < list_size) && !list_end(input_list, node); i++) {
-        node = node->next;
+            if (b == NULL) {
+                *tail = a;
+                break;
+            }
+        }
     }
 
-    list_split(left_list, input_list, node);
+    return head;
 }
 
 /*
- * Merge left_list and right_list at the tail of output_list.
+ * Detach the natural run at the head of a NULL-terminated chain.
+ *
+ * Return the run, and store the remaining chain in *nextp.
  */
-static void
-_list_merge(struct list *left_list, struct list *right_list,
-            struct list *output_list, unsigned int right_list_size,
-            list_sort_cmp_fn_t cmp_fn)
+static struct list *
+list_sort_get_run(struct list *node, struct list **nextp,
+                  list_sort_cmp_fn_t cmp_fn)
 {
-    struct list *left, *right;
+    struct list *head, *next, *prev;
 
-    left = left_list->prev;
-    right = right_list->next;
+    head = node;
+    next = node->next;
+
+    if (next == NULL) {
+        *nextp = NULL;
+        return head;
+    }
+
+    if (cmp_fn(node, next) <= 0) {
+        do {
+            node = next;
+            next = node->next;
+        } while ((next != NULL) && (cmp_fn(node, next) <= 0));
+
+        node->next = NULL;
+        *nextp = next;
+        return head;
+    }
 
     /*
-     * Try to concatenate lists instead of merging first. This reduces
-     * complexity for already sorted lists.
+     * Strictly descending run, reverse it. Equal entries would break
+     * stability when reversed, which is why they end the run.
      */
-    if (!list_end(left_list, left)
-        && ((right_list_size > 0) && !list_end(right_list, right))
-        && (cmp_fn(left, right) <= 0)) {
-        struct list tmp_list;
+    prev = NULL;
+
+    do {
+        node->next = prev;
+        prev = node;
+        node = next;
+        next = node->next;
+    } while ((next != NULL) && (cmp_fn(node, next) > 0));
+
+    node->next = prev;
+    *nextp = next;
+    return node;
+}
+
+/*
+ * Sort a NULL-terminated chain and return the resulting chain.
+ */
+static struct list *
+list_sort_chain(struct list *node, list_sort_cmp_fn_t cmp_fn)
+{
+    struct list *pending[LIST_SORT_MAX_PENDING];
+    struct list *next, *run;
+    unsigned int i, nr_pending;
+
+    nr_pending = 0;
+
+    do {
+        run = list_sort_get_run(node, &next, cmp_fn);
 
-        list_concat(output_list, left_list);
-        list_init(left_list);
+        for (i = 0; (i < nr_pending) && (pending[i] != NULL); i++) {
+            run = list_sort_merge(pending[i], run, cmp_fn);
+            pending[i] = NULL;
+        }
+
+        pending[i] = run;
 
-        while ((right_list_size > 0) && !list_end(right_list, right)) {
-            right = right->next;
-            right_list_size--;
+        if (i == nr_pending) {
+            nr_pending++;
         }
 
-        list_split(&tmp_list, right_list, right);
-        list_concat(output_list, &tmp_list);
+        node = next;
+    } while (node != NULL);
+
+    run = NULL;
+
+    for (i = 0; i < nr_pending; i++) {
+        if (pending[i] == NULL) {
+            continue;
+        }
+
+        run = (run == NULL) ? pending[i]
+                            : list_sort_merge(pending[i], run, cmp_fn);
+    }
+
+    return run;
+}
+
+/*
+ * Relink a list from a NULL-terminated chain, restoring previous pointers.
+ */
+static void
+list_sort_relink(struct list *list, struct list *chain)
+{
+    struct list *node, *prev;
+
+    prev = list;
+
+    for (node = chain; node != NULL; node = node->next) {
+        node->prev = prev;
+        prev->next = node;
+        prev = node;
+    }
+
+    prev->next = list;
+    list->prev = prev;
+}
+
+void
+list_sort(struct list *list, list_sort_cmp_fn_t cmp_fn)
+{
+    if (list_empty(list) || list_singular(list)) {
         return;
     }
 
-    left = left_list->next;
+    list->prev->next = NULL;
+    list_sort_relink(list, list_sort_chain(list->next, cmp_fn));
+}
 
-    while (!list_end(left_list, left)
-           || ((right_list_size > 0) && !list_end(right_list, right)))
-        if (((right_list_size == 0) || list_end(right_list, right))
-            || (!list_end(left_list, left) && (cmp_fn(left, right) <= 0))) {
-            list_remove(left);
-            list_insert_tail(output_list, left);
-            left = left_list->next;
-        } else {
-            list_remove(right);
-            list_insert_tail(output_list, right);
-            right = right_list->next;
-            right_list_size--;
+static void *
+list_sort_work_run(void *arg)
+{
+    struct list_sort_work *work;
+
+    work = arg;
+
+    if (work->b == NULL) {
+        work->a = list_sort_chain(work->a, work->cmp_fn);
+    } else {
+        work->a = list_sort_merge(work->a, work->b, work->cmp_fn);
+    }
+
+    return NULL;
+}
+
+/*
+ * Run units of work concurrently, the first one in the calling thread.
+ *
+ * If a thread can't be created, its work is run in the calling thread.
+ */
+static void
+list_sort_work_dispatch(struct list_sort_work *works, unsigned int nr_works)
+{
+    unsigned int i;
+    int error;
+
+    for (i = 1; i < nr_works; i++) {
+        error = pthread_create(&works[i].thread, NULL,
+                               list_sort_work_run, &works[i]);
+        works[i].threaded = !error;
+
+        if (error) {
+            list_sort_work_run(&works[i]);
         }
+    }
+
+    list_sort_work_run(&works[0]);
+
+    for (i = 1; i < nr_works; i++) {
+        if (works[i].threaded) {
+            pthread_join(works[i].thread, NULL);
+        }
+    }
 }
 
 void
-list_sort(struct list *list, list_sort_cmp_fn_t cmp_fn)
+list_sort_parallel(struct list *list, list_sort_cmp_fn_t cmp_fn,
+                   unsigned int nr_threads)
 {
-    struct list left_list, output_list;
-    unsigned int list_size, nr_merges;
+    struct list_sort_work works[LIST_SORT_MAX_THREADS];
+    struct list *chunks[LIST_SORT_MAX_THREADS];
+    unsigned int i, nr_chunks, nr_works;
+    struct list *node, *next;
+    size_t size, chunk_size, j;
 
-    list_init(&left_list);
-    list_init(&output_list);
+    size = 0;
 
-    for (list_size = 1; /* no condition */; list_size <<= 1) {
-        for (nr_merges = 0; /* no condition */; nr_merges++) {
-            if (list_empty(list)) {
-                break;
-            }
+    list_for_each(list, node) {
+        size++;
+    }
 
-            _list_divide(list, &left_list, list_size);
-            _list_merge(&left_list, list, &output_list, list_size, cmp_fn);
+    nr_chunks = MIN(nr_threads, LIST_SORT_MAX_THREADS);
+    nr_chunks = MIN(nr_chunks, size / LIST_SORT_MIN_CHUNK_SIZE);
+
+    if (nr_chunks <= 1) {
+        list_sort(list, cmp_fn);
+        return;
+    }
+
+    list->prev->next = NULL;
+    node = list->next;
+    chunk_size = size / nr_chunks;
+
+    for (i = 0; i < nr_chunks; i++) {
+        works[i].a = node;
+        works[i].b = NULL;
+        works[i].cmp_fn = cmp_fn;
+
+        if (i == (nr_chunks - 1)) {
+            break;
         }
 
-        list_concat(list, &output_list);
-        list_init(&output_list);
+        for (j = 1; j < chunk_size; j++) {
+            node = node->next;
+        }
 
-        if (nr_merges <= 1) {
-            return;
+        next = node->next;
+        node->next = NULL;
+        node = next;
+    }
+
+    list_sort_work_dispatch(works, nr_chunks);
+
+    for (i = 0; i < nr_chunks; i++) {
+        chunks[i] = works[i].a;
+    }
+
+    while (nr_chunks > 1) {
+        nr_works = nr_chunks / 2;
+
+        for (i = 0; i < nr_works; i++) {
+            works[i].a = chunks[i * 2];
+            works[i].b = chunks[(i * 2) + 1];
         }
+
+        list_sort_work_dispatch(works, nr_works);
+
+        for (i = 0; i < nr_works; i++) {
+            chunks[i] = works[i].a;
+        }
+
+        if ((nr_chunks % 2) != 0) {
+            chunks[nr_works] = chunks[nr_chunks - 1];
+            nr_works++;
+        }
+
+        nr_chunks = nr_works;
     }
+
+    list_sort_relink(list, chunks[0]);
 }
@@ -35,6 +35,7 @@
 #include <stddef.h>
 
 #include "macros.h"
+#include "rcu.h"
 
 /*
  * Structure used as both head and node.
@@ -404,13 +405,6 @@ for (entry = list_last_entry(list, typeof(*entry), member),         \
  * In addition, list_end() is also allowed in read-side critical sections.
  */
 
-/*
- * These macros can be replaced by actual functions in an environment
- * that provides lockless synchronization such as RCU.
- */
-#define rcu_store_ptr(ptr, value)       ((ptr) = (value))
-#define rcu_load_ptr(ptr)               (ptr)
-
 /*
  * Return the first node of a list.
  */
@@ -561,4 +555,14 @@ for (entry = list_rcu_first_entry(list, typeof(*entry), member);    \
  */
 void list_sort(struct list *list, list_sort_cmp_fn_t cmp_fn);
 
+/*
+ * Sort a list using up to nr_threads threads, including the calling one.
+ *
+ * The result is the same as with list_sort(). Since the comparison
+ * function is called concurrently, it must be thread-safe. Small lists
+ * are sorted by the calling thread only.
+ */
+void list_sort_parallel(struct list *list, list_sort_cmp_fn_t cmp_fn,
+                        unsigned int nr_threads);
+
 #endif /* LIST_H */
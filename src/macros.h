@@ -65,6 +65,35 @@
 
 #define barrier()           asm volatile("" : : : "memory")
 
+/*
+ * Access a variable exactly once, preventing the compiler from merging,
+ * splitting, caching or discarding the access. These macros don't imply
+ * any memory ordering, and are meant for variables concurrently accessed
+ * with plain loads and stores, e.g. under restartable sequences.
+ */
+#define READ_ONCE(x)        (*(const volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, val)                      \
+MACRO_BEGIN                                     \
+    *(volatile typeof(x) *)&(x) = (val);        \
+MACRO_END
+
+/*
+ * Prefetch memory for reading/writing.
+ */
+#define prefetch(x)         __builtin_prefetch(x)
+#define prefetchw(x)        __builtin_prefetch(x, 1)
+
+/*
+ * Hint the processor that the caller is busy waiting.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax()         asm volatile("pause" : : : "memory")
+#elif defined(__aarch64__)
+#define cpu_relax()         asm volatile("yield" : : : "memory")
+#else
+#define cpu_relax()         barrier()
+#endif
+
 /*
  * The following macros may be provided by the C environment.
  */
@@ -93,6 +122,25 @@
 #define __used              __attribute__((used))
 #endif
 
+#ifndef __aligned
+#define __aligned(x)        __attribute__((aligned(x)))
+#endif
+
+/*
+ * Align a variable or member on a cache line.
+ *
+ * Data written by different processors should be separated by cache lines
+ * to avoid false sharing, i.e. processors invalidating each other's copy
+ * of a line without actually sharing data. Applied to a member, this macro
+ * also starts a new line, which can be used to separate members mostly
+ * read from members frequently written.
+ *
+ * The line size is the one configured for the build, see CPU_L1_SIZE.
+ */
+#ifndef __cacheline_aligned
+#define __cacheline_aligned __aligned(1 << CONFIG_CPU_L1_SHIFT)
+#endif
+
 #ifndef __fallthrough
 #if __GNUC__ >= 7
 #define __fallthrough       __attribute__((fallthrough))
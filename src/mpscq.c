@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "macros.h"
+#include "mpscq.h"
+#include "slist.h"
+
+void
+mpscq_init(struct mpscq *queue)
+{
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    atomic_init(&queue->tail, &queue->stub);
+}
+
+static struct slist_node *
+mpscq_node_next(struct slist_node *node)
+{
+    return __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+}
+
+struct slist_node *
+mpscq_pop(struct mpscq *queue)
+{
+    struct slist_node *head, *next;
+
+    head = queue->head;
+    next = mpscq_node_next(head);
+
+    if (head == &queue->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+
+        queue->head = next;
+        head = next;
+        next = mpscq_node_next(next);
+    }
+
+    if (next != NULL) {
+        queue->head = next;
+        return head;
+    }
+
+    if (head != atomic_load_explicit(&queue->tail, memory_order_acquire)) {
+        /* A push is in progress */
+        return NULL;
+    }
+
+    /*
+     * The head is the last node, push the stub so that the head can be
+     * removed while the queue still contains a node.
+     */
+    mpscq_push(queue, &queue->stub);
+    next = mpscq_node_next(head);
+
+    if (next == NULL) {
+        return NULL;
+    }
+
+    queue->head = next;
+    return head;
+}
+
+static struct slist_node *
+mpscq_node_wait_next(struct slist_node *node)
+{
+    struct slist_node *next;
+
+    for (;;) {
+        next = mpscq_node_next(node);
+
+        if (next != NULL) {
+            return next;
+        }
+
+        cpu_relax();
+    }
+}
+
+/*
+ * Transfer the nodes preceding the stub to the given list, if the stub
+ * is in the queue but not at its head.
+ *
+ * This happens when mpscq_pop() pushes the stub back while a producer
+ * concurrently pushes a node after the head.
+ */
+static void
+mpscq_pop_until_stub(struct mpscq *queue, struct slist *list)
+{
+    struct slist_node *first, *prev, *node, *next;
+    struct slist tmp;
+
+    first = queue->head;
+    prev = NULL;
+    node = first;
+
+    while (node != &queue->stub) {
+        next = mpscq_node_next(node);
+
+        if (next == NULL) {
+            /*
+             * Only the consumer pushes the stub, so if this node is the
+             * tail, the stub isn't in the queue.
+             */
+            if (node == atomic_load_explicit(&queue->tail,
+                                             memory_order_acquire)) {
+                return;
+            }
+
+            cpu_relax();
+            continue;
+        }
+
+        prev = node;
+        node = next;
+    }
+
+    __atomic_store_n(&prev->next, NULL, __ATOMIC_RELAXED);
+    queue->head = &queue->stub;
+
+    tmp.first = first;
+    tmp.last = prev;
+    slist_concat(list, &tmp);
+}
+
+void
+mpscq_pop_all(struct mpscq *queue, struct slist *list)
+{
+    struct slist_node *first, *last, *node;
+    struct slist tmp;
+
+    if (queue->head != &queue->stub) {
+        mpscq_pop_until_stub(queue, list);
+    }
+
+    first = queue->head;
+
+    if (first == &queue->stub) {
+        first = mpscq_node_next(first);
+
+        if (first == NULL) {
+            return;
+        }
+    }
+
+    /*
+     * At this point, the stub node is either at the head of the queue, in
+     * which case it can't be the tail since it has a successor, or not in
+     * the queue at all. It can therefore be reset and used as the new tail.
+     */
+    queue->stub.next = NULL;
+    last = atomic_exchange_explicit(&queue->tail, &queue->stub,
+                                    memory_order_acq_rel);
+    queue->head = &queue->stub;
+
+    node = first;
+
+    while (node != last) {
+        node = mpscq_node_wait_next(node);
+    }
+
+    tmp.first = first;
+    tmp.last = last;
+    slist_concat(list, &tmp);
+}
+
+bool
+mpscq_empty(const struct mpscq *queue)
+{
+    struct slist_node *head;
+
+    head = queue->head;
+
+    if (head != &queue->stub) {
+        return false;
+    }
+
+    return (mpscq_node_next(head) == NULL)
+           && (atomic_load_explicit(&queue->tail, memory_order_acquire)
+               == head);
+}
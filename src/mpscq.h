@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Multiple producer single consumer queue.
+ *
+ * This lock-free intrusive queue, based on the algorithm by Dmitry Vyukov,
+ * uses singly-linked list nodes. Any number of threads may concurrently
+ * push nodes with a single atomic exchange, whereas a single thread at a
+ * time may pop them, in FIFO order.
+ *
+ * The queue isn't linearizable : if a producer is preempted between the
+ * atomic exchange and linking the previous node to the new one, the nodes
+ * it pushed, as well as those pushed after them, are invisible to the
+ * consumer until it resumes. This is why popping may fail on a queue that
+ * isn't empty.
+ */
+
+#ifndef MPSCQ_H
+#define MPSCQ_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu.h"
+#include "macros.h"
+#include "slist.h"
+
+/*
+ * Multiple producer single consumer queue.
+ *
+ * The tail member is accessed by producers, whereas the head and stub
+ * members are accessed by the consumer, which is why they're stored in
+ * separate cache lines. The stub node is used so that the queue always
+ * contains at least one node.
+ *
+ * The next member of queued nodes is shared between a producer and the
+ * consumer, and is accessed with atomic built-ins since slist nodes are
+ * plain structures.
+ */
+struct mpscq {
+    struct slist_node * _Atomic tail __cacheline_aligned;
+    struct slist_node *head __cacheline_aligned;
+    struct slist_node stub;
+};
+
+/*
+ * Initialize a queue.
+ */
+void mpscq_init(struct mpscq *queue);
+
+/*
+ * Push a node at the tail of a queue.
+ *
+ * This function may be called concurrently by any number of threads.
+ */
+static inline void
+mpscq_push(struct mpscq *queue, struct slist_node *node)
+{
+    struct slist_node *prev;
+
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    prev = atomic_exchange_explicit(&queue->tail, node, memory_order_acq_rel);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+/*
+ * Pop the node at the head of a queue.
+ *
+ * If no node could be popped, NULL is returned. This may happen while a
+ * push is in progress, even if the queue isn't empty.
+ *
+ * Only one thread at a time may pop nodes.
+ */
+struct slist_node * mpscq_pop(struct mpscq *queue);
+
+/*
+ * Pop all nodes of a queue and append them to the given list.
+ *
+ * Nodes that are being pushed concurrently with this function are either
+ * included or left in the queue. This function waits for pushes of the
+ * included nodes that are still in progress to complete.
+ *
+ * Only one thread at a time may pop nodes.
+ */
+void mpscq_pop_all(struct mpscq *queue, struct slist *list);
+
+/*
+ * Return true if a queue is empty.
+ *
+ * Only the consumer may call this function, and nodes may be pushed as
+ * soon as it returns.
+ */
+bool mpscq_empty(const struct mpscq *queue);
+
+#endif /* MPSCQ_H */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bitmap.h"
+#include "cpu.h"
+#include "macros.h"
+#include "numa.h"
+
+/*
+ * Node mask, as passed to the kernel.
+ */
+struct numa_mask {
+    BITMAP_DECLARE(nodes, NUMA_MAX_NODES);
+};
+
+static void
+numa_mask_init(struct numa_mask *mask)
+{
+    bitmap_zero(mask->nodes, NUMA_MAX_NODES);
+}
+
+static void
+numa_mask_set(struct numa_mask *mask, unsigned int node)
+{
+    assert(node < NUMA_MAX_NODES);
+    mask->nodes[node / LONG_BIT] |= 1UL << (node % LONG_BIT);
+}
+
+static unsigned int
+numa_nr_nodes(void)
+{
+    return MIN(cpu_nr_nodes(), NUMA_MAX_NODES);
+}
+
+static void
+numa_mask_init_all(struct numa_mask *mask)
+{
+    unsigned int i;
+
+    numa_mask_init(mask);
+
+    for (i = 0; i < numa_nr_nodes(); i++) {
+        numa_mask_set(mask, i);
+    }
+}
+
+/*
+ * The kernel expects the number of bits in the mask plus one.
+ */
+static int
+numa_mbind(void *addr, size_t size, int mode, const struct numa_mask *mask)
+{
+    long ret;
+
+    ret = syscall(SYS_mbind, addr, size, mode,
+                  (mask == NULL) ? NULL : mask->nodes,
+                  (mask == NULL) ? 0 : NUMA_MAX_NODES + 1, 0);
+    return (ret == -1) ? errno : 0;
+}
+
+unsigned int
+numa_local_node(void)
+{
+    return cpu_node(cpu_id());
+}
+
+int
+numa_bind_node(void *addr, size_t size, unsigned int node)
+{
+    struct numa_mask mask;
+
+    numa_mask_init(&mask);
+    numa_mask_set(&mask, node);
+    return numa_mbind(addr, size, MPOL_PREFERRED, &mask);
+}
+
+int
+numa_bind(void *addr, size_t size, int policy)
+{
+    struct numa_mask mask;
+
+    switch (policy) {
+    case NUMA_POLICY_DEFAULT:
+        return numa_mbind(addr, size, MPOL_DEFAULT, NULL);
+    case NUMA_POLICY_LOCAL:
+        return numa_bind_node(addr, size, numa_local_node());
+    case NUMA_POLICY_INTERLEAVE:
+        numa_mask_init_all(&mask);
+
+        return numa_mbind(addr, size, MPOL_INTERLEAVE, &mask);
+    default:
+        assert(!"invalid policy");
+        return EINVAL;
+    }
+}
+
+static void *
+numa_map(size_t size)
+{
+    void *addr;
+
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (addr == MAP_FAILED) ? NULL : addr;
+}
+
+void *
+numa_alloc(size_t size, int policy)
+{
+    void *addr;
+
+    addr = numa_map(size);
+
+    if ((addr != NULL) && (policy != NUMA_POLICY_DEFAULT)
+        && (numa_nr_nodes() > 1)) {
+        numa_bind(addr, size, policy);
+    }
+
+    return addr;
+}
+
+void *
+numa_alloc_node(size_t size, unsigned int node)
+{
+    void *addr;
+
+    addr = numa_map(size);
+
+    if ((addr != NULL) && (numa_nr_nodes() > 1)) {
+        numa_bind_node(addr, size, node);
+    }
+
+    return addr;
+}
+
+void
+numa_free(void *ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+int
+numa_set_thread_policy(int policy)
+{
+    struct numa_mask mask;
+    long ret;
+
+    switch (policy) {
+    case NUMA_POLICY_DEFAULT:
+        ret = syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+        break;
+    case NUMA_POLICY_LOCAL:
+        ret = syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0);
+        break;
+    case NUMA_POLICY_INTERLEAVE:
+        numa_mask_init_all(&mask);
+
+        ret = syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, mask.nodes,
+                      NUMA_MAX_NODES + 1);
+        break;
+    default:
+        assert(!"invalid policy");
+        return EINVAL;
+    }
+
+    return (ret == -1) ? errno : 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * NUMA memory placement.
+ *
+ * On machines with several memory nodes, accessing memory attached to a
+ * remote node is slower than accessing local memory. This module allocates
+ * memory with an explicit placement policy, relying on the mbind() and
+ * set_mempolicy() system calls directly, so that it doesn't depend on
+ * libnuma.
+ *
+ * The local policy places memory on the node of the processor the
+ * allocating thread runs on, regardless of which thread first touches it.
+ * It suits data mostly accessed by the allocating thread. The interleave
+ * policy spreads pages over all nodes, and suits large data shared by
+ * threads on all nodes, usually read-mostly.
+ *
+ * Placement is best effort. On machines with a single node, or if the
+ * kernel doesn't support memory policies, policies are silently ignored
+ * by allocation functions.
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+/*
+ * Maximum number of supported nodes.
+ */
+#define NUMA_MAX_NODES 1024
+
+/*
+ * Memory placement policies.
+ */
+#define NUMA_POLICY_DEFAULT     0 /* Let the system decide */
+#define NUMA_POLICY_LOCAL       1 /* Node of the calling thread */
+#define NUMA_POLICY_INTERLEAVE  2 /* Pages spread over all nodes */
+
+/*
+ * Return the node of the processor the calling thread is running on.
+ */
+unsigned int numa_local_node(void);
+
+/*
+ * Apply a placement policy to a range of memory.
+ *
+ * The address must be page-aligned. The policy only applies to pages not
+ * yet faulted in.
+ *
+ * If the kernel doesn't support memory policies, ENOSYS is returned.
+ */
+int numa_bind(void *addr, size_t size, int policy);
+
+/*
+ * Place a range of memory on the given node.
+ */
+int numa_bind_node(void *addr, size_t size, unsigned int node);
+
+/*
+ * Allocate page-aligned memory with the given placement policy.
+ *
+ * Memory is zero-filled. If it can't be allocated, NULL is returned.
+ */
+void * numa_alloc(size_t size, int policy);
+
+/*
+ * Allocate page-aligned memory on the given node.
+ */
+void * numa_alloc_node(size_t size, unsigned int node);
+
+/*
+ * Release memory obtained from numa_alloc() or numa_alloc_node().
+ *
+ * The size must be the one used for allocation.
+ */
+void numa_free(void *ptr, size_t size);
+
+/*
+ * Set the default placement policy of the calling thread.
+ *
+ * This policy applies to all future allocations by the calling thread
+ * that don't have a policy of their own, including those of the C library.
+ * With the local policy, pages are placed on the node of the processor
+ * that faults them in.
+ *
+ * If the kernel doesn't support memory policies, ENOSYS is returned.
+ */
+int numa_set_thread_policy(int policy);
+
+#endif /* NUMA_H */
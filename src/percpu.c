@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "macros.h"
+#include "percpu.h"
+#include "rseq.h"
+#include "slist.h"
+
+/*
+ * Free list of a processor.
+ *
+ * The lock is only used when restartable sequences can't be used.
+ */
+struct percpu_freelist_head {
+    struct slist_node *first;
+    pthread_mutex_t lock;
+};
+
+int
+percpu_area_init(struct percpu_area *area, size_t size)
+{
+    unsigned int nr_cpus;
+    size_t align, stride;
+    void *base;
+    int error;
+
+    nr_cpus = cpu_count();
+    align = cpu_l1_size();
+    stride = P2ROUND(size, align);
+    error = posix_memalign(&base, align, nr_cpus * stride);
+
+    if (error) {
+        return ENOMEM;
+    }
+
+    memset(base, 0, nr_cpus * stride);
+    area->base = base;
+    area->stride = stride;
+    area->nr_cpus = nr_cpus;
+
+    /*
+     * Critical sections can only be used if each processor is known to
+     * have its own slot, and if registration succeeded, which is assumed
+     * to be the case for all threads if it is for the calling one.
+     */
+    area->rseq = cpu_ids_bounded()
+                 && (cpu_nr_possible() <= nr_cpus)
+                 && (rseq_cpu_id() != -1);
+    return 0;
+}
+
+void
+percpu_area_destroy(struct percpu_area *area)
+{
+    free(area->base);
+}
+
+int
+percpu_counter_init(struct percpu_counter *counter)
+{
+    unsigned int cpu;
+    int error;
+
+    error = percpu_area_init(&counter->area, sizeof(atomic_ulong));
+
+    if (error) {
+        return error;
+    }
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&counter->area); cpu++) {
+        atomic_init((atomic_ulong *)percpu_area_ptr(&counter->area, cpu), 0);
+    }
+
+    return 0;
+}
+
+void
+percpu_counter_destroy(struct percpu_counter *counter)
+{
+    percpu_area_destroy(&counter->area);
+}
+
+unsigned long
+percpu_counter_read(const struct percpu_counter *counter)
+{
+    const atomic_ulong *value;
+    unsigned long sum;
+    unsigned int cpu;
+
+    sum = 0;
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&counter->area); cpu++) {
+        value = percpu_area_ptr(&counter->area, cpu);
+        sum += atomic_load_explicit(value, memory_order_relaxed);
+    }
+
+    return sum;
+}
+
+static struct percpu_freelist_head *
+percpu_freelist_get_head(const struct percpu_freelist *freelist,
+                         unsigned int cpu)
+{
+    return percpu_area_ptr(&freelist->area, cpu);
+}
+
+int
+percpu_freelist_init(struct percpu_freelist *freelist)
+{
+    struct percpu_freelist_head *head;
+    unsigned int cpu;
+    int error;
+
+    error = percpu_area_init(&freelist->area, sizeof(*head));
+
+    if (error) {
+        return error;
+    }
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&freelist->area); cpu++) {
+        head = percpu_freelist_get_head(freelist, cpu);
+        head->first = NULL;
+        pthread_mutex_init(&head->lock, NULL);
+    }
+
+    return 0;
+}
+
+void
+percpu_freelist_destroy(struct percpu_freelist *freelist)
+{
+    percpu_area_destroy(&freelist->area);
+}
+
+void
+percpu_freelist_push(struct percpu_freelist *freelist,
+                     struct slist_node *node)
+{
+    struct percpu_freelist_head *head;
+
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+    struct slist_node *first;
+    int cpu, error;
+
+    for (;;) {
+        cpu = percpu_area_rseq_cpu(&freelist->area);
+
+        if (cpu == -1) {
+            break;
+        }
+
+        head = percpu_freelist_get_head(freelist, cpu);
+        first = READ_ONCE(head->first);
+        node->next = first;
+        error = rseq_cmpeqv_storev((intptr_t *)&head->first,
+                                   (intptr_t)first, (intptr_t)node, cpu);
+
+        if (!error) {
+            return;
+        }
+    }
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+
+    head = percpu_area_local_ptr(&freelist->area);
+    pthread_mutex_lock(&head->lock);
+    node->next = head->first;
+    head->first = node;
+    pthread_mutex_unlock(&head->lock);
+}
+
+struct slist_node *
+percpu_freelist_pop(struct percpu_freelist *freelist)
+{
+    struct percpu_freelist_head *head;
+    struct slist_node *node;
+
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+    int cpu, error;
+
+    for (;;) {
+        cpu = percpu_area_rseq_cpu(&freelist->area);
+
+        if (cpu == -1) {
+            break;
+        }
+
+        head = percpu_freelist_get_head(freelist, cpu);
+        error = rseq_list_pop((intptr_t *)&head->first, (intptr_t *)&node,
+                              cpu);
+
+        if (error == 0) {
+            return node;
+        } else if (error == 1) {
+            return NULL;
+        }
+    }
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+
+    head = percpu_area_local_ptr(&freelist->area);
+    pthread_mutex_lock(&head->lock);
+    node = head->first;
+
+    if (node != NULL) {
+        head->first = node->next;
+    }
+
+    pthread_mutex_unlock(&head->lock);
+    return node;
+}
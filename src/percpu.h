@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Per-processor data.
+ *
+ * Per-processor variables are arrays with one slot per processor, each slot
+ * being aligned on a cache line so that processors updating their own slot
+ * don't share cache lines. Threads normally access the slot of the
+ * processor they're running on, but since they may be preempted and
+ * migrated at any time, and since several threads may run on the same
+ * processor, slots must be accessed with atomic operations, or protected
+ * by other means.
+ *
+ * Static per-processor variables have NR_CPUS slots. Per-processor areas
+ * are allocated at run time instead, with one slot per processor as
+ * reported by cpu_count(), aligned on the cache line size reported by
+ * cpu_l1_size(), so that they don't waste memory on machines with fewer
+ * processors than the configured maximum.
+ *
+ * Per-processor counters and free lists are built on per-processor areas.
+ * Counter increments only touch the slot of the local processor, and
+ * reading a counter sums all slots. The value returned is exact only if
+ * there are no concurrent updates. Free lists push nodes to and pop nodes
+ * from the list of the local processor.
+ *
+ * When restartable sequences are usable, and processor IDs map to distinct
+ * slots, counters and free lists are updated with critical sections that
+ * don't use atomic instructions or locks. Otherwise, counters use atomic
+ * instructions, and free lists use a lock per processor.
+ */
+
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "macros.h"
+#include "rseq.h"
+#include "slist.h"
+
+/*
+ * Type of a slot of a per-processor variable of the given type.
+ */
+#define percpu_slot_type(type)                              \
+struct {                                                    \
+    type value;                                             \
+} __cacheline_aligned
+
+/*
+ * Define a per-processor variable.
+ *
+ * This macro may be prefixed with storage class specifiers, e.g. :
+ * static PERCPU_DEFINE(struct stats, stats);
+ */
+#define PERCPU_DEFINE(type, name) percpu_slot_type(type) name[NR_CPUS]
+
+/*
+ * Return the address of the slot of the given processor.
+ */
+#define percpu_ptr(var, cpu) (&(var)[cpu].value)
+
+/*
+ * Return the address of the slot of the local processor.
+ */
+#define percpu_local_ptr(var) percpu_ptr(var, cpu_id())
+
+/*
+ * Forge a loop to process all processors.
+ */
+#define percpu_for_each_cpu(cpu) \
+for (cpu = 0; cpu < NR_CPUS; cpu++)
+
+/*
+ * Per-processor area.
+ */
+struct percpu_area {
+    char *base;
+    size_t stride;
+    unsigned int nr_cpus;
+    bool rseq;
+};
+
+/*
+ * Initialize a per-processor area with slots of the given size.
+ *
+ * Slots are zero-filled. If memory can't be allocated, ENOMEM is returned.
+ */
+int percpu_area_init(struct percpu_area *area, size_t size);
+
+/*
+ * Release the memory of a per-processor area.
+ */
+void percpu_area_destroy(struct percpu_area *area);
+
+/*
+ * Return the number of slots of a per-processor area.
+ */
+static inline unsigned int
+percpu_area_nr_cpus(const struct percpu_area *area)
+{
+    return area->nr_cpus;
+}
+
+/*
+ * Return the address of the slot of the given processor.
+ */
+static inline void *
+percpu_area_ptr(const struct percpu_area *area, unsigned int cpu)
+{
+    return area->base + (cpu * area->stride);
+}
+
+/*
+ * Return the index of the slot of the local processor.
+ *
+ * The processor ID may exceed the number of slots if the system doesn't
+ * report all possible processors, in which case several processors share
+ * the same slot.
+ */
+static inline unsigned int
+percpu_area_local_cpu(const struct percpu_area *area)
+{
+    unsigned int cpu;
+
+    cpu = cpu_id();
+
+    if (unlikely(cpu >= area->nr_cpus)) {
+        cpu %= area->nr_cpus;
+    }
+
+    return cpu;
+}
+
+/*
+ * Return the address of the slot of the local processor.
+ */
+static inline void *
+percpu_area_local_ptr(const struct percpu_area *area)
+{
+    return percpu_area_ptr(area, percpu_area_local_cpu(area));
+}
+
+/*
+ * Return the local processor for use with restartable sequences, or -1 if
+ * they can't be used to access the given per-processor area.
+ */
+static inline int
+percpu_area_rseq_cpu(const struct percpu_area *area)
+{
+    return area->rseq ? rseq_cpu_id() : -1;
+}
+
+/*
+ * Per-processor counter.
+ */
+struct percpu_counter {
+    struct percpu_area area;
+};
+
+/*
+ * Initialize a per-processor counter.
+ *
+ * If memory can't be allocated, ENOMEM is returned.
+ */
+int percpu_counter_init(struct percpu_counter *counter);
+
+/*
+ * Release the memory of a per-processor counter.
+ */
+void percpu_counter_destroy(struct percpu_counter *counter);
+
+/*
+ * Add a value to a per-processor counter.
+ */
+static inline void
+percpu_counter_add(struct percpu_counter *counter, unsigned long delta)
+{
+    atomic_ulong *value;
+
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+    int cpu, error;
+
+    do {
+        cpu = percpu_area_rseq_cpu(&counter->area);
+
+        if (cpu == -1) {
+            break;
+        }
+
+        value = percpu_area_ptr(&counter->area, cpu);
+        error = rseq_addv((intptr_t *)value, delta, cpu);
+
+        if (!error) {
+            return;
+        }
+    } while (1);
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+
+    value = percpu_area_local_ptr(&counter->area);
+    atomic_fetch_add_explicit(value, delta, memory_order_relaxed);
+}
+
+/*
+ * Increment a per-processor counter.
+ */
+static inline void
+percpu_counter_inc(struct percpu_counter *counter)
+{
+    percpu_counter_add(counter, 1);
+}
+
+/*
+ * Return the value of a per-processor counter.
+ */
+unsigned long percpu_counter_read(const struct percpu_counter *counter);
+
+/*
+ * Per-processor free list.
+ */
+struct percpu_freelist {
+    struct percpu_area area;
+};
+
+/*
+ * Initialize a per-processor free list.
+ *
+ * If memory can't be allocated, ENOMEM is returned.
+ */
+int percpu_freelist_init(struct percpu_freelist *freelist);
+
+/*
+ * Release the memory of a per-processor free list.
+ *
+ * Nodes still in the free list are ignored.
+ */
+void percpu_freelist_destroy(struct percpu_freelist *freelist);
+
+/*
+ * Push a node on the free list of the local processor.
+ */
+void percpu_freelist_push(struct percpu_freelist *freelist,
+                          struct slist_node *node);
+
+/*
+ * Pop a node from the free list of the local processor.
+ *
+ * If that list is empty, NULL is returned, even if the lists of other
+ * processors aren't.
+ */
+struct slist_node * percpu_freelist_pop(struct percpu_freelist *freelist);
+
+#endif /* PERCPU_H */
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "pheap.h"
+
+/*
+ * Link two subtrees, and return the root of the resulting subtree.
+ *
+ * The next and prev members of the returned node are left unchanged, and
+ * must be set by the caller.
+ */
+static struct pheap_node *
+pheap_link(const struct pheap *heap, struct pheap_node *a,
+           struct pheap_node *b)
+{
+    struct pheap_node *tmp;
+
+    if (heap->cmp_fn(b, a) < 0) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    b->prev = a;
+    b->next = a->child;
+
+    if (a->child != NULL) {
+        a->child->prev = b;
+    }
+
+    a->child = b;
+    return a;
+}
+
+/*
+ * Merge a list of sibling subtrees, and return the root of the resulting
+ * subtree.
+ *
+ * The first pass links siblings in pairs from left to right, pushing the
+ * results on a stack built with the next member. The second pass links
+ * the results from right to left, i.e. in stack order.
+ */
+static struct pheap_node *
+pheap_merge_pairs(const struct pheap *heap, struct pheap_node *first)
+{
+    struct pheap_node *node, *next, *stack;
+
+    stack = NULL;
+
+    while (first != NULL) {
+        node = first;
+        next = node->next;
+
+        if (next == NULL) {
+            first = NULL;
+        } else {
+            first = next->next;
+            node = pheap_link(heap, node, next);
+        }
+
+        node->next = stack;
+        stack = node;
+    }
+
+    if (stack == NULL) {
+        return NULL;
+    }
+
+    node = stack;
+    stack = stack->next;
+
+    while (stack != NULL) {
+        next = stack->next;
+        node = pheap_link(heap, node, stack);
+        stack = next;
+    }
+
+    node->next = NULL;
+    node->prev = NULL;
+    return node;
+}
+
+static void
+pheap_set_root(struct pheap *heap, struct pheap_node *node)
+{
+    if (node != NULL) {
+        node->next = NULL;
+        node->prev = NULL;
+    }
+
+    heap->root = node;
+}
+
+/*
+ * Add a subtree to the heap.
+ */
+static void
+pheap_meld(struct pheap *heap, struct pheap_node *node)
+{
+    if (heap->root != NULL) {
+        node = pheap_link(heap, heap->root, node);
+    }
+
+    pheap_set_root(heap, node);
+}
+
+/*
+ * Detach a non-root node and its subtree from the heap.
+ */
+static void
+pheap_cut(struct pheap_node *node)
+{
+    assert(node->prev != NULL);
+
+    if (node->prev->child == node) {
+        node->prev->child = node->next;
+    } else {
+        node->prev->next = node->next;
+    }
+
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    }
+
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+void
+pheap_insert(struct pheap *heap, struct pheap_node *node)
+{
+    assert(node->child == NULL);
+    pheap_meld(heap, node);
+}
+
+void
+pheap_remove(struct pheap *heap, struct pheap_node *node)
+{
+    struct pheap_node *subtree;
+
+    if (node == heap->root) {
+        pheap_set_root(heap, pheap_merge_pairs(heap, node->child));
+    } else {
+        pheap_cut(node);
+        subtree = pheap_merge_pairs(heap, node->child);
+
+        if (subtree != NULL) {
+            pheap_meld(heap, subtree);
+        }
+    }
+
+    node->child = NULL;
+}
+
+struct pheap_node *
+pheap_remove_first(struct pheap *heap)
+{
+    struct pheap_node *node;
+
+    node = heap->root;
+
+    if (node != NULL) {
+        pheap_remove(heap, node);
+    }
+
+    return node;
+}
+
+void
+pheap_decrease(struct pheap *heap, struct pheap_node *node)
+{
+    if (node == heap->root) {
+        return;
+    }
+
+    pheap_cut(node);
+    pheap_meld(heap, node);
+}
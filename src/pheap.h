@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ *
+ * Pairing heap.
+ *
+ * This container is an intrusive min-heap, suited to queues with many
+ * distinct keys, such as timer queues. Insertion, decreasing the key of
+ * a node, and access to the first node are O(1). Removal is O(log n)
+ * amortized.
+ *
+ * The order of nodes is defined by a comparison function given when
+ * initializing the heap, which returns a negative value if its first
+ * argument comes before the second, and a positive value if it comes after.
+ */
+
+#ifndef PHEAP_H
+#define PHEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "macros.h"
+
+/*
+ * Pairing heap node.
+ *
+ * The children of a node are linked through their next and prev members.
+ * The prev member of the first child of a node points to its parent, and
+ * it's NULL for the root node.
+ */
+struct pheap_node {
+    struct pheap_node *child;
+    struct pheap_node *next;
+    struct pheap_node *prev;
+};
+
+/*
+ * Type for comparison functions.
+ */
+typedef int (*pheap_cmp_fn_t)(const struct pheap_node *a,
+                              const struct pheap_node *b);
+
+/*
+ * Pairing heap.
+ */
+struct pheap {
+    struct pheap_node *root;
+    pheap_cmp_fn_t cmp_fn;
+};
+
+/*
+ * Static heap initializer.
+ */
+#define PHEAP_INITIALIZER(cmp_fn) { NULL, cmp_fn }
+
+/*
+ * Initialize a heap.
+ */
+static inline void
+pheap_init(struct pheap *heap, pheap_cmp_fn_t cmp_fn)
+{
+    heap->root = NULL;
+    heap->cmp_fn = cmp_fn;
+}
+
+/*
+ * Initialize a heap node.
+ */
+static inline void
+pheap_node_init(struct pheap_node *node)
+{
+    node->child = NULL;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+/*
+ * Macro that evaluates to the address of the structure containing the
+ * given node based on the given type and member.
+ */
+#define pheap_entry(node, type, member) structof(node, type, member)
+
+/*
+ * Return true if heap is empty.
+ */
+static inline bool
+pheap_empty(const struct pheap *heap)
+{
+    return heap->root == NULL;
+}
+
+/*
+ * Return the first node of a heap.
+ *
+ * If the heap is empty, NULL is returned.
+ */
+static inline struct pheap_node *
+pheap_first(const struct pheap *heap)
+{
+    return heap->root;
+}
+
+/*
+ * Insert a node in a heap.
+ *
+ * The node must be initialized before calling this function.
+ */
+void pheap_insert(struct pheap *heap, struct pheap_node *node);
+
+/*
+ * Remove a node from a heap.
+ */
+void pheap_remove(struct pheap *heap, struct pheap_node *node);
+
+/*
+ * Remove the first node of a heap and return it.
+ *
+ * If the heap is empty, NULL is returned.
+ */
+struct pheap_node * pheap_remove_first(struct pheap *heap);
+
+/*
+ * Restore the heap property after the key of a node has decreased.
+ *
+ * To increase the key of a node, remove the node, update its key, and
+ * insert it again.
+ */
+void pheap_decrease(struct pheap *heap, struct pheap_node *node);
+
+#endif /* PHEAP_H */
@@ -38,19 +38,25 @@ plist_add(struct plist *plist, struct plist_node *pnode)
     }
 
     list_for_each_entry(&plist->prio_list, next, prio_node) {
-        if (pnode->priority < next->priority) {
+        if (pnode->priority <= next->priority) {
             break;
         }
     }
 
-    if (list_end(&plist->prio_list, &next->prio_node)
-        || (pnode->priority != next->priority)) {
-        list_insert_before(&pnode->prio_node, &next->prio_node);
+    if (!list_end(&plist->prio_list, &next->prio_node)
+        && (pnode->priority == next->priority)) {
+        /* Insert after all nodes of the same priority */
+        list_node_init(&pnode->prio_node);
+        next = list_next_entry(next, prio_node);
     } else {
-        list_init(&pnode->prio_node);
+        list_insert_before(&pnode->prio_node, &next->prio_node);
     }
 
-    list_insert_before(&pnode->node, &next->node);
+    if (list_end(&plist->prio_list, &next->prio_node)) {
+        list_insert_tail(&plist->list, &pnode->node);
+    } else {
+        list_insert_before(&pnode->node, &next->node);
+    }
 }
 
 void
@@ -63,7 +69,7 @@ plist_remove(struct plist *plist, struct plist_node *pnode)
 
         if (!list_end(&plist->list, &next->node)
             && list_node_unlinked(&next->prio_node)) {
-            list_insert_after(&pnode->prio_node, &next->prio_node);
+            list_insert_after(&next->prio_node, &pnode->prio_node);
         }
 
         list_remove(&pnode->prio_node);
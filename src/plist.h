@@ -28,7 +28,8 @@
  * This container acts as a doubly-linked list sorted by priority in
  * ascending order. All operations behave as with a regular linked list
  * except insertion, which is O(k), k being the number of priorities
- * among the entries.
+ * among the entries. When priorities are bounded, the bucketed priority
+ * list provides O(1) insertion.
  */
 
 #ifndef PLIST_H
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * The implementation relies on a global grace period counter, and a
+ * registry of readers. Each reader publishes the value of the counter it
+ * last observed when reporting a quiescent state, or 0 when offline.
+ * Waiting for a grace period consists of incrementing the counter, and
+ * waiting for all online readers to observe the new value.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "list.h"
+#include "macros.h"
+#include "rcu.h"
+
+/*
+ * Value of the reader counter when offline.
+ */
+#define RCU_OFFLINE 0
+
+struct rcu_reader {
+    struct list node;
+    atomic_ulong ctr;
+    bool registered;
+};
+
+/*
+ * Deferred work queue.
+ *
+ * Sequence numbers are used to implement barriers.
+ */
+struct rcu_work_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    struct rcu_head *first;
+    struct rcu_head **last;
+    unsigned long queued_seq;
+    unsigned long done_seq;
+    pthread_t worker;
+    bool running;
+};
+
+/*
+ * Grace period counter.
+ *
+ * It is only updated with the registry lock held, and read by all readers
+ * when reporting quiescent states, so keep it on its own cache line.
+ */
+static atomic_ulong rcu_gp_ctr __cacheline_aligned = 1;
+
+static pthread_mutex_t rcu_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct list rcu_registry = LIST_INITIALIZER(rcu_registry);
+
+static __thread struct rcu_reader rcu_reader;
+
+static struct rcu_work_queue rcu_work_queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+    .first = NULL,
+    .last = &rcu_work_queue.first,
+};
+
+void
+rcu_register_thread(void)
+{
+    assert(!rcu_reader.registered);
+
+    rcu_reader.registered = true;
+    atomic_init(&rcu_reader.ctr, RCU_OFFLINE);
+
+    pthread_mutex_lock(&rcu_registry_lock);
+    list_insert_tail(&rcu_registry, &rcu_reader.node);
+    pthread_mutex_unlock(&rcu_registry_lock);
+
+    rcu_thread_online();
+}
+
+void
+rcu_unregister_thread(void)
+{
+    assert(rcu_reader.registered);
+
+    rcu_thread_offline();
+
+    pthread_mutex_lock(&rcu_registry_lock);
+    list_remove(&rcu_reader.node);
+    pthread_mutex_unlock(&rcu_registry_lock);
+
+    rcu_reader.registered = false;
+}
+
+static bool
+rcu_thread_is_online(void)
+{
+    return rcu_reader.registered
+           && (atomic_load_explicit(&rcu_reader.ctr, memory_order_relaxed)
+               != RCU_OFFLINE);
+}
+
+void
+rcu_quiescent_state(void)
+{
+    unsigned long ctr;
+
+    assert(rcu_thread_is_online());
+
+    ctr = atomic_load_explicit(&rcu_gp_ctr, memory_order_relaxed);
+
+    /*
+     * Make sure memory accesses of previous read-side critical sections
+     * complete before reporting the quiescent state, and that those of
+     * following read-side critical sections are performed after.
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_store_explicit(&rcu_reader.ctr, ctr, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void
+rcu_thread_offline(void)
+{
+    assert(rcu_thread_is_online());
+
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_store_explicit(&rcu_reader.ctr, RCU_OFFLINE, memory_order_relaxed);
+}
+
+void
+rcu_thread_online(void)
+{
+    unsigned long ctr;
+
+    assert(rcu_reader.registered);
+    assert(!rcu_thread_is_online());
+
+    ctr = atomic_load_explicit(&rcu_gp_ctr, memory_order_relaxed);
+    atomic_store_explicit(&rcu_reader.ctr, ctr, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static bool
+rcu_reader_is_done(struct rcu_reader *reader, unsigned long gp_ctr)
+{
+    unsigned long ctr;
+
+    ctr = atomic_load_explicit(&reader->ctr, memory_order_relaxed);
+    return (ctr == RCU_OFFLINE) || (ctr == gp_ctr);
+}
+
+void
+rcu_synchronize(void)
+{
+    struct rcu_reader *reader;
+    unsigned long gp_ctr;
+    bool online;
+
+    online = rcu_thread_is_online();
+
+    if (online) {
+        rcu_thread_offline();
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+
+    pthread_mutex_lock(&rcu_registry_lock);
+
+    gp_ctr = atomic_load_explicit(&rcu_gp_ctr, memory_order_relaxed) + 1;
+
+    if (gp_ctr == RCU_OFFLINE) {
+        gp_ctr++;
+    }
+
+    atomic_store_explicit(&rcu_gp_ctr, gp_ctr, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    list_for_each_entry(&rcu_registry, reader, node) {
+        while (!rcu_reader_is_done(reader, gp_ctr)) {
+            sched_yield();
+        }
+    }
+
+    pthread_mutex_unlock(&rcu_registry_lock);
+
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (online) {
+        rcu_thread_online();
+    }
+}
+
+static void *
+rcu_worker_run(void *arg)
+{
+    struct rcu_work_queue *queue;
+    struct rcu_head *head, *next;
+    unsigned long seq;
+
+    queue = arg;
+
+    pthread_mutex_lock(&queue->lock);
+
+    for (;;) {
+        while ((queue->first == NULL) && queue->running) {
+            pthread_cond_wait(&queue->work_cond, &queue->lock);
+        }
+
+        if (queue->first == NULL) {
+            break;
+        }
+
+        head = queue->first;
+        queue->first = NULL;
+        queue->last = &queue->first;
+        seq = queue->queued_seq;
+
+        pthread_mutex_unlock(&queue->lock);
+
+        rcu_synchronize();
+
+        while (head != NULL) {
+            next = head->next;
+            head->fn(head);
+            head = next;
+        }
+
+        pthread_mutex_lock(&queue->lock);
+        queue->done_seq = seq;
+        pthread_cond_broadcast(&queue->done_cond);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+int
+rcu_start(void)
+{
+    struct rcu_work_queue *queue;
+    int error;
+
+    queue = &rcu_work_queue;
+
+    pthread_mutex_lock(&queue->lock);
+    assert(!queue->running);
+    queue->running = true;
+    error = pthread_create(&queue->worker, NULL, rcu_worker_run, queue);
+
+    if (error) {
+        queue->running = false;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return error;
+}
+
+void
+rcu_stop(void)
+{
+    struct rcu_work_queue *queue;
+    bool online;
+
+    /*
+     * The worker waits for grace periods, which the calling thread would
+     * otherwise delay while joining.
+     */
+    online = rcu_thread_is_online();
+
+    if (online) {
+        rcu_thread_offline();
+    }
+
+    queue = &rcu_work_queue;
+
+    pthread_mutex_lock(&queue->lock);
+    assert(queue->running);
+    queue->running = false;
+    pthread_cond_signal(&queue->work_cond);
+    pthread_mutex_unlock(&queue->lock);
+
+    pthread_join(queue->worker, NULL);
+
+    if (online) {
+        rcu_thread_online();
+    }
+}
+
+void
+rcu_defer(struct rcu_head *head, rcu_fn_t fn)
+{
+    struct rcu_work_queue *queue;
+
+    queue = &rcu_work_queue;
+    head->next = NULL;
+    head->fn = fn;
+
+    pthread_mutex_lock(&queue->lock);
+
+    assert(queue->running);
+
+    *queue->last = head;
+    queue->last = &head->next;
+    queue->queued_seq++;
+    pthread_cond_signal(&queue->work_cond);
+
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void
+rcu_barrier(void)
+{
+    struct rcu_work_queue *queue;
+    unsigned long seq;
+    bool online;
+
+    online = rcu_thread_is_online();
+
+    if (online) {
+        rcu_thread_offline();
+    }
+
+    queue = &rcu_work_queue;
+
+    pthread_mutex_lock(&queue->lock);
+
+    seq = queue->queued_seq;
+
+    while ((long)(queue->done_seq - seq) < 0) {
+        pthread_cond_wait(&queue->done_cond, &queue->lock);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    if (online) {
+        rcu_thread_online();
+    }
+}
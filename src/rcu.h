@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Read-copy update.
+ *
+ * This module provides the pointer accessors used by the lockless variants
+ * of the list, hlist and slist interfaces, along with a userspace
+ * implementation of quiescent-state-based RCU (QSBR).
+ *
+ * Readers access shared pointers with rcu_load_ptr(), which guarantees
+ * that the content of the object it returns is observed as it was when
+ * published with rcu_store_ptr(). Read-side critical sections are
+ * delimited by rcu_read_lock() and rcu_read_unlock(), which don't generate
+ * any instruction. Instead, reader threads must register and periodically
+ * report quiescent states, i.e. points where they're outside read-side
+ * critical sections, and don't hold references to RCU-protected objects,
+ * by calling rcu_quiescent_state(). Threads that stop reading for extended
+ * periods, e.g. before blocking, should go offline so that they don't
+ * delay grace periods.
+ *
+ * Updaters wait for all readers to go through a quiescent state, which
+ * marks the end of a grace period, either synchronously with
+ * rcu_synchronize(), or asynchronously with rcu_defer(). Deferred
+ * functions are processed in batches by a worker thread, started with
+ * rcu_start(), so that a single grace period is used for all functions
+ * deferred at the same time.
+ */
+
+#ifndef RCU_H
+#define RCU_H
+
+#include "macros.h"
+
+/*
+ * Store a pointer that may be concurrently read by readers.
+ *
+ * All previous memory accesses, including the initialization of the
+ * object that may be referenced by the new pointer, are visible to
+ * readers that load the new pointer.
+ */
+#define rcu_store_ptr(ptr, value) \
+    __atomic_store_n(&(ptr), value, __ATOMIC_RELEASE)
+
+/*
+ * Load a pointer that may be concurrently updated.
+ */
+#define rcu_load_ptr(ptr) __atomic_load_n(&(ptr), __ATOMIC_CONSUME)
+
+struct rcu_head;
+
+/*
+ * Type for deferred functions.
+ */
+typedef void (*rcu_fn_t)(struct rcu_head *head);
+
+/*
+ * Deferred work.
+ *
+ * This structure should be embedded in objects to release.
+ */
+struct rcu_head {
+    struct rcu_head *next;
+    rcu_fn_t fn;
+};
+
+/*
+ * Register/unregister the calling thread as a reader.
+ *
+ * Threads are online after registration.
+ */
+void rcu_register_thread(void);
+void rcu_unregister_thread(void);
+
+/*
+ * Enter/leave a read-side critical section.
+ *
+ * Critical sections may be nested. They only act as compiler barriers,
+ * and the calling thread must be registered and online.
+ */
+static inline void
+rcu_read_lock(void)
+{
+    barrier();
+}
+
+static inline void
+rcu_read_unlock(void)
+{
+    barrier();
+}
+
+/*
+ * Report a quiescent state for the calling thread.
+ *
+ * The calling thread must be registered and online, and outside read-side
+ * critical sections.
+ */
+void rcu_quiescent_state(void);
+
+/*
+ * Make the calling thread offline/online.
+ *
+ * An offline thread doesn't delay grace periods, and may not enter
+ * read-side critical sections.
+ */
+void rcu_thread_offline(void);
+void rcu_thread_online(void);
+
+/*
+ * Wait for the end of a grace period.
+ *
+ * On return, all read-side critical sections that were active when this
+ * function was called have completed. If the calling thread is an online
+ * reader, it reports a quiescent state, so it must be outside read-side
+ * critical sections.
+ */
+void rcu_synchronize(void);
+
+/*
+ * Start/stop the worker thread processing deferred functions.
+ *
+ * Starting the worker may fail with the errors of pthread_create().
+ * Stopping it processes all pending deferred functions, and waits for
+ * the worker to terminate.
+ */
+int rcu_start(void);
+void rcu_stop(void);
+
+/*
+ * Defer a function call until the end of a grace period.
+ *
+ * The function is called with the given head by the worker thread, which
+ * must be running.
+ */
+void rcu_defer(struct rcu_head *head, rcu_fn_t fn);
+
+/*
+ * Wait for the completion of all functions deferred so far.
+ *
+ * The same restrictions as for rcu_synchronize() apply.
+ */
+void rcu_barrier(void);
+
+#endif /* RCU_H */
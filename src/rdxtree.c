@@ -32,6 +32,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+#include "ebr.h"
 #include "macros.h"
 #include "rdxtree.h"
 #include "rdxtree_i.h"
@@ -98,6 +100,7 @@ struct rdxtree_node {
     unsigned short height;
     unsigned short nr_entries;
     rdxtree_bm_t alloc_bm;
+    struct ebr_node ebr_node;
     void *entries[RDXTREE_RADIX_SIZE];
 };
 
@@ -133,7 +136,8 @@ rdxtree_node_to_entry(struct rdxtree_node *node)
 }
 
 static int
-rdxtree_node_create(struct rdxtree_node **nodep, unsigned short height)
+rdxtree_node_create(struct rdxtree *tree, struct rdxtree_node **nodep,
+                    unsigned short height)
 {
     struct rdxtree_node *node;
 
@@ -147,7 +151,12 @@ rdxtree_node_create(struct rdxtree_node **nodep, unsigned short height)
     }
 #endif /* RDXTREE_ENABLE_NODE_CREATION_FAILURES */
 
-    node = malloc(sizeof(*node));
+    if (tree->arena == NULL) {
+        node = malloc(sizeof(*node));
+    } else {
+        node = arena_alloc(tree->arena, sizeof(*node),
+                           _Alignof(struct rdxtree_node));
+    }
 
     if (node == NULL) {
         return ENOMEM;
@@ -164,16 +173,31 @@ rdxtree_node_create(struct rdxtree_node **nodep, unsigned short height)
 }
 
 static void
-rdxtree_node_schedule_destruction(struct rdxtree_node *node)
+rdxtree_node_destroy(struct ebr_node *ebr_node)
+{
+    free(structof(ebr_node, struct rdxtree_node, ebr_node));
+}
+
+static void
+rdxtree_node_schedule_destruction(struct rdxtree *tree,
+                                  struct rdxtree_node *node)
 {
     /*
-     * This function is intended to use the appropriate interface to defer
-     * destruction until all read-side references are dropped in an
-     * environment that provides lockless synchronization.
+     * Nodes allocated from an arena are released with the arena.
      *
-     * Otherwise, it simply "schedules" destruction immediately.
+     * Otherwise, if the tree may be accessed locklessly, destruction is
+     * deferred until all read-side references are dropped. It's simply
+     * performed immediately in all other cases.
      */
-    free(node);
+    if (tree->arena != NULL) {
+        return;
+    }
+
+    if (tree->flags & RDXTREE_EBR) {
+        ebr_retire(&node->ebr_node, rdxtree_node_destroy);
+    } else {
+        free(node);
+    }
 }
 
 static inline void
@@ -329,7 +353,7 @@ rdxtree_shrink(struct rdxtree *tree)
         }
 
         rcu_store_ptr(tree->root, entry);
-        rdxtree_node_schedule_destruction(node);
+        rdxtree_node_schedule_destruction(tree, node);
     }
 }
 
@@ -354,7 +378,7 @@ rdxtree_grow(struct rdxtree *tree, rdxtree_key_t key)
     root = rdxtree_entry_addr(tree->root);
 
     do {
-        error = rdxtree_node_create(&node, tree->height);
+        error = rdxtree_node_create(tree, &node, tree->height);
 
         if (error) {
             rdxtree_shrink(tree);
@@ -400,7 +424,7 @@ rdxtree_cleanup(struct rdxtree *tree, struct rdxtree_node *node)
         if (node->parent == NULL) {
             tree->height = 0;
             rcu_store_ptr(tree->root, NULL);
-            rdxtree_node_schedule_destruction(node);
+            rdxtree_node_schedule_destruction(tree, node);
             break;
         }
 
@@ -408,7 +432,7 @@ rdxtree_cleanup(struct rdxtree *tree, struct rdxtree_node *node)
         node = node->parent;
         rdxtree_node_unlink(prev);
         rdxtree_node_remove(node, prev->index);
-        rdxtree_node_schedule_destruction(prev);
+        rdxtree_node_schedule_destruction(tree, prev);
     }
 }
 
@@ -469,7 +493,7 @@ rdxtree_insert_common(struct rdxtree *tree, rdxtree_key_t key,
 
     do {
         if (node == NULL) {
-            error = rdxtree_node_create(&node, height - 1);
+            error = rdxtree_node_create(tree, &node, height - 1);
 
             if (error) {
                 if (prev == NULL) {
@@ -551,7 +575,7 @@ rdxtree_insert_alloc_common(struct rdxtree *tree, void *ptr,
 
     do {
         if (node == NULL) {
-            error = rdxtree_node_create(&node, height - 1);
+            error = rdxtree_node_create(tree, &node, height - 1);
 
             if (error) {
                 rdxtree_cleanup(tree, prev);
@@ -847,7 +871,7 @@ rdxtree_remove_all(struct rdxtree *tree)
         parent = node->parent;
 
         if (parent == NULL) {
-            rdxtree_init(tree, tree->flags);
+            rdxtree_init_arena(tree, tree->flags, tree->arena);
         } else {
             if (rdxtree_key_alloc_enabled(tree)) {
                 rdxtree_remove_bm_set(parent, node->index);
@@ -858,6 +882,6 @@ rdxtree_remove_all(struct rdxtree *tree)
             node->parent = NULL;
         }
 
-        rdxtree_node_schedule_destruction(node);
+        rdxtree_node_schedule_destruction(tree, node);
     }
 }
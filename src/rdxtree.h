@@ -27,6 +27,15 @@
  *
  * In addition to the standard insertion operation, this implementation
  * can allocate keys for the caller at insertion time.
+ *
+ * Nodes are normally allocated with malloc(), but may also be allocated
+ * from an arena, in which case they're never released individually, and
+ * the whole tree can be discarded by rewinding the arena.
+ *
+ * Lookups may be performed concurrently with updates. In that case, trees
+ * must be initialized with RDXTREE_EBR, and lookups done inside epoch-based
+ * reclamation critical sections, so that removed nodes aren't released
+ * while readers may still access them.
  */
 
 #ifndef RDXTREE_H
@@ -37,12 +46,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
-/*
- * These macros can be replaced by actual functions in an environment
- * that provides lockless synchronization such as RCU.
- */
-#define rcu_store_ptr(ptr, value)       ((ptr) = (value))
-#define rcu_load_ptr(ptr)               (ptr)
+#include "rcu.h"
 
 /*
  * This macro selects between 32 or 64-bits (the default) keys.
@@ -61,6 +65,7 @@ typedef uint64_t rdxtree_key_t;
  * Radix tree initialization flags.
  */
 #define RDXTREE_KEY_ALLOC 0x1 /* Enable key allocation */
+#define RDXTREE_EBR       0x2 /* Release nodes with ebr_retire() */
 
 /*
  * Radix tree.
@@ -75,21 +80,40 @@ struct rdxtree_iter;
 /*
  * Static tree initializer.
  */
-#define RDXTREE_INITIALIZER { 0, NULL }
+#define RDXTREE_INITIALIZER { 0, 0, NULL, NULL }
 
 #include "rdxtree_i.h"
 
 /*
- * Initialize a tree.
+ * Initialize a tree which allocates its nodes from an arena.
+ *
+ * If arena is NULL, nodes are allocated with malloc(). Otherwise, nodes
+ * removed from the tree aren't released, and the arena must not be rewound
+ * to a position saved before the tree was last modified unless the tree is
+ * discarded or initialized again.
  */
 static inline void
-rdxtree_init(struct rdxtree *tree, unsigned short flags)
+rdxtree_init_arena(struct rdxtree *tree, unsigned short flags,
+                   struct arena *arena)
 {
-    assert((flags & ~RDXTREE_KEY_ALLOC) == 0);
+    assert((flags & ~(RDXTREE_KEY_ALLOC | RDXTREE_EBR)) == 0);
 
     tree->height = 0;
     tree->flags = flags;
     tree->root = NULL;
+    tree->arena = arena;
+}
+
+/*
+ * Initialize a tree.
+ *
+ * If RDXTREE_EBR is set, threads updating the tree must be registered
+ * with the ebr module.
+ */
+static inline void
+rdxtree_init(struct rdxtree *tree, unsigned short flags)
+{
+    rdxtree_init_arena(tree, flags, NULL);
 }
 
 /*
@@ -219,7 +243,8 @@ rdxtree_iter_key(const struct rdxtree_iter *iter)
  *
  * The common way to destroy a tree and its pointers is to loop over all
  * the pointers using rdxtree_for_each(), freeing them, then call this
- * function.
+ * function. Trees with nodes allocated from an arena may instead be
+ * discarded by rewinding or destroying the arena.
  */
 void rdxtree_remove_all(struct rdxtree *tree);
 
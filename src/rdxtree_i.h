@@ -29,6 +29,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+struct arena;
+
 /*
  * Radix tree.
  */
@@ -36,6 +38,7 @@ struct rdxtree {
     unsigned short height;
     unsigned short flags;
     void *root;
+    struct arena *arena;
 };
 
 /*
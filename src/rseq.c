@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "rseq.h"
+
+__thread struct rseq rseq_thread_area = {
+    .cpu_id = RSEQ_CPU_ID_UNINITIALIZED,
+};
+
+int
+rseq_register_thread(void)
+{
+#if defined(RSEQ_HAVE_CRITICAL_SECTIONS) && defined(SYS_rseq)
+    struct rseq *rs;
+    int error;
+
+    rs = rseq_get_area();
+
+    if ((int)rs->cpu_id >= 0) {
+        return rs->cpu_id;
+    }
+
+    if (rs != &rseq_thread_area) {
+        return -1;
+    }
+
+    error = syscall(SYS_rseq, rs, sizeof(*rs), 0, RSEQ_SIG);
+
+    if (error) {
+        rs->cpu_id = RSEQ_CPU_ID_REGISTRATION_FAILED;
+        return -1;
+    }
+
+    return *(volatile uint32_t *)&rs->cpu_id;
+#else /* RSEQ_HAVE_CRITICAL_SECTIONS && SYS_rseq */
+    return -1;
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS && SYS_rseq */
+}
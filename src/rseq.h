@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Restartable sequences.
+ *
+ * Restartable sequences are a Linux facility through which the kernel
+ * publishes the current processor of a thread in a per-thread area, and
+ * aborts short critical sections of user code if the thread is preempted,
+ * migrated or interrupted by a signal before they commit. This makes it
+ * possible to read the current processor with a plain load, and to update
+ * per-processor data without atomic instructions.
+ *
+ * If the C library already registered an area for the calling thread,
+ * that area is used. Otherwise, threads register their own area on first
+ * use. Critical sections are only implemented on x86_64. On other
+ * architectures, or if restartable sequences aren't supported by the
+ * kernel, rseq_cpu_id() returns -1, and callers must use a fallback.
+ *
+ * Since critical sections and fallbacks usually don't synchronize with
+ * each other, all threads updating the same data must use the same
+ * method. In practice, registration either succeeds or fails for all
+ * threads of a process.
+ */
+
+#ifndef RSEQ_H
+#define RSEQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef HAVE_SYS_RSEQ_H
+#include <sys/rseq.h>
+#else /* HAVE_SYS_RSEQ_H */
+#include <linux/rseq.h>
+#endif /* HAVE_SYS_RSEQ_H */
+
+#include "macros.h"
+
+#ifndef RSEQ_SIG
+#define RSEQ_SIG 0x53053053
+#endif /* RSEQ_SIG */
+
+#ifdef __x86_64__
+#define RSEQ_HAVE_CRITICAL_SECTIONS
+#endif /* __x86_64__ */
+
+extern __thread struct rseq rseq_thread_area;
+
+/*
+ * Return the restartable sequence area of the calling thread.
+ */
+static inline struct rseq *
+rseq_get_area(void)
+{
+#if defined(HAVE_SYS_RSEQ_H) && defined(RSEQ_HAVE_CRITICAL_SECTIONS)
+    if (__rseq_size != 0) {
+        return (struct rseq *)((char *)__builtin_thread_pointer()
+                               + __rseq_offset);
+    }
+#endif /* HAVE_SYS_RSEQ_H && RSEQ_HAVE_CRITICAL_SECTIONS */
+
+    return &rseq_thread_area;
+}
+
+/*
+ * Register the restartable sequence area of the calling thread.
+ *
+ * Return the current processor, or -1 if registration failed.
+ */
+int rseq_register_thread(void);
+
+/*
+ * Return the ID of the processor the calling thread is running on, or -1
+ * if restartable sequences can't be used.
+ *
+ * The returned ID is meant to be passed to critical sections, which abort
+ * if the thread isn't running on that processor any more.
+ */
+static inline int
+rseq_cpu_id(void)
+{
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+    int cpu;
+
+    cpu = (int)*(volatile uint32_t *)&rseq_get_area()->cpu_id;
+
+    if (likely(cpu >= 0)) {
+        return cpu;
+    }
+
+    if (cpu == RSEQ_CPU_ID_REGISTRATION_FAILED) {
+        return -1;
+    }
+
+    return rseq_register_thread();
+#else /* RSEQ_HAVE_CRITICAL_SECTIONS */
+    return -1;
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+}
+
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+
+/*
+ * Building blocks of critical sections, based on the reference
+ * implementation of the Linux kernel selftests.
+ *
+ * A critical section is described by a rseq_cs structure, and is made of
+ * a start label (1), a commit label (2), right after the instruction that
+ * commits the changes, and an abort handler (4), preceded by the RSEQ_SIG
+ * signature, in a separate section.
+ */
+#define RSEQ_ASM_DEFINE_TABLE(label, start_ip, post_commit_ip, abort_ip)   \
+    ".pushsection __rseq_cs, \"aw\"\n\t"                                    \
+    ".balign 32\n\t"                                                        \
+    QUOTE(label) ":\n\t"                                                    \
+    ".long 0, 0\n\t"                                                        \
+    ".quad " QUOTE(start_ip) ", " QUOTE(post_commit_ip) " - "               \
+    QUOTE(start_ip) ", " QUOTE(abort_ip) "\n\t"                             \
+    ".popsection\n\t"
+
+#define RSEQ_ASM_STORE_RSEQ_CS(label, cs_label, rseq_cs)                    \
+    QUOTE(label) ":\n\t"                                                    \
+    "leaq " QUOTE(cs_label) "(%%rip), %%rax\n\t"                            \
+    "movq %%rax, " QUOTE(rseq_cs) "\n\t"
+
+#define RSEQ_ASM_CMP_CPU_ID(cpu_id, current_cpu_id, label)                  \
+    "cmpl %[" QUOTE(cpu_id) "], " QUOTE(current_cpu_id) "\n\t"              \
+    "jnz " QUOTE(label) "\n\t"
+
+#define RSEQ_ASM_DEFINE_ABORT(label, abort_label)                           \
+    ".pushsection __rseq_failure, \"ax\"\n\t"                               \
+    ".byte 0x0f, 0xb9, 0x3d\n\t"                                            \
+    ".long " QUOTE(RSEQ_SIG) "\n\t"                                         \
+    QUOTE(label) ":\n\t"                                                    \
+    "jmp %l[" QUOTE(abort_label) "]\n\t"                                    \
+    ".popsection\n\t"
+
+/*
+ * Add a value to the word at the given address, if the calling thread is
+ * running on the given processor.
+ *
+ * Return 0 on success, -1 if the critical section was aborted.
+ */
+static inline int
+rseq_addv(intptr_t *v, intptr_t count, int cpu)
+{
+    struct rseq *rs;
+
+    rs = rseq_get_area();
+
+    asm volatile goto(
+        RSEQ_ASM_DEFINE_TABLE(3, 1f, 2f, 4f)
+        RSEQ_ASM_STORE_RSEQ_CS(1, 3b, %[rseq_cs])
+        RSEQ_ASM_CMP_CPU_ID(cpu_id, %[current_cpu_id], 4f)
+        "addq %[count], %[v]\n\t"
+        "2:\n\t"
+        RSEQ_ASM_DEFINE_ABORT(4, abort)
+        : /* no output */
+        : [cpu_id] "r" (cpu),
+          [current_cpu_id] "m" (rs->cpu_id),
+          [rseq_cs] "m" (rs->rseq_cs),
+          [v] "m" (*v),
+          [count] "er" (count)
+        : "memory", "cc", "rax"
+        : abort);
+
+    return 0;
+
+abort:
+    return -1;
+}
+
+/*
+ * Store newv at the given address if it contains expect, and the calling
+ * thread is running on the given processor.
+ *
+ * Return 0 on success, 1 if the comparison failed, -1 if the critical
+ * section was aborted.
+ */
+static inline int
+rseq_cmpeqv_storev(intptr_t *v, intptr_t expect, intptr_t newv, int cpu)
+{
+    struct rseq *rs;
+
+    rs = rseq_get_area();
+
+    asm volatile goto(
+        RSEQ_ASM_DEFINE_TABLE(3, 1f, 2f, 4f)
+        RSEQ_ASM_STORE_RSEQ_CS(1, 3b, %[rseq_cs])
+        RSEQ_ASM_CMP_CPU_ID(cpu_id, %[current_cpu_id], 4f)
+        "cmpq %[v], %[expect]\n\t"
+        "jnz %l[cmpfail]\n\t"
+        "movq %[newv], %[v]\n\t"
+        "2:\n\t"
+        RSEQ_ASM_DEFINE_ABORT(4, abort)
+        : /* no output */
+        : [cpu_id] "r" (cpu),
+          [current_cpu_id] "m" (rs->cpu_id),
+          [rseq_cs] "m" (rs->rseq_cs),
+          [v] "m" (*v),
+          [expect] "r" (expect),
+          [newv] "r" (newv)
+        : "memory", "cc", "rax"
+        : abort, cmpfail);
+
+    return 0;
+
+abort:
+    return -1;
+
+cmpfail:
+    return 1;
+}
+
+/*
+ * Pop the first node of a singly-linked list, the head of which is stored
+ * at the given address, if the calling thread is running on the given
+ * processor.
+ *
+ * The next pointer of nodes must be stored at offset 0.
+ *
+ * Return 0 on success, 1 if the list is empty, -1 if the critical section
+ * was aborted. On success, the popped node is stored in *nodep.
+ */
+static inline int
+rseq_list_pop(intptr_t *head, intptr_t *nodep, int cpu)
+{
+    struct rseq *rs;
+
+    rs = rseq_get_area();
+
+    asm volatile goto(
+        RSEQ_ASM_DEFINE_TABLE(3, 1f, 2f, 4f)
+        RSEQ_ASM_STORE_RSEQ_CS(1, 3b, %[rseq_cs])
+        RSEQ_ASM_CMP_CPU_ID(cpu_id, %[current_cpu_id], 4f)
+        "movq %[head], %%rbx\n\t"
+        "testq %%rbx, %%rbx\n\t"
+        "jz %l[empty]\n\t"
+        "movq %%rbx, %[node]\n\t"
+        "movq (%%rbx), %%rbx\n\t"
+        "movq %%rbx, %[head]\n\t"
+        "2:\n\t"
+        RSEQ_ASM_DEFINE_ABORT(4, abort)
+        : /* no output */
+        : [cpu_id] "r" (cpu),
+          [current_cpu_id] "m" (rs->cpu_id),
+          [rseq_cs] "m" (rs->rseq_cs),
+          [head] "m" (*head),
+          [node] "m" (*nodep)
+        : "memory", "cc", "rax", "rbx"
+        : abort, empty);
+
+    return 0;
+
+abort:
+    return -1;
+
+empty:
+    return 1;
+}
+
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+
+#endif /* RSEQ_H */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Sequence locks.
+ *
+ * A sequence lock lets readers run concurrently with writers without
+ * writing to shared memory. Writers serialize with a spin lock, and
+ * increment a sequence number before and after updating the protected
+ * data. Readers sample the sequence number before and after reading the
+ * data, and retry if it changed, or if a writer was active :
+ *
+ *  do {
+ *      seq = seqlock_read_begin(&seqlock);
+ *      x = READ_ONCE(data->x);
+ *      y = READ_ONCE(data->y);
+ *  } while (seqlock_read_retry(&seqlock, seq));
+ *
+ * Since readers may observe data being modified, they must not follow
+ * pointers read from protected data, and should access it with READ_ONCE().
+ * Sequence locks suit small, frequently read and rarely written data.
+ *
+ * When built with --enable-lock-stats, the number of read retries is also
+ * counted.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "macros.h"
+#include "spinlock.h"
+
+/*
+ * Sequence lock statistics.
+ */
+struct seqlock_stats {
+    struct spinlock_stats write;
+    unsigned long nr_read_retries;
+};
+
+/*
+ * Sequence lock.
+ *
+ * The sequence number is odd while a writer is active.
+ */
+struct seqlock {
+    atomic_uint seq;
+    struct spinlock lock;
+#ifdef CONFIG_LOCK_STATS
+    atomic_ulong nr_read_retries;
+#endif /* CONFIG_LOCK_STATS */
+};
+
+#define SEQLOCK_INITIALIZER { .seq = 0, .lock = SPINLOCK_INITIALIZER }
+
+static inline void
+seqlock_init(struct seqlock *seqlock)
+{
+    atomic_init(&seqlock->seq, 0);
+    spinlock_init(&seqlock->lock);
+#ifdef CONFIG_LOCK_STATS
+    atomic_init(&seqlock->nr_read_retries, 0);
+#endif /* CONFIG_LOCK_STATS */
+}
+
+/*
+ * Begin a read-side critical section.
+ *
+ * If a writer is active, wait for it to complete.
+ */
+static inline unsigned int
+seqlock_read_begin(const struct seqlock *seqlock)
+{
+    unsigned int seq, nr_spins;
+
+    seq = atomic_load_explicit(&seqlock->seq, memory_order_acquire);
+
+    if (unlikely(seq & 1)) {
+        nr_spins = 0;
+
+        do {
+            spinlock_relax(&nr_spins);
+            seq = atomic_load_explicit(&seqlock->seq, memory_order_acquire);
+        } while (seq & 1);
+    }
+
+    return seq;
+}
+
+/*
+ * End a read-side critical section.
+ *
+ * Return true if the data may have been modified while it was read, in
+ * which case the critical section must be restarted.
+ */
+static inline bool
+seqlock_read_retry(struct seqlock *seqlock, unsigned int seq)
+{
+    bool retry;
+
+    atomic_thread_fence(memory_order_acquire);
+    retry = (atomic_load_explicit(&seqlock->seq, memory_order_relaxed) != seq);
+
+#ifdef CONFIG_LOCK_STATS
+    if (retry) {
+        atomic_fetch_add_explicit(&seqlock->nr_read_retries, 1,
+                                  memory_order_relaxed);
+    }
+#endif /* CONFIG_LOCK_STATS */
+
+    return retry;
+}
+
+/*
+ * Begin a write-side critical section.
+ */
+static inline void
+seqlock_write_lock(struct seqlock *seqlock)
+{
+    unsigned int seq;
+
+    spinlock_lock(&seqlock->lock);
+    seq = atomic_load_explicit(&seqlock->seq, memory_order_relaxed);
+    atomic_store_explicit(&seqlock->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/*
+ * End a write-side critical section.
+ */
+static inline void
+seqlock_write_unlock(struct seqlock *seqlock)
+{
+    unsigned int seq;
+
+    seq = atomic_load_explicit(&seqlock->seq, memory_order_relaxed);
+    atomic_store_explicit(&seqlock->seq, seq + 1, memory_order_release);
+    spinlock_unlock(&seqlock->lock);
+}
+
+static inline void
+seqlock_get_stats(const struct seqlock *seqlock, struct seqlock_stats *stats)
+{
+    spinlock_get_stats(&seqlock->lock, &stats->write);
+#ifdef CONFIG_LOCK_STATS
+    stats->nr_read_retries = atomic_load_explicit(&seqlock->nr_read_retries,
+                                                  memory_order_relaxed);
+#else /* CONFIG_LOCK_STATS */
+    stats->nr_read_retries = 0;
+#endif /* CONFIG_LOCK_STATS */
+}
+
+#endif /* SEQLOCK_H */
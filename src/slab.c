@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "list.h"
+#include "macros.h"
+#include "percpu.h"
+#include "slab.h"
+
+/*
+ * Minimum size of a slab.
+ */
+#define SLAB_SLAB_SIZE_MIN 4096
+
+/*
+ * Maximum fraction of a slab that may be left unused by buffers.
+ */
+#define SLAB_WASTE_RATIO 8
+
+/*
+ * Slab header, stored at the beginning of its memory block.
+ */
+struct slab {
+    struct list node;
+    unsigned int nr_refs;
+    struct slab_bufctl *first_free;
+};
+
+/*
+ * Free buffer, linked in the free list of its slab.
+ */
+struct slab_bufctl {
+    struct slab_bufctl *next;
+};
+
+/*
+ * Per-processor pool of an object cache.
+ *
+ * The rounds array is the magazine of the processor, its size being
+ * given by the cache.
+ */
+struct slab_cpu_pool {
+    pthread_mutex_t lock;
+    unsigned int nr_rounds;
+    unsigned long nr_allocs;
+    unsigned long nr_frees;
+    unsigned long nr_misses;
+    void *rounds[];
+};
+
+/*
+ * Magazine sizes, selected by buffer size.
+ *
+ * Larger objects use smaller magazines to limit the amount of memory
+ * cached by processors.
+ */
+static const struct {
+    size_t buf_size;
+    unsigned int magazine_size;
+} slab_magazine_sizes[] = {
+    { 32768, 4 },
+    { 4096, 16 },
+    { 256, 64 },
+    { 0, 128 },
+};
+
+static unsigned int
+slab_select_magazine_size(size_t buf_size)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(slab_magazine_sizes); i++) {
+        if (buf_size > slab_magazine_sizes[i].buf_size) {
+            break;
+        }
+    }
+
+    assert(i < ARRAY_SIZE(slab_magazine_sizes));
+    return slab_magazine_sizes[i].magazine_size;
+}
+
+/*
+ * Compute the size of slabs, the smallest power of two that can hold at
+ * least one buffer while wasting a bounded fraction of its memory.
+ */
+static void
+slab_cache_compute_layout(struct slab_cache *cache)
+{
+    size_t slab_size, waste;
+    unsigned int nr_bufs;
+
+    cache->bufs_offset = P2ROUND(sizeof(struct slab), cache->align);
+    slab_size = SLAB_SLAB_SIZE_MIN;
+
+    for (;;) {
+        if (slab_size >= (cache->bufs_offset + cache->buf_size)) {
+            nr_bufs = (slab_size - cache->bufs_offset) / cache->buf_size;
+            waste = slab_size - cache->bufs_offset
+                    - (nr_bufs * cache->buf_size);
+
+            if (waste <= (slab_size / SLAB_WASTE_RATIO)) {
+                break;
+            }
+        }
+
+        slab_size <<= 1;
+    }
+
+    cache->slab_size = slab_size;
+    cache->bufs_per_slab = nr_bufs;
+    cache->color = 0;
+    cache->color_step = MAX(cache->align, cpu_l1_size());
+    cache->color_max = P2ALIGN(waste, cache->color_step);
+}
+
+static struct slab_cpu_pool *
+slab_cache_get_cpu_pool(const struct slab_cache *cache, unsigned int cpu)
+{
+    return percpu_area_ptr(&cache->cpu_pools, cpu);
+}
+
+int
+slab_cache_init(struct slab_cache *cache, const char *name,
+                size_t obj_size, size_t align)
+{
+    struct slab_cpu_pool *pool;
+    unsigned int cpu;
+    size_t size;
+    int error;
+
+    assert(obj_size != 0);
+
+    if (align == 0) {
+        align = _Alignof(max_align_t);
+    }
+
+    assert(ISP2(align));
+
+    pthread_mutex_init(&cache->lock, NULL);
+    list_init(&cache->partial_slabs);
+    list_init(&cache->free_slabs);
+    cache->obj_size = obj_size;
+    cache->align = align;
+    cache->buf_size = P2ROUND(MAX(obj_size, sizeof(struct slab_bufctl)),
+                              align);
+    slab_cache_compute_layout(cache);
+    cache->magazine_size = slab_select_magazine_size(cache->buf_size);
+    cache->nr_objs = 0;
+    cache->nr_bufs = 0;
+    cache->nr_slabs = 0;
+    cache->nr_free_slabs = 0;
+    snprintf(cache->name, sizeof(cache->name), "%s", name);
+
+    size = sizeof(*pool) + (cache->magazine_size * sizeof(pool->rounds[0]));
+    error = percpu_area_init(&cache->cpu_pools, size);
+
+    if (error) {
+        pthread_mutex_destroy(&cache->lock);
+        return error;
+    }
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&cache->cpu_pools); cpu++) {
+        pool = slab_cache_get_cpu_pool(cache, cpu);
+        pthread_mutex_init(&pool->lock, NULL);
+    }
+
+    return 0;
+}
+
+static struct slab *
+slab_create(struct slab_cache *cache)
+{
+    struct slab_bufctl *bufctl, **prevp;
+    struct slab *slab;
+    unsigned int i;
+    char *buf;
+    void *addr;
+    int error;
+
+    error = posix_memalign(&addr, cache->slab_size, cache->slab_size);
+
+    if (error) {
+        return NULL;
+    }
+
+    slab = addr;
+    slab->nr_refs = 0;
+    buf = (char *)addr + cache->bufs_offset + cache->color;
+    prevp = &slab->first_free;
+
+    for (i = 0; i < cache->bufs_per_slab; i++) {
+        bufctl = (struct slab_bufctl *)buf;
+        *prevp = bufctl;
+        prevp = &bufctl->next;
+        buf += cache->buf_size;
+    }
+
+    *prevp = NULL;
+
+    cache->color += cache->color_step;
+
+    if (cache->color > cache->color_max) {
+        cache->color = 0;
+    }
+
+    cache->nr_bufs += cache->bufs_per_slab;
+    cache->nr_slabs++;
+    return slab;
+}
+
+static void
+slab_destroy(struct slab_cache *cache, struct slab *slab)
+{
+    assert(slab->nr_refs == 0);
+
+    cache->nr_bufs -= cache->bufs_per_slab;
+    cache->nr_slabs--;
+    free(slab);
+}
+
+static struct slab *
+slab_cache_lookup_slab(const struct slab_cache *cache, void *obj)
+{
+    return (struct slab *)P2ALIGN((uintptr_t)obj, cache->slab_size);
+}
+
+/*
+ * Allocate a buffer from the slab layer.
+ *
+ * The cache must be locked.
+ */
+static void *
+slab_cache_alloc_from_slab(struct slab_cache *cache)
+{
+    struct slab_bufctl *bufctl;
+    struct slab *slab;
+
+    if (!list_empty(&cache->partial_slabs)) {
+        slab = list_first_entry(&cache->partial_slabs, struct slab, node);
+    } else {
+        if (!list_empty(&cache->free_slabs)) {
+            slab = list_first_entry(&cache->free_slabs, struct slab, node);
+            list_remove(&slab->node);
+            cache->nr_free_slabs--;
+        } else {
+            slab = slab_create(cache);
+
+            if (slab == NULL) {
+                return NULL;
+            }
+        }
+
+        list_insert_head(&cache->partial_slabs, &slab->node);
+    }
+
+    bufctl = slab->first_free;
+    assert(bufctl != NULL);
+    slab->first_free = bufctl->next;
+    slab->nr_refs++;
+    cache->nr_objs++;
+
+    /* Full slabs aren't linked in any list */
+    if (slab->nr_refs == cache->bufs_per_slab) {
+        list_remove(&slab->node);
+    }
+
+    return bufctl;
+}
+
+/*
+ * Release a buffer to the slab layer.
+ *
+ * The cache must be locked.
+ */
+static void
+slab_cache_free_to_slab(struct slab_cache *cache, void *buf)
+{
+    struct slab_bufctl *bufctl;
+    struct slab *slab;
+    bool was_full;
+
+    slab = slab_cache_lookup_slab(cache, buf);
+    assert(slab->nr_refs != 0);
+    assert(((char *)buf - (char *)slab) >= (ptrdiff_t)cache->bufs_offset);
+
+    was_full = (slab->nr_refs == cache->bufs_per_slab);
+    bufctl = buf;
+    bufctl->next = slab->first_free;
+    slab->first_free = bufctl;
+    slab->nr_refs--;
+    cache->nr_objs--;
+
+    if (slab->nr_refs == 0) {
+        if (!was_full) {
+            list_remove(&slab->node);
+        }
+
+        if (((cache->nr_free_slabs + 1) * 2) > cache->nr_slabs) {
+            slab_destroy(cache, slab);
+        } else {
+            list_insert_head(&cache->free_slabs, &slab->node);
+            cache->nr_free_slabs++;
+        }
+    } else if (was_full) {
+        list_insert_head(&cache->partial_slabs, &slab->node);
+    }
+}
+
+/*
+ * Fill an empty magazine with up to half its capacity.
+ *
+ * The pool must be locked. Return the number of objects transferred.
+ */
+static unsigned int
+slab_cpu_pool_fill(struct slab_cpu_pool *pool, struct slab_cache *cache)
+{
+    unsigned int i, transfer_size;
+    void *buf;
+
+    transfer_size = DIV_CEIL(cache->magazine_size, 2);
+
+    pthread_mutex_lock(&cache->lock);
+
+    for (i = 0; i < transfer_size; i++) {
+        buf = slab_cache_alloc_from_slab(cache);
+
+        if (buf == NULL) {
+            break;
+        }
+
+        pool->rounds[pool->nr_rounds] = buf;
+        pool->nr_rounds++;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return i;
+}
+
+/*
+ * Return up to the given number of objects from a magazine to the slab
+ * layer.
+ *
+ * The pool must be locked.
+ */
+static void
+slab_cpu_pool_drain(struct slab_cpu_pool *pool, struct slab_cache *cache,
+                    unsigned int nr_objs)
+{
+    nr_objs = MIN(nr_objs, pool->nr_rounds);
+
+    pthread_mutex_lock(&cache->lock);
+
+    while (nr_objs != 0) {
+        pool->nr_rounds--;
+        slab_cache_free_to_slab(cache, pool->rounds[pool->nr_rounds]);
+        nr_objs--;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void *
+slab_cache_alloc(struct slab_cache *cache)
+{
+    struct slab_cpu_pool *pool;
+    void *obj;
+
+    pool = percpu_area_local_ptr(&cache->cpu_pools);
+    pthread_mutex_lock(&pool->lock);
+
+    if (unlikely(pool->nr_rounds == 0)) {
+        pool->nr_misses++;
+
+        if (slab_cpu_pool_fill(pool, cache) == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+    }
+
+    pool->nr_rounds--;
+    obj = pool->rounds[pool->nr_rounds];
+    pool->nr_allocs++;
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return obj;
+}
+
+void
+slab_cache_free(struct slab_cache *cache, void *obj)
+{
+    struct slab_cpu_pool *pool;
+
+    assert(obj != NULL);
+
+    pool = percpu_area_local_ptr(&cache->cpu_pools);
+    pthread_mutex_lock(&pool->lock);
+
+    if (unlikely(pool->nr_rounds == cache->magazine_size)) {
+        pool->nr_misses++;
+        slab_cpu_pool_drain(pool, cache, DIV_CEIL(cache->magazine_size, 2));
+    }
+
+    pool->rounds[pool->nr_rounds] = obj;
+    pool->nr_rounds++;
+    pool->nr_frees++;
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void
+slab_cache_reap(struct slab_cache *cache)
+{
+    struct slab_cpu_pool *pool;
+    struct slab *slab;
+    unsigned int cpu;
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&cache->cpu_pools); cpu++) {
+        pool = slab_cache_get_cpu_pool(cache, cpu);
+        pthread_mutex_lock(&pool->lock);
+        slab_cpu_pool_drain(pool, cache, pool->nr_rounds);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+
+    while (!list_empty(&cache->free_slabs)) {
+        slab = list_first_entry(&cache->free_slabs, struct slab, node);
+        list_remove(&slab->node);
+        cache->nr_free_slabs--;
+        slab_destroy(cache, slab);
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void
+slab_cache_destroy(struct slab_cache *cache)
+{
+    struct slab_cpu_pool *pool;
+    unsigned int cpu;
+
+    slab_cache_reap(cache);
+
+    assert(cache->nr_objs == 0);
+    assert(cache->nr_slabs == 0);
+    assert(list_empty(&cache->partial_slabs));
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&cache->cpu_pools); cpu++) {
+        pool = slab_cache_get_cpu_pool(cache, cpu);
+        pthread_mutex_destroy(&pool->lock);
+    }
+
+    percpu_area_destroy(&cache->cpu_pools);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+void
+slab_cache_stats(struct slab_cache *cache, struct slab_cache_stats *stats)
+{
+    struct slab_cpu_pool *pool;
+    unsigned int cpu;
+
+    stats->obj_size = cache->obj_size;
+    stats->buf_size = cache->buf_size;
+    stats->slab_size = cache->slab_size;
+    stats->bufs_per_slab = cache->bufs_per_slab;
+    stats->magazine_size = cache->magazine_size;
+    stats->nr_cached_objs = 0;
+    stats->nr_allocs = 0;
+    stats->nr_frees = 0;
+    stats->nr_magazine_misses = 0;
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&cache->cpu_pools); cpu++) {
+        pool = slab_cache_get_cpu_pool(cache, cpu);
+        pthread_mutex_lock(&pool->lock);
+        stats->nr_cached_objs += pool->nr_rounds;
+        stats->nr_allocs += pool->nr_allocs;
+        stats->nr_frees += pool->nr_frees;
+        stats->nr_magazine_misses += pool->nr_misses;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    stats->nr_objs = cache->nr_objs;
+    stats->nr_bufs = cache->nr_bufs;
+    stats->nr_slabs = cache->nr_slabs;
+    stats->nr_free_slabs = cache->nr_free_slabs;
+    pthread_mutex_unlock(&cache->lock);
+
+    /*
+     * Magazines and the slab layer aren't sampled atomically, and objects
+     * may move between them in the meantime.
+     */
+    if (stats->nr_objs < stats->nr_cached_objs) {
+        stats->nr_objs = 0;
+    } else {
+        stats->nr_objs -= stats->nr_cached_objs;
+    }
+}
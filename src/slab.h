@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Object cache allocator.
+ *
+ * An object cache, or slab cache, allocates objects of a fixed size. Objects
+ * are carved out of slabs, blocks of memory obtained from the C library
+ * whose size is a power of two, and which are aligned on their size, so
+ * that the slab of an object can be found by masking its address. The
+ * first buffer of a slab is offset by a color, a multiple of the cache
+ * line size that changes with each slab, so that objects at the same index
+ * in different slabs don't always map to the same cache sets.
+ *
+ * Each processor has a magazine, an array of cached objects, protected by
+ * its own lock. Allocations and releases normally only access the
+ * magazine of the local processor, and only when it's empty or full are
+ * objects transferred, in batches, to or from the slab layer, which is
+ * protected by a global lock.
+ *
+ * Slabs with no allocated objects are released when they make up more
+ * than half of the slabs of a cache, and all of them are released by
+ * slab_cache_reap().
+ *
+ * The content of objects isn't preserved across allocations.
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "list.h"
+#include "percpu.h"
+
+/*
+ * Maximum length of a cache name, including the null terminating character.
+ */
+#define SLAB_NAME_SIZE 32
+
+/*
+ * Object cache.
+ *
+ * Members read on every allocation and release come first, and members
+ * protected by the cache lock start on another cache line, so that
+ * processors accessing the slab layer don't slow down those which only
+ * access their magazine.
+ */
+struct slab_cache {
+    struct percpu_area cpu_pools;
+    size_t obj_size;
+    size_t align;
+    size_t buf_size;
+    size_t slab_size;
+    size_t bufs_offset;
+    size_t color_step;
+    size_t color_max;
+    unsigned int bufs_per_slab;
+    unsigned int magazine_size;
+    char name[SLAB_NAME_SIZE];
+    pthread_mutex_t lock __cacheline_aligned;
+    struct list partial_slabs;
+    struct list free_slabs;
+    size_t color;
+    unsigned long nr_objs;
+    unsigned long nr_bufs;
+    unsigned long nr_slabs;
+    unsigned long nr_free_slabs;
+};
+
+/*
+ * Object cache statistics.
+ *
+ * The nr_objs member is the number of objects allocated by users, and
+ * nr_cached_objs the number of free objects cached in magazines, which
+ * the slab layer counts as allocated. Allocations, releases and magazine
+ * misses are counted per call. With concurrent use, these statistics are
+ * approximate.
+ */
+struct slab_cache_stats {
+    size_t obj_size;
+    size_t buf_size;
+    size_t slab_size;
+    unsigned int bufs_per_slab;
+    unsigned int magazine_size;
+    unsigned long nr_objs;
+    unsigned long nr_cached_objs;
+    unsigned long nr_bufs;
+    unsigned long nr_slabs;
+    unsigned long nr_free_slabs;
+    unsigned long nr_allocs;
+    unsigned long nr_frees;
+    unsigned long nr_magazine_misses;
+};
+
+/*
+ * Initialize an object cache.
+ *
+ * The alignment must be a power of two, or 0, in which case objects are
+ * aligned as required for any standard type. The name is only used for
+ * reporting, and is truncated if too long.
+ *
+ * If memory can't be allocated for the magazines, ENOMEM is returned.
+ */
+int slab_cache_init(struct slab_cache *cache, const char *name,
+                    size_t obj_size, size_t align);
+
+/*
+ * Destroy an object cache.
+ *
+ * All objects must have been released.
+ */
+void slab_cache_destroy(struct slab_cache *cache);
+
+/*
+ * Allocate an object.
+ *
+ * If memory can't be allocated, NULL is returned.
+ */
+void * slab_cache_alloc(struct slab_cache *cache);
+
+/*
+ * Release an object.
+ */
+void slab_cache_free(struct slab_cache *cache, void *obj);
+
+/*
+ * Release the memory of all unused slabs of an object cache.
+ *
+ * Objects cached in magazines are first returned to the slab layer.
+ */
+void slab_cache_reap(struct slab_cache *cache);
+
+/*
+ * Return the name of an object cache.
+ */
+static inline const char *
+slab_cache_name(const struct slab_cache *cache)
+{
+    return cache->name;
+}
+
+/*
+ * Obtain statistics about an object cache.
+ */
+void slab_cache_stats(struct slab_cache *cache, struct slab_cache_stats *stats);
+
+#endif /* SLAB_H */
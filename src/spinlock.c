@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu.h"
+#include "macros.h"
+#include "spinlock.h"
+
+/*
+ * Number of times a waiter spins before yielding the processor.
+ */
+#define SPINLOCK_MAX_SPINS 1000
+
+void
+spinlock_relax(unsigned int *nr_spins)
+{
+    if ((*nr_spins >= SPINLOCK_MAX_SPINS) || (cpu_count() == 1)) {
+        *nr_spins = 0;
+        sched_yield();
+        return;
+    }
+
+    (*nr_spins)++;
+    cpu_relax();
+}
+
+void
+spinlock_init(struct spinlock *lock)
+{
+    atomic_init(&lock->locked, 0);
+#ifdef CONFIG_LOCK_STATS
+    lock->stats.nr_acquires = 0;
+    lock->stats.nr_contended = 0;
+#endif /* CONFIG_LOCK_STATS */
+}
+
+void
+spinlock_lock_slow(struct spinlock *lock)
+{
+    unsigned int nr_spins;
+
+    nr_spins = 0;
+
+    /* Only attempt to acquire the lock when it looks free */
+    do {
+        while (atomic_load_explicit(&lock->locked, memory_order_relaxed)) {
+            spinlock_relax(&nr_spins);
+        }
+    } while (atomic_exchange_explicit(&lock->locked, 1, memory_order_acquire));
+
+    spinlock_stats_record(&lock->stats, true);
+}
+
+void
+ticketlock_init(struct ticketlock *lock)
+{
+    atomic_init(&lock->next, 0);
+    atomic_init(&lock->owner, 0);
+#ifdef CONFIG_LOCK_STATS
+    lock->stats.nr_acquires = 0;
+    lock->stats.nr_contended = 0;
+#endif /* CONFIG_LOCK_STATS */
+}
+
+void
+ticketlock_lock_slow(struct ticketlock *lock, unsigned int ticket)
+{
+    unsigned int nr_spins;
+
+    nr_spins = 0;
+
+    while (atomic_load_explicit(&lock->owner, memory_order_acquire) != ticket) {
+        spinlock_relax(&nr_spins);
+    }
+
+    spinlock_stats_record(&lock->stats, true);
+}
+
+void
+mcslock_init(struct mcslock *lock)
+{
+    atomic_init(&lock->tail, NULL);
+#ifdef CONFIG_LOCK_STATS
+    lock->stats.nr_acquires = 0;
+    lock->stats.nr_contended = 0;
+#endif /* CONFIG_LOCK_STATS */
+}
+
+void
+mcslock_lock_slow(struct mcslock *lock __unused,
+                  struct mcslock_qnode *qnode, struct mcslock_qnode *prev)
+{
+    unsigned int nr_spins;
+
+    atomic_store_explicit(&prev->next, qnode, memory_order_release);
+    nr_spins = 0;
+
+    while (atomic_load_explicit(&qnode->locked, memory_order_acquire)) {
+        spinlock_relax(&nr_spins);
+    }
+
+    spinlock_stats_record(&lock->stats, true);
+}
+
+void
+mcslock_unlock_slow(struct mcslock_qnode *qnode)
+{
+    struct mcslock_qnode *next;
+    unsigned int nr_spins;
+
+    /* A new waiter swapped the tail, wait for it to link its node */
+    nr_spins = 0;
+
+    for (;;) {
+        next = atomic_load_explicit(&qnode->next, memory_order_acquire);
+
+        if (next != NULL) {
+            break;
+        }
+
+        spinlock_relax(&nr_spins);
+    }
+
+    atomic_store_explicit(&next->locked, false, memory_order_release);
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Spin locks.
+ *
+ * This module provides three kinds of busy-waiting locks, meant to protect
+ * short critical sections when threads rarely get preempted while holding
+ * them :
+ *  - simple spin locks, which are small and fast without contention, but
+ *    unfair, and make all waiters spin on the same cache line
+ *  - ticket locks, which grant the lock in request order, but still make
+ *    waiters spin on the same cache line
+ *  - MCS locks, which grant the lock in request order and make each waiter
+ *    spin on its own queue node, and therefore scale best under heavy
+ *    contention, at the cost of passing a queue node to lock and unlock
+ *
+ * Waiters spin for a while, and yield the processor if the lock is still
+ * unavailable, so that a preempted owner can run. On machines with a
+ * single processor, as reported by cpu_count(), waiters yield at once.
+ *
+ * When built with --enable-lock-stats, locks count acquisitions, and
+ * contended acquisitions, i.e. those that had to wait. Counters are updated
+ * with the lock held. Otherwise, statistics are always zero.
+ */
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu.h"
+#include "macros.h"
+
+/*
+ * Lock statistics.
+ */
+struct spinlock_stats {
+    unsigned long nr_acquires;
+    unsigned long nr_contended;
+};
+
+#ifdef CONFIG_LOCK_STATS
+static inline void
+spinlock_stats_record(struct spinlock_stats *stats, bool contended)
+{
+    stats->nr_acquires++;
+
+    if (contended) {
+        stats->nr_contended++;
+    }
+}
+
+#define spinlock_stats_get(lock, stats) (*(stats) = (lock)->stats)
+#else /* CONFIG_LOCK_STATS */
+#define spinlock_stats_record(stats, contended)
+
+#define spinlock_stats_get(lock, stats)                     \
+MACRO_BEGIN                                                 \
+    (void)(lock);                                           \
+    (stats)->nr_acquires = 0;                               \
+    (stats)->nr_contended = 0;                              \
+MACRO_END
+#endif /* CONFIG_LOCK_STATS */
+
+/*
+ * Busy wait for a short time.
+ *
+ * The nr_spins counter must be set to 0 before waiting starts. Once it
+ * reaches a threshold, this function yields the processor instead of
+ * spinning.
+ */
+void spinlock_relax(unsigned int *nr_spins);
+
+/*
+ * Simple spin lock.
+ */
+struct spinlock {
+    atomic_uint locked;
+#ifdef CONFIG_LOCK_STATS
+    struct spinlock_stats stats;
+#endif /* CONFIG_LOCK_STATS */
+};
+
+#define SPINLOCK_INITIALIZER { 0 }
+
+void spinlock_init(struct spinlock *lock);
+
+void spinlock_lock_slow(struct spinlock *lock);
+
+/*
+ * Attempt to acquire a spin lock.
+ *
+ * If the lock is held, EBUSY is returned.
+ */
+static inline int
+spinlock_trylock(struct spinlock *lock)
+{
+    if (atomic_load_explicit(&lock->locked, memory_order_relaxed)
+        || atomic_exchange_explicit(&lock->locked, 1, memory_order_acquire)) {
+        return EBUSY;
+    }
+
+    spinlock_stats_record(&lock->stats, false);
+    return 0;
+}
+
+static inline void
+spinlock_lock(struct spinlock *lock)
+{
+    if (unlikely(atomic_exchange_explicit(&lock->locked, 1,
+                                          memory_order_acquire))) {
+        spinlock_lock_slow(lock);
+        return;
+    }
+
+    spinlock_stats_record(&lock->stats, false);
+}
+
+static inline void
+spinlock_unlock(struct spinlock *lock)
+{
+    atomic_store_explicit(&lock->locked, 0, memory_order_release);
+}
+
+static inline void
+spinlock_get_stats(const struct spinlock *lock, struct spinlock_stats *stats)
+{
+    spinlock_stats_get(lock, stats);
+}
+
+/*
+ * Ticket lock.
+ *
+ * The next member is the ticket given to the next thread requesting the
+ * lock, and the owner member the ticket of the thread allowed to own it.
+ */
+struct ticketlock {
+    atomic_uint next;
+    atomic_uint owner;
+#ifdef CONFIG_LOCK_STATS
+    struct spinlock_stats stats;
+#endif /* CONFIG_LOCK_STATS */
+};
+
+#define TICKETLOCK_INITIALIZER { 0 }
+
+void ticketlock_init(struct ticketlock *lock);
+
+void ticketlock_lock_slow(struct ticketlock *lock, unsigned int ticket);
+
+/*
+ * Attempt to acquire a ticket lock.
+ *
+ * If the lock is held, or if other threads are waiting for it, EBUSY is
+ * returned.
+ */
+static inline int
+ticketlock_trylock(struct ticketlock *lock)
+{
+    unsigned int owner;
+
+    owner = atomic_load_explicit(&lock->owner, memory_order_relaxed);
+
+    if (!atomic_compare_exchange_strong_explicit(&lock->next, &owner,
+                                                 owner + 1,
+                                                 memory_order_acquire,
+                                                 memory_order_relaxed)) {
+        return EBUSY;
+    }
+
+    spinlock_stats_record(&lock->stats, false);
+    return 0;
+}
+
+static inline void
+ticketlock_lock(struct ticketlock *lock)
+{
+    unsigned int ticket;
+
+    ticket = atomic_fetch_add_explicit(&lock->next, 1, memory_order_relaxed);
+
+    if (unlikely(atomic_load_explicit(&lock->owner, memory_order_acquire)
+                 != ticket)) {
+        ticketlock_lock_slow(lock, ticket);
+        return;
+    }
+
+    spinlock_stats_record(&lock->stats, false);
+}
+
+static inline void
+ticketlock_unlock(struct ticketlock *lock)
+{
+    unsigned int owner;
+
+    owner = atomic_load_explicit(&lock->owner, memory_order_relaxed);
+    atomic_store_explicit(&lock->owner, owner + 1, memory_order_release);
+}
+
+static inline void
+ticketlock_get_stats(const struct ticketlock *lock,
+                     struct spinlock_stats *stats)
+{
+    spinlock_stats_get(lock, stats);
+}
+
+/*
+ * MCS lock queue node.
+ *
+ * A thread passes its own node when locking, and the same node when
+ * unlocking. The node may be allocated on the stack of the thread. Nodes
+ * are aligned on cache lines since waiters spin on their own node.
+ */
+struct mcslock_qnode {
+    struct mcslock_qnode * _Atomic next;
+    atomic_bool locked;
+} __cacheline_aligned;
+
+/*
+ * MCS lock.
+ *
+ * The tail member is the node of the last thread in the queue, which is
+ * empty if the lock is free.
+ */
+struct mcslock {
+    struct mcslock_qnode * _Atomic tail;
+#ifdef CONFIG_LOCK_STATS
+    struct spinlock_stats stats;
+#endif /* CONFIG_LOCK_STATS */
+};
+
+#define MCSLOCK_INITIALIZER { NULL }
+
+void mcslock_init(struct mcslock *lock);
+
+void mcslock_lock_slow(struct mcslock *lock, struct mcslock_qnode *qnode,
+                       struct mcslock_qnode *prev);
+
+void mcslock_unlock_slow(struct mcslock_qnode *qnode);
+
+/*
+ * Attempt to acquire an MCS lock.
+ *
+ * If the lock is held, EBUSY is returned.
+ */
+static inline int
+mcslock_trylock(struct mcslock *lock, struct mcslock_qnode *qnode)
+{
+    struct mcslock_qnode *prev;
+
+    atomic_store_explicit(&qnode->next, NULL, memory_order_relaxed);
+    prev = NULL;
+
+    if (!atomic_compare_exchange_strong_explicit(&lock->tail, &prev, qnode,
+                                                 memory_order_acquire,
+                                                 memory_order_relaxed)) {
+        return EBUSY;
+    }
+
+    spinlock_stats_record(&lock->stats, false);
+    return 0;
+}
+
+static inline void
+mcslock_lock(struct mcslock *lock, struct mcslock_qnode *qnode)
+{
+    struct mcslock_qnode *prev;
+
+    atomic_store_explicit(&qnode->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&qnode->locked, true, memory_order_relaxed);
+    prev = atomic_exchange_explicit(&lock->tail, qnode, memory_order_acq_rel);
+
+    if (unlikely(prev != NULL)) {
+        mcslock_lock_slow(lock, qnode, prev);
+        return;
+    }
+
+    spinlock_stats_record(&lock->stats, false);
+}
+
+static inline void
+mcslock_unlock(struct mcslock *lock, struct mcslock_qnode *qnode)
+{
+    struct mcslock_qnode *next, *tmp;
+
+    next = atomic_load_explicit(&qnode->next, memory_order_acquire);
+
+    if (next == NULL) {
+        tmp = qnode;
+
+        if (atomic_compare_exchange_strong_explicit(&lock->tail, &tmp, NULL,
+                                                    memory_order_release,
+                                                    memory_order_relaxed)) {
+            return;
+        }
+
+        mcslock_unlock_slow(qnode);
+        return;
+    }
+
+    atomic_store_explicit(&next->locked, false, memory_order_release);
+}
+
+static inline void
+mcslock_get_stats(const struct mcslock *lock, struct spinlock_stats *stats)
+{
+    spinlock_stats_get(lock, stats);
+}
+
+#endif /* SPINLOCK_H */
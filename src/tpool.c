@@ -0,0 +1,688 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * The deque follows "Correct and Efficient Work-Stealing for Weak Memory
+ * Models", by Lê, Pop, Cohen and Zappa Nardelli. Arrays replaced when a
+ * deque grows may still be read by thieves, so they're only released when
+ * the pool is destroyed.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "macros.h"
+#include "slist.h"
+#include "tpool.h"
+
+/*
+ * Initial number of entries of a deque, a power of two.
+ */
+#define TPOOL_DEQUE_INITIAL_SIZE 64
+
+/*
+ * Number of failed attempts at finding a task before sleeping.
+ */
+#define TPOOL_MAX_SPINS 128
+
+/*
+ * Deque array.
+ *
+ * Arrays are linked in the list of retired arrays of their deque once
+ * replaced.
+ */
+struct tpool_deque_array {
+    struct slist_node node;
+    long size;
+    struct tpool_task * _Atomic tasks[];
+};
+
+/*
+ * Chase-Lev deque.
+ *
+ * The owner pushes and takes at the bottom, thieves steal at the top.
+ */
+struct tpool_deque {
+    atomic_long top __cacheline_aligned;
+    atomic_long bottom __cacheline_aligned;
+    struct tpool_deque_array * _Atomic array;
+    struct slist retired;
+};
+
+struct tpool_worker {
+    struct tpool_deque deque;
+    struct tpool *pool;
+    pthread_t thread;
+} __cacheline_aligned;
+
+static __thread struct tpool_worker *tpool_current_worker;
+static __thread uint32_t tpool_seed;
+
+static struct tpool_deque_array *
+tpool_deque_array_create(long size)
+{
+    struct tpool_deque_array *array;
+
+    array = malloc(sizeof(*array) + (size * sizeof(array->tasks[0])));
+
+    if (array == NULL) {
+        return NULL;
+    }
+
+    array->size = size;
+    return array;
+}
+
+static struct tpool_task *
+tpool_deque_array_get(struct tpool_deque_array *array, long index)
+{
+    return atomic_load_explicit(&array->tasks[index & (array->size - 1)],
+                                memory_order_relaxed);
+}
+
+static void
+tpool_deque_array_set(struct tpool_deque_array *array, long index,
+                      struct tpool_task *task)
+{
+    atomic_store_explicit(&array->tasks[index & (array->size - 1)], task,
+                          memory_order_relaxed);
+}
+
+static int
+tpool_deque_init(struct tpool_deque *deque)
+{
+    struct tpool_deque_array *array;
+
+    array = tpool_deque_array_create(TPOOL_DEQUE_INITIAL_SIZE);
+
+    if (array == NULL) {
+        return ENOMEM;
+    }
+
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->array, array);
+    slist_init(&deque->retired);
+    return 0;
+}
+
+static void
+tpool_deque_destroy(struct tpool_deque *deque)
+{
+    struct tpool_deque_array *array;
+
+    while (!slist_empty(&deque->retired)) {
+        array = slist_first_entry(&deque->retired,
+                                  struct tpool_deque_array, node);
+        slist_remove(&deque->retired, NULL);
+        free(array);
+    }
+
+    free(atomic_load_explicit(&deque->array, memory_order_relaxed));
+}
+
+static bool
+tpool_deque_empty(const struct tpool_deque *deque)
+{
+    long top, bottom;
+
+    top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    return (bottom - top) <= 0;
+}
+
+static struct tpool_deque_array *
+tpool_deque_grow(struct tpool_deque *deque, struct tpool_deque_array *array,
+                 long top, long bottom)
+{
+    struct tpool_deque_array *new_array;
+    long i;
+
+    new_array = tpool_deque_array_create(array->size * 2);
+
+    if (new_array == NULL) {
+        return NULL;
+    }
+
+    for (i = top; i < bottom; i++) {
+        tpool_deque_array_set(new_array, i, tpool_deque_array_get(array, i));
+    }
+
+    atomic_store_explicit(&deque->array, new_array, memory_order_release);
+    slist_insert_tail(&deque->retired, &array->node);
+    return new_array;
+}
+
+static int
+tpool_deque_push(struct tpool_deque *deque, struct tpool_task *task)
+{
+    struct tpool_deque_array *array;
+    long top, bottom;
+
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+    if ((bottom - top) >= array->size) {
+        array = tpool_deque_grow(deque, array, top, bottom);
+
+        if (array == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    tpool_deque_array_set(array, bottom, task);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return 0;
+}
+
+static struct tpool_task *
+tpool_deque_take(struct tpool_deque *deque)
+{
+    struct tpool_deque_array *array;
+    struct tpool_task *task;
+    long top, bottom;
+
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+        return NULL;
+    }
+
+    task = tpool_deque_array_get(array, bottom);
+
+    if (top == bottom) {
+        /* Last task, race with thieves */
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top,
+                                                     top + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            task = NULL;
+        }
+
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+    }
+
+    return task;
+}
+
+/*
+ * Steal a task from a deque.
+ *
+ * NULL is returned if the deque is empty, or if another thread took the
+ * task first.
+ */
+static struct tpool_task *
+tpool_deque_steal(struct tpool_deque *deque)
+{
+    struct tpool_deque_array *array;
+    struct tpool_task *task;
+    long top, bottom;
+
+    top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    task = tpool_deque_array_get(array, top);
+
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+
+    return task;
+}
+
+static uint32_t
+tpool_random(void)
+{
+    uint32_t x;
+
+    x = tpool_seed;
+
+    if (x == 0) {
+        x = (uint32_t)(uintptr_t)&tpool_seed | 1;
+    }
+
+    /* Xorshift */
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tpool_seed = x;
+    return x;
+}
+
+static struct tpool_worker *
+tpool_get_worker(const struct tpool *pool)
+{
+    struct tpool_worker *worker;
+
+    worker = tpool_current_worker;
+    return ((worker != NULL) && (worker->pool == pool)) ? worker : NULL;
+}
+
+static struct tpool_task *
+tpool_dequeue(struct tpool *pool)
+{
+    struct tpool_task *task;
+
+    if (atomic_load_explicit(&pool->nr_queued, memory_order_relaxed) == 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (slist_empty(&pool->queue)) {
+        task = NULL;
+    } else {
+        task = slist_first_entry(&pool->queue, struct tpool_task, node);
+        slist_remove(&pool->queue, NULL);
+        atomic_fetch_sub_explicit(&pool->nr_queued, 1, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return task;
+}
+
+/*
+ * Find a task to run, from the deque of the given worker if not NULL,
+ * from the deques of other workers, and from the queue of submitted tasks.
+ */
+static struct tpool_task *
+tpool_find_task(struct tpool *pool, struct tpool_worker *self)
+{
+    struct tpool_worker *victim;
+    struct tpool_task *task;
+    unsigned int i, start;
+
+    if (self != NULL) {
+        task = tpool_deque_take(&self->deque);
+
+        if (task != NULL) {
+            return task;
+        }
+    }
+
+    start = tpool_random() % pool->nr_workers;
+
+    for (i = 0; i < pool->nr_workers; i++) {
+        victim = &pool->workers[(start + i) % pool->nr_workers];
+
+        if (victim == self) {
+            continue;
+        }
+
+        task = tpool_deque_steal(&victim->deque);
+
+        if (task != NULL) {
+            return task;
+        }
+    }
+
+    return tpool_dequeue(pool);
+}
+
+static bool
+tpool_has_work(const struct tpool *pool)
+{
+    unsigned int i;
+
+    if (atomic_load_explicit(&pool->nr_queued, memory_order_relaxed) != 0) {
+        return true;
+    }
+
+    for (i = 0; i < pool->nr_workers; i++) {
+        if (!tpool_deque_empty(&pool->workers[i].deque)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Wake up sleeping threads after making a task available.
+ *
+ * Sleeping threads check for work after announcing that they sleep, and
+ * the full barrier here guarantees that either they find the new task, or
+ * they are seen sleeping.
+ */
+static void
+tpool_wakeup(struct tpool *pool)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&pool->nr_sleeping, memory_order_relaxed) != 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work_cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (atomic_load_explicit(&pool->nr_joining, memory_order_relaxed) != 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->join_cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void
+tpool_run_task(struct tpool *pool, struct tpool_task *task)
+{
+    task->fn(task);
+
+    /* The task may be released as soon as it's marked done */
+    atomic_store_explicit(&task->done, true, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&pool->nr_joining, memory_order_relaxed) != 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->join_cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/*
+ * Sleep until work is available.
+ *
+ * Return false if the pool is being destroyed.
+ */
+static bool
+tpool_sleep(struct tpool *pool)
+{
+    bool exiting;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->nr_sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    while (!pool->exiting && !tpool_has_work(pool)) {
+        pthread_cond_wait(&pool->work_cond, &pool->lock);
+    }
+
+    atomic_fetch_sub_explicit(&pool->nr_sleeping, 1, memory_order_relaxed);
+    exiting = pool->exiting;
+    pthread_mutex_unlock(&pool->lock);
+
+    return !exiting;
+}
+
+static void *
+tpool_worker_run(void *arg)
+{
+    struct tpool_worker *worker;
+    struct tpool_task *task;
+    unsigned int nr_spins;
+    struct tpool *pool;
+
+    worker = arg;
+    pool = worker->pool;
+    tpool_current_worker = worker;
+    nr_spins = 0;
+
+    for (;;) {
+        task = tpool_find_task(pool, worker);
+
+        if (task != NULL) {
+            tpool_run_task(pool, task);
+            nr_spins = 0;
+            continue;
+        }
+
+        if (nr_spins < TPOOL_MAX_SPINS) {
+            nr_spins++;
+            cpu_relax();
+            continue;
+        }
+
+        nr_spins = 0;
+
+        if (!tpool_sleep(pool)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+tpool_stop(struct tpool *pool, unsigned int nr_threads)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->exiting = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < nr_threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+}
+
+static void
+tpool_destroy_workers(struct tpool *pool, unsigned int nr_workers)
+{
+    unsigned int i;
+
+    for (i = 0; i < nr_workers; i++) {
+        tpool_deque_destroy(&pool->workers[i].deque);
+    }
+
+    free(pool->workers);
+}
+
+static void
+tpool_bind(struct tpool_worker *worker, unsigned int cpu)
+{
+    cpu_set_t cpus;
+
+    /* Affinity is a hint, ignore errors */
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(worker->thread, sizeof(cpus), &cpus);
+}
+
+int
+tpool_init(struct tpool *pool, unsigned int nr_workers, int flags)
+{
+    struct tpool_worker *worker;
+    unsigned int i;
+    void *workers;
+    int error;
+
+    assert((flags & ~TPOOL_AFFINITY) == 0);
+
+    if (nr_workers == 0) {
+        nr_workers = cpu_count();
+    }
+
+    error = posix_memalign(&workers, CPU_L1_SIZE,
+                           nr_workers * sizeof(struct tpool_worker));
+
+    if (error) {
+        return ENOMEM;
+    }
+
+    pool->workers = workers;
+    pool->nr_workers = nr_workers;
+    atomic_init(&pool->nr_sleeping, 0);
+    atomic_init(&pool->nr_joining, 0);
+    atomic_init(&pool->nr_queued, 0);
+    pool->exiting = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->join_cond, NULL);
+    slist_init(&pool->queue);
+
+    for (i = 0; i < nr_workers; i++) {
+        worker = &pool->workers[i];
+        worker->pool = pool;
+        error = tpool_deque_init(&worker->deque);
+
+        if (error) {
+            tpool_destroy_workers(pool, i);
+            goto error_workers;
+        }
+    }
+
+    for (i = 0; i < nr_workers; i++) {
+        worker = &pool->workers[i];
+        error = pthread_create(&worker->thread, NULL, tpool_worker_run, worker);
+
+        if (error) {
+            tpool_stop(pool, i);
+            tpool_destroy_workers(pool, nr_workers);
+            error = EAGAIN;
+            goto error_workers;
+        }
+
+        if (flags & TPOOL_AFFINITY) {
+            tpool_bind(worker, i % cpu_count());
+        }
+    }
+
+    return 0;
+
+error_workers:
+    pthread_cond_destroy(&pool->join_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+    return error;
+}
+
+void
+tpool_destroy(struct tpool *pool)
+{
+    assert(!tpool_has_work(pool));
+
+    tpool_stop(pool, pool->nr_workers);
+    tpool_destroy_workers(pool, pool->nr_workers);
+    pthread_cond_destroy(&pool->join_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void
+tpool_fork(struct tpool *pool, struct tpool_task *task)
+{
+    struct tpool_worker *worker;
+    int error;
+
+    atomic_store_explicit(&task->done, false, memory_order_relaxed);
+    worker = tpool_get_worker(pool);
+
+    if (worker != NULL) {
+        error = tpool_deque_push(&worker->deque, task);
+
+        if (error) {
+            /* Fork/join semantics allow running the task right away */
+            tpool_run_task(pool, task);
+            return;
+        }
+    } else {
+        pthread_mutex_lock(&pool->lock);
+        slist_insert_tail(&pool->queue, &task->node);
+        atomic_fetch_add_explicit(&pool->nr_queued, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    tpool_wakeup(pool);
+}
+
+static bool
+tpool_task_done(const struct tpool_task *task)
+{
+    return atomic_load_explicit(&task->done, memory_order_acquire);
+}
+
+/*
+ * Sleep until the given task completes, or work is available.
+ */
+static void
+tpool_join_sleep(struct tpool *pool, struct tpool_task *task)
+{
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->nr_joining, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    while (!tpool_task_done(task) && !tpool_has_work(pool)) {
+        pthread_cond_wait(&pool->join_cond, &pool->lock);
+    }
+
+    atomic_fetch_sub_explicit(&pool->nr_joining, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void
+tpool_join(struct tpool *pool, struct tpool_task *task)
+{
+    struct tpool_worker *worker;
+    struct tpool_task *other;
+    unsigned int nr_spins;
+
+    worker = tpool_get_worker(pool);
+    nr_spins = 0;
+
+    while (!tpool_task_done(task)) {
+        other = tpool_find_task(pool, worker);
+
+        if (other != NULL) {
+            tpool_run_task(pool, other);
+            nr_spins = 0;
+            continue;
+        }
+
+        if (nr_spins < TPOOL_MAX_SPINS) {
+            nr_spins++;
+            cpu_relax();
+            continue;
+        }
+
+        nr_spins = 0;
+        tpool_join_sleep(pool, task);
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Work-stealing thread pool.
+ *
+ * A thread pool runs tasks on a fixed set of worker threads. Each worker
+ * owns a Chase-Lev deque, a double-ended queue on which it pushes and
+ * from which it pops tasks at the bottom, without locking, while idle
+ * workers steal tasks from the top of the deques of other workers. Tasks
+ * submitted by threads outside the pool are queued on a shared list
+ * protected by a lock, from which workers pick them when they run out of
+ * local work.
+ *
+ * The interface follows the fork/join model : a task is forked, i.e.
+ * submitted, and later joined, i.e. waited for. A task forked from a
+ * worker goes on the deque of that worker, so that recursive algorithms
+ * naturally distribute work, with the largest pieces of work being stolen
+ * first. While joining, a worker runs other tasks instead of blocking.
+ * Threads outside the pool also help by stealing tasks while joining, and
+ * sleep if none can be found.
+ *
+ * Tasks are intrusive. Their memory is managed by the caller, and may be
+ * allocated on the stack of the forking thread, as long as the task is
+ * joined before returning.
+ */
+
+#ifndef TPOOL_H
+#define TPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "macros.h"
+#include "slist.h"
+
+/*
+ * Thread pool initialization flags.
+ */
+#define TPOOL_AFFINITY 0x1 /* Bind worker i to processor i */
+
+struct tpool_task;
+
+/*
+ * Type for task functions.
+ */
+typedef void (*tpool_fn_t)(struct tpool_task *task);
+
+/*
+ * Task.
+ *
+ * The task function may obtain the structure embedding the task with
+ * structof().
+ */
+struct tpool_task {
+    struct slist_node node;
+    tpool_fn_t fn;
+    atomic_bool done;
+};
+
+/*
+ * Worker, defined in the implementation.
+ */
+struct tpool_worker;
+
+/*
+ * Thread pool.
+ */
+struct tpool {
+    struct tpool_worker *workers;
+    unsigned int nr_workers;
+    atomic_uint nr_sleeping;
+    atomic_uint nr_joining;
+    atomic_uint nr_queued;
+    bool exiting;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t join_cond;
+    struct slist queue;
+};
+
+/*
+ * Initialize a thread pool and start its workers.
+ *
+ * If nr_workers is 0, one worker is created per processor.
+ *
+ * If memory can't be allocated, ENOMEM is returned. If threads can't be
+ * created, EAGAIN is returned.
+ */
+int tpool_init(struct tpool *pool, unsigned int nr_workers, int flags);
+
+/*
+ * Stop the workers of a thread pool and release its resources.
+ *
+ * All forked tasks must have been joined.
+ */
+void tpool_destroy(struct tpool *pool);
+
+/*
+ * Return the number of workers of a thread pool.
+ */
+static inline unsigned int
+tpool_nr_workers(const struct tpool *pool)
+{
+    return pool->nr_workers;
+}
+
+/*
+ * Initialize a task.
+ */
+static inline void
+tpool_task_init(struct tpool_task *task, tpool_fn_t fn)
+{
+    task->fn = fn;
+    atomic_init(&task->done, false);
+}
+
+/*
+ * Submit a task to a thread pool.
+ *
+ * The task must be initialized, and must not be forked again before being
+ * joined. It may be forked from any thread, including workers running a
+ * task of the same pool.
+ */
+void tpool_fork(struct tpool *pool, struct tpool_task *task);
+
+/*
+ * Wait for the completion of a forked task.
+ *
+ * When this function returns, the task function has returned, and its
+ * effects are visible to the caller.
+ */
+void tpool_join(struct tpool *pool, struct tpool_task *task);
+
+#endif /* TPOOL_H */
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitmap.h"
+#include "list.h"
+#include "macros.h"
+#include "twheel.h"
+
+#define TWHEEL_SLOT_MASK (TWHEEL_NR_SLOTS - 1)
+
+void
+twheel_init(struct twheel *wheel, uint64_t now)
+{
+    size_t i;
+
+    wheel->now = now;
+
+    for (i = 0; i < ARRAY_SIZE(wheel->maps); i++) {
+        bitmap_zero(wheel->maps[i], TWHEEL_NR_SLOTS);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(wheel->slots); i++) {
+        list_init(&wheel->slots[i]);
+    }
+}
+
+static unsigned int
+twheel_get_slot(uint64_t ticks, unsigned int level)
+{
+    return (ticks >> (level * TWHEEL_SLOT_SHIFT)) & TWHEEL_SLOT_MASK;
+}
+
+static void
+twheel_place(struct twheel *wheel, struct twheel_timer *timer)
+{
+    unsigned int level, slot;
+    uint64_t diff;
+
+    if (timer->expires <= wheel->now) {
+        level = 0;
+        slot = twheel_get_slot(wheel->now, 0);
+    } else {
+        diff = timer->expires ^ wheel->now;
+        level = (63 - __builtin_clzll(diff)) / TWHEEL_SLOT_SHIFT;
+        slot = twheel_get_slot(timer->expires, level);
+    }
+
+    timer->index = (level * TWHEEL_NR_SLOTS) + slot;
+    list_insert_tail(&wheel->slots[timer->index], &timer->node);
+    bitmap_set(wheel->maps[level], slot);
+}
+
+void
+twheel_arm(struct twheel *wheel, struct twheel_timer *timer,
+           uint64_t expires)
+{
+    timer->expires = expires;
+    twheel_place(wheel, timer);
+}
+
+void
+twheel_cancel(struct twheel *wheel, struct twheel_timer *timer)
+{
+    struct list *bucket;
+
+    bucket = &wheel->slots[timer->index];
+    list_remove(&timer->node);
+
+    if (list_empty(bucket)) {
+        bitmap_clear(wheel->maps[timer->index / TWHEEL_NR_SLOTS],
+                     timer->index % TWHEEL_NR_SLOTS);
+    }
+}
+
+/*
+ * Find the next non-empty slot.
+ *
+ * Timers are stored in slots following the one of the current time at
+ * their level, except at the first level, where the slot of the current
+ * time holds timers expiring now, so that slots are processed in level
+ * order. The time at which a slot is processed is the start of that slot.
+ */
+static bool
+twheel_find_next(const struct twheel *wheel, unsigned int *levelp,
+                 unsigned int *slotp, uint64_t *ticksp)
+{
+    unsigned int level, shift, start;
+    uint64_t mask;
+    int slot;
+
+    for (level = 0; level < TWHEEL_NR_LEVELS; level++) {
+        start = twheel_get_slot(wheel->now, level);
+
+        if (level != 0) {
+            start++;
+
+            if (start == TWHEEL_NR_SLOTS) {
+                continue;
+            }
+        }
+
+        slot = bitmap_find_next(wheel->maps[level], TWHEEL_NR_SLOTS, start);
+
+        if (slot == -1) {
+            continue;
+        }
+
+        shift = level * TWHEEL_SLOT_SHIFT;
+        mask = ((shift + TWHEEL_SLOT_SHIFT) >= 64)
+               ? (uint64_t)-1
+               : (((uint64_t)1 << (shift + TWHEEL_SLOT_SHIFT)) - 1);
+
+        *levelp = level;
+        *slotp = slot;
+        *ticksp = (wheel->now & ~mask) | ((uint64_t)slot << shift);
+        return true;
+    }
+
+    return false;
+}
+
+void
+twheel_advance(struct twheel *wheel, uint64_t now, struct list *expired)
+{
+    struct twheel_timer *timer, *tmp;
+    unsigned int level, slot;
+    struct list *bucket;
+    struct list timers;
+    uint64_t ticks;
+
+    assert(now >= wheel->now);
+
+    while (twheel_find_next(wheel, &level, &slot, &ticks) && (ticks <= now)) {
+        wheel->now = ticks;
+        bucket = &wheel->slots[(level * TWHEEL_NR_SLOTS) + slot];
+        bitmap_clear(wheel->maps[level], slot);
+
+        if (level == 0) {
+            list_concat(expired, bucket);
+            list_init(bucket);
+        } else {
+            list_set_head(&timers, bucket);
+            list_init(bucket);
+
+            list_for_each_entry_safe(&timers, timer, tmp, node) {
+                twheel_place(wheel, timer);
+            }
+        }
+    }
+
+    wheel->now = now;
+}
+
+bool
+twheel_next_event(const struct twheel *wheel, uint64_t *ticksp)
+{
+    unsigned int level, slot;
+
+    return twheel_find_next(wheel, &level, &slot, ticksp);
+}
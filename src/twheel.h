@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ *
+ * Hierarchical timing wheel.
+ *
+ * A timing wheel stores timers in buckets indexed by their expiration
+ * time, which makes arming and cancelling timers O(1). Time is measured
+ * in ticks, the unit of which is chosen by the user.
+ *
+ * The wheel is made of levels of TWHEEL_NR_SLOTS slots, the slots of each
+ * level covering TWHEEL_NR_SLOTS times more ticks than those of the level
+ * below. Timers are stored in the lowest level where their expiration time
+ * only differs from the current time in the bits indexing slots of that
+ * level. When the current time reaches the start of a slot, the timers
+ * of that slot are moved down to lower levels, until they reach the first
+ * level, where a slot covers a single tick. There are enough levels to
+ * cover the whole range of 64-bits tick values.
+ *
+ * A bitmap of non-empty slots is maintained for each level, so that
+ * advancing time skips empty slots instead of walking every tick.
+ *
+ * Timers are intrusive, and expire in batches : advancing time moves all
+ * expired timers into a list provided by the caller, which can then run
+ * the associated actions.
+ *
+ * This module isn't thread-safe.
+ */
+
+#ifndef TWHEEL_H
+#define TWHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bitmap.h"
+#include "list.h"
+#include "macros.h"
+
+#define TWHEEL_SLOT_SHIFT   6
+#define TWHEEL_NR_SLOTS     (1 << TWHEEL_SLOT_SHIFT)
+#define TWHEEL_NR_LEVELS    DIV_CEIL(64, TWHEEL_SLOT_SHIFT)
+
+/*
+ * Timer.
+ *
+ * The index member identifies the slot containing an armed timer.
+ */
+struct twheel_timer {
+    struct list node;
+    uint64_t expires;
+    unsigned int index;
+};
+
+/*
+ * Timing wheel.
+ */
+struct twheel {
+    uint64_t now;
+    BITMAP_DECLARE(maps[TWHEEL_NR_LEVELS], TWHEEL_NR_SLOTS);
+    struct list slots[TWHEEL_NR_LEVELS * TWHEEL_NR_SLOTS];
+};
+
+/*
+ * Initialize a timing wheel.
+ *
+ * The now argument is the current time.
+ */
+void twheel_init(struct twheel *wheel, uint64_t now);
+
+/*
+ * Return the current time of a timing wheel.
+ */
+static inline uint64_t
+twheel_now(const struct twheel *wheel)
+{
+    return wheel->now;
+}
+
+/*
+ * Return the expiration time of a timer.
+ */
+static inline uint64_t
+twheel_timer_expires(const struct twheel_timer *timer)
+{
+    return timer->expires;
+}
+
+/*
+ * Macro that evaluates to the address of the structure containing the
+ * given timer based on the given type and member.
+ */
+#define twheel_entry(timer, type, member) structof(timer, type, member)
+
+/*
+ * Arm a timer.
+ *
+ * The timer expires once the current time of the wheel is greater than
+ * or equal to the given expiration time. Timers armed with an expiration
+ * time in the past expire on the next call to twheel_advance().
+ *
+ * The timer must not be armed.
+ */
+void twheel_arm(struct twheel *wheel, struct twheel_timer *timer,
+                uint64_t expires);
+
+/*
+ * Cancel an armed timer.
+ */
+void twheel_cancel(struct twheel *wheel, struct twheel_timer *timer);
+
+/*
+ * Advance the current time of a timing wheel.
+ *
+ * Timers expiring up to, and including, the given time are appended to
+ * the expired list, through their node member, in expiration order.
+ * Expired timers are no longer armed, and may be armed again.
+ *
+ * The given time must not be less than the current time.
+ */
+void twheel_advance(struct twheel *wheel, uint64_t now, struct list *expired);
+
+/*
+ * Obtain the time of the next event of a timing wheel.
+ *
+ * Events are timer expirations, and moving timers between levels. No
+ * timer expires before the next event, which makes it a suitable time
+ * at which to call twheel_advance() when waiting for timers.
+ *
+ * If there are no armed timers, false is returned.
+ */
+bool twheel_next_event(const struct twheel *wheel, uint64_t *ticksp);
+
+#endif /* TWHEEL_H */
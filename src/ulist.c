@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "list.h"
+#include "macros.h"
+#include "ulist.h"
+
+static struct ulist_chunk *
+ulist_chunk_create(void)
+{
+    struct ulist_chunk *chunk;
+    int error;
+
+    error = posix_memalign((void **)&chunk, CPU_L1_SIZE, sizeof(*chunk));
+
+    if (error) {
+        return NULL;
+    }
+
+    chunk->nr_ptrs = 0;
+    return chunk;
+}
+
+static void
+ulist_chunk_destroy(struct ulist_chunk *chunk)
+{
+    free(chunk);
+}
+
+int
+ulist_append(struct ulist *ulist, void *ptr)
+{
+    struct ulist_chunk *chunk;
+
+    assert(ptr != NULL);
+
+    if (list_empty(&ulist->chunks)) {
+        chunk = NULL;
+    } else {
+        chunk = list_last_entry(&ulist->chunks, struct ulist_chunk, node);
+    }
+
+    if ((chunk == NULL) || (chunk->nr_ptrs == ARRAY_SIZE(chunk->ptrs))) {
+        chunk = ulist_chunk_create();
+
+        if (chunk == NULL) {
+            return ENOMEM;
+        }
+
+        list_insert_tail(&ulist->chunks, &chunk->node);
+    }
+
+    chunk->ptrs[chunk->nr_ptrs] = ptr;
+    chunk->nr_ptrs++;
+    ulist->size++;
+    return 0;
+}
+
+void *
+ulist_iter_next_chunk(struct ulist_iter *iter)
+{
+    struct list *node;
+
+    node = list_next(&iter->chunk->node);
+    iter->index = 0;
+
+    if (list_end(&iter->ulist->chunks, node)) {
+        iter->chunk = NULL;
+        return NULL;
+    }
+
+    iter->chunk = list_entry(node, struct ulist_chunk, node);
+    return iter->chunk->ptrs[0];
+}
+
+/*
+ * Merge the successor of a chunk into it if all their pointers fit.
+ */
+static void
+ulist_chunk_merge_next(struct ulist *ulist, struct ulist_chunk *chunk)
+{
+    struct ulist_chunk *next;
+    struct list *node;
+
+    node = list_next(&chunk->node);
+
+    if (list_end(&ulist->chunks, node)) {
+        return;
+    }
+
+    next = list_entry(node, struct ulist_chunk, node);
+
+    if ((chunk->nr_ptrs + next->nr_ptrs) > ARRAY_SIZE(chunk->ptrs)) {
+        return;
+    }
+
+    memcpy(&chunk->ptrs[chunk->nr_ptrs], next->ptrs,
+           next->nr_ptrs * sizeof(next->ptrs[0]));
+    chunk->nr_ptrs += next->nr_ptrs;
+    list_remove(&next->node);
+    ulist_chunk_destroy(next);
+}
+
+void *
+ulist_remove(struct ulist_iter *iter)
+{
+    struct ulist_chunk *chunk;
+    struct ulist *ulist;
+
+    chunk = iter->chunk;
+    ulist = iter->ulist;
+    assert(chunk != NULL);
+    assert(iter->index < chunk->nr_ptrs);
+
+    chunk->nr_ptrs--;
+    memmove(&chunk->ptrs[iter->index], &chunk->ptrs[iter->index + 1],
+            (chunk->nr_ptrs - iter->index) * sizeof(chunk->ptrs[0]));
+    ulist->size--;
+
+    if (chunk->nr_ptrs == 0) {
+        ulist_iter_next_chunk(iter);
+        list_remove(&chunk->node);
+        ulist_chunk_destroy(chunk);
+        return ulist_iter_get(iter);
+    }
+
+    ulist_chunk_merge_next(ulist, chunk);
+
+    if (iter->index == chunk->nr_ptrs) {
+        return ulist_iter_next_chunk(iter);
+    }
+
+    return chunk->ptrs[iter->index];
+}
+
+void
+ulist_remove_all(struct ulist *ulist)
+{
+    struct ulist_chunk *chunk, *tmp;
+
+    list_for_each_entry_safe(&ulist->chunks, chunk, tmp, node) {
+        ulist_chunk_destroy(chunk);
+    }
+
+    ulist_init(ulist);
+}
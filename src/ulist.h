@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Upstream site with license notes :
+ * http://git.sceen.net/rbraun/librbraun.git/
+ *
+ *
+ * Unrolled list.
+ *
+ * This container stores pointers in chunks, each spanning a few cache
+ * lines, that are linked together. Compared to a doubly-linked list of
+ * small objects, iterating over the stored pointers incurs roughly one
+ * cache miss per chunk instead of one per object. Pointers are appended
+ * at the tail of the list, and may be removed during iteration, in which
+ * case the elements following the removed pointer in its chunk are moved,
+ * which keeps the list ordered. Chunks are merged with their successor
+ * when they are sparse enough, so that the list remains dense.
+ *
+ * Null pointers can't be stored in an unrolled list.
+ */
+
+#ifndef ULIST_H
+#define ULIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu.h"
+#include "list.h"
+#include "macros.h"
+
+/*
+ * Size of a chunk, including its header.
+ */
+#define ULIST_CHUNK_SIZE (CPU_L1_SIZE * 2)
+
+/*
+ * Number of pointers in a chunk.
+ */
+#define ULIST_CHUNK_NR_PTRS                                     \
+    ((ULIST_CHUNK_SIZE - sizeof(struct list) - sizeof(void *))  \
+     / sizeof(void *))
+
+/*
+ * Chunk of pointers.
+ */
+struct ulist_chunk {
+    struct list node;
+    unsigned int nr_ptrs;
+    void *ptrs[ULIST_CHUNK_NR_PTRS];
+};
+
+/*
+ * Unrolled list.
+ */
+struct ulist {
+    struct list chunks;
+    size_t size;
+};
+
+/*
+ * Unrolled list iterator.
+ *
+ * The chunk member is NULL when the iterator has reached the end of the
+ * list.
+ */
+struct ulist_iter {
+    struct ulist *ulist;
+    struct ulist_chunk *chunk;
+    unsigned int index;
+};
+
+/*
+ * Static unrolled list initializer.
+ */
+#define ULIST_INITIALIZER(ulist) { LIST_INITIALIZER((ulist).chunks), 0 }
+
+/*
+ * Initialize an unrolled list.
+ */
+static inline void
+ulist_init(struct ulist *ulist)
+{
+    list_init(&ulist->chunks);
+    ulist->size = 0;
+}
+
+/*
+ * Return the number of pointers in an unrolled list.
+ */
+static inline size_t
+ulist_size(const struct ulist *ulist)
+{
+    return ulist->size;
+}
+
+/*
+ * Return true if an unrolled list is empty.
+ */
+static inline bool
+ulist_empty(const struct ulist *ulist)
+{
+    return ulist->size == 0;
+}
+
+/*
+ * Append a pointer at the tail of an unrolled list.
+ *
+ * If memory for a new chunk can't be allocated, ENOMEM is returned.
+ */
+int ulist_append(struct ulist *ulist, void *ptr);
+
+/*
+ * Initialize an iterator at the head of an unrolled list.
+ *
+ * Return the first pointer, or NULL if the list is empty.
+ */
+static inline void *
+ulist_iter_first(struct ulist *ulist, struct ulist_iter *iter)
+{
+    iter->ulist = ulist;
+    iter->index = 0;
+
+    if (list_empty(&ulist->chunks)) {
+        iter->chunk = NULL;
+        return NULL;
+    }
+
+    iter->chunk = list_first_entry(&ulist->chunks, struct ulist_chunk, node);
+    return iter->chunk->ptrs[0];
+}
+
+/*
+ * Return the pointer an iterator refers to, or NULL if it has reached the
+ * end of the list.
+ */
+static inline void *
+ulist_iter_get(const struct ulist_iter *iter)
+{
+    return (iter->chunk == NULL) ? NULL : iter->chunk->ptrs[iter->index];
+}
+
+/*
+ * Move an iterator to the first pointer of the next chunk and return it,
+ * or NULL if there are no more chunks.
+ *
+ * This function is private.
+ */
+void * ulist_iter_next_chunk(struct ulist_iter *iter);
+
+/*
+ * Move an iterator to the next pointer and return it.
+ *
+ * If the iterator reaches the end of the list, NULL is returned.
+ */
+static inline void *
+ulist_iter_next(struct ulist_iter *iter)
+{
+    iter->index++;
+
+    if (likely(iter->index < iter->chunk->nr_ptrs)) {
+        return iter->chunk->ptrs[iter->index];
+    }
+
+    return ulist_iter_next_chunk(iter);
+}
+
+/*
+ * Remove the pointer an iterator refers to.
+ *
+ * The iterator is moved to the next pointer, which is returned. If there
+ * is no such pointer, NULL is returned.
+ */
+void * ulist_remove(struct ulist_iter *iter);
+
+/*
+ * Remove all pointers from an unrolled list, and release its chunks.
+ */
+void ulist_remove_all(struct ulist *ulist);
+
+/*
+ * Forge a loop to process all pointers of an unrolled list.
+ *
+ * Pointers must not be removed during the loop. To remove pointers while
+ * iterating, use ulist_iter_first(), ulist_iter_next() and ulist_remove()
+ * explicitly.
+ */
+#define ulist_for_each(ulist, iter, ptr)            \
+for (ptr = ulist_iter_first(ulist, iter);           \
+     ptr != NULL;                                   \
+     ptr = ulist_iter_next(iter))
+
+#endif /* ULIST_H */
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *
+ * Safe memory reclamation benchmark.
+ *
+ * Threads run a read-heavy workload on a table of shared objects : most
+ * operations read all the objects of the table, and one in every
+ * BENCH_UPDATE_INTERVAL replaces a random object and retires the old one.
+ * Epoch-based reclamation is compared with hazard pointers, implemented
+ * here for comparison purposes, with one hazard pointer per thread, and
+ * with no reclamation at all, where retired objects are only released at
+ * the end of the run. The number of loops per thread and the number of
+ * threads may be given as the first and second arguments.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <check.h>
+#include <cpu.h>
+#include <ebr.h>
+#include <macros.h>
+#include <rcu.h>
+#include <slist.h>
+
+#define BENCH_NR_LOOPS          1000000
+#define BENCH_MAX_THREADS       256
+#define BENCH_NR_SLOTS          16
+#define BENCH_UPDATE_INTERVAL   100
+
+/*
+ * Number of objects a thread may retire before scanning hazard pointers.
+ */
+#define BENCH_HP_SCAN_THRESHOLD EBR_BATCH_SIZE
+
+struct bench_obj {
+    struct ebr_node ebr_node;
+    struct slist_node node;
+    unsigned long value;
+};
+
+struct bench_thread {
+    pthread_t thread;
+    void (*fn)(struct bench_thread *thread);
+    unsigned long sum;
+    unsigned long seed;
+    struct slist retired;
+    unsigned int nr_retired;
+    _Atomic(struct bench_obj *) hazard __cacheline_aligned;
+} __cacheline_aligned;
+
+static unsigned long bench_nr_loops = BENCH_NR_LOOPS;
+static unsigned int bench_nr_threads;
+
+static pthread_barrier_t bench_barrier;
+
+static struct bench_thread bench_threads[BENCH_MAX_THREADS];
+static struct bench_obj *bench_slots[BENCH_NR_SLOTS] __cacheline_aligned;
+
+static unsigned long long
+bench_now(void)
+{
+    struct timespec ts;
+    int error;
+
+    error = clock_gettime(CLOCK_MONOTONIC, &ts);
+    check(!error);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static unsigned long
+bench_rand(struct bench_thread *thread)
+{
+    unsigned long x;
+
+    x = thread->seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    thread->seed = x;
+    return x;
+}
+
+static struct bench_obj *
+bench_obj_create(unsigned long value)
+{
+    struct bench_obj *obj;
+
+    obj = malloc(sizeof(*obj));
+    check(obj != NULL);
+    obj->value = value;
+    return obj;
+}
+
+static void
+bench_obj_destroy(struct ebr_node *node)
+{
+    free(structof(node, struct bench_obj, ebr_node));
+}
+
+static struct bench_obj *
+bench_replace(struct bench_thread *thread)
+{
+    struct bench_obj *obj;
+    unsigned long value;
+
+    value = bench_rand(thread);
+    obj = bench_obj_create(value);
+    return __atomic_exchange_n(&bench_slots[value % BENCH_NR_SLOTS], obj,
+                               __ATOMIC_RELEASE);
+}
+
+static void
+bench_retire(struct bench_thread *thread, struct bench_obj *obj)
+{
+    slist_insert_tail(&thread->retired, &obj->node);
+    thread->nr_retired++;
+}
+
+static void
+bench_run_none(struct bench_thread *thread)
+{
+    struct bench_obj *obj;
+    unsigned long i;
+    unsigned int j;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        if ((i % BENCH_UPDATE_INTERVAL) == 0) {
+            bench_retire(thread, bench_replace(thread));
+            continue;
+        }
+
+        for (j = 0; j < ARRAY_SIZE(bench_slots); j++) {
+            obj = rcu_load_ptr(bench_slots[j]);
+            thread->sum += obj->value;
+        }
+    }
+}
+
+static void
+bench_run_ebr(struct bench_thread *thread)
+{
+    struct bench_obj *obj;
+    unsigned long i;
+    unsigned int j;
+
+    ebr_register_thread();
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        if ((i % BENCH_UPDATE_INTERVAL) == 0) {
+            obj = bench_replace(thread);
+            ebr_retire(&obj->ebr_node, bench_obj_destroy);
+            continue;
+        }
+
+        ebr_enter();
+
+        for (j = 0; j < ARRAY_SIZE(bench_slots); j++) {
+            obj = rcu_load_ptr(bench_slots[j]);
+            thread->sum += obj->value;
+        }
+
+        ebr_exit();
+    }
+
+    ebr_unregister_thread();
+}
+
+static struct bench_obj *
+bench_hp_protect(struct bench_thread *thread, struct bench_obj **slot)
+{
+    struct bench_obj *obj, *tmp;
+
+    obj = __atomic_load_n(slot, __ATOMIC_RELAXED);
+
+    for (;;) {
+        atomic_store_explicit(&thread->hazard, obj, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        tmp = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+        if (tmp == obj) {
+            return obj;
+        }
+
+        obj = tmp;
+    }
+}
+
+static bool
+bench_hp_protected(const struct bench_obj *obj)
+{
+    unsigned int i;
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        if (atomic_load_explicit(&bench_threads[i].hazard,
+                                 memory_order_relaxed) == obj) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+bench_hp_scan(struct bench_thread *thread)
+{
+    struct bench_obj *obj, *tmp;
+    struct slist retired;
+
+    slist_set_head(&retired, &thread->retired);
+    slist_init(&thread->retired);
+    thread->nr_retired = 0;
+
+    atomic_thread_fence(memory_order_seq_cst);
+
+    slist_for_each_entry_safe(&retired, obj, tmp, node) {
+        if (bench_hp_protected(obj)) {
+            bench_retire(thread, obj);
+        } else {
+            free(obj);
+        }
+    }
+}
+
+static void
+bench_run_hp(struct bench_thread *thread)
+{
+    struct bench_obj *obj;
+    unsigned long i;
+    unsigned int j;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        if ((i % BENCH_UPDATE_INTERVAL) == 0) {
+            bench_retire(thread, bench_replace(thread));
+
+            if (thread->nr_retired >= BENCH_HP_SCAN_THRESHOLD) {
+                bench_hp_scan(thread);
+            }
+
+            continue;
+        }
+
+        for (j = 0; j < ARRAY_SIZE(bench_slots); j++) {
+            obj = bench_hp_protect(thread, &bench_slots[j]);
+            thread->sum += obj->value;
+        }
+
+        atomic_store_explicit(&thread->hazard, NULL, memory_order_release);
+    }
+}
+
+static void *
+bench_run(void *arg)
+{
+    struct bench_thread *thread;
+
+    thread = arg;
+    pthread_barrier_wait(&bench_barrier);
+    thread->fn(thread);
+    return NULL;
+}
+
+static void
+bench_one(const char *name, void (*fn)(struct bench_thread *thread))
+{
+    unsigned long long t0, duration;
+    struct bench_thread *thread;
+    struct bench_obj *obj, *tmp;
+    unsigned int i;
+    int error;
+
+    for (i = 0; i < ARRAY_SIZE(bench_slots); i++) {
+        bench_slots[i] = bench_obj_create(i);
+    }
+
+    error = pthread_barrier_init(&bench_barrier, NULL, bench_nr_threads + 1);
+    check(!error);
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        thread = &bench_threads[i];
+        thread->fn = fn;
+        thread->sum = 0;
+        thread->seed = i + 1;
+        slist_init(&thread->retired);
+        thread->nr_retired = 0;
+        atomic_init(&thread->hazard, NULL);
+        error = pthread_create(&thread->thread, NULL, bench_run, thread);
+        check(!error);
+    }
+
+    pthread_barrier_wait(&bench_barrier);
+    t0 = bench_now();
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        error = pthread_join(bench_threads[i].thread, NULL);
+        check(!error);
+    }
+
+    duration = bench_now() - t0;
+    pthread_barrier_destroy(&bench_barrier);
+
+    printf("%-12s %10.1f ns/op %10.2f Mops/s\n",
+           name, (double)duration / bench_nr_loops,
+           ((double)bench_nr_loops * bench_nr_threads * 1000) / duration);
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        slist_for_each_entry_safe(&bench_threads[i].retired, obj, tmp, node) {
+            free(obj);
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bench_slots); i++) {
+        free(bench_slots[i]);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench_nr_loops = strtoul(argv[1], NULL, 10);
+        check(bench_nr_loops != 0);
+    }
+
+    if (argc > 2) {
+        bench_nr_threads = strtoul(argv[2], NULL, 10);
+    } else {
+        bench_nr_threads = cpu_count();
+    }
+
+    check((bench_nr_threads != 0) && (bench_nr_threads <= BENCH_MAX_THREADS));
+
+    printf("threads: %u, processors: %u, slots: %u, update interval: %u\n",
+           bench_nr_threads, cpu_count(), BENCH_NR_SLOTS,
+           BENCH_UPDATE_INTERVAL);
+
+    bench_one("none", bench_run_none);
+    bench_one("ebr", bench_run_ebr);
+    bench_one("hp", bench_run_hp);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *
+ * False sharing benchmark.
+ *
+ * Each thread increments its own counter, with counters either packed
+ * in the same cache lines, or padded to a cache line each. Counters are
+ * updated with plain loads and stores, as done for data protected by
+ * restartable sequences, and with atomic instructions. The number of
+ * loops and threads may be given as the first and second arguments.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <cpu.h>
+#include <macros.h>
+
+#define BENCH_NR_LOOPS      100000000
+#define BENCH_MAX_THREADS   64
+
+struct bench_padded_counter {
+    unsigned long value;
+} __cacheline_aligned;
+
+static unsigned long bench_packed[BENCH_MAX_THREADS] __cacheline_aligned;
+static struct bench_padded_counter bench_padded[BENCH_MAX_THREADS];
+
+static unsigned long bench_nr_loops = BENCH_NR_LOOPS;
+static unsigned int bench_nr_threads;
+
+static pthread_barrier_t bench_barrier;
+
+struct bench_work {
+    pthread_t thread;
+    unsigned int id;
+    void (*fn)(unsigned long *counter);
+    unsigned long *counter;
+};
+
+static unsigned long long
+bench_now(void)
+{
+    struct timespec ts;
+    int error;
+
+    error = clock_gettime(CLOCK_MONOTONIC, &ts);
+    check(!error);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static void
+bench_inc_plain(unsigned long *counter)
+{
+    unsigned long i;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        WRITE_ONCE(*counter, READ_ONCE(*counter) + 1);
+    }
+}
+
+static void
+bench_inc_atomic(unsigned long *counter)
+{
+    unsigned long i;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        atomic_fetch_add_explicit((atomic_ulong *)counter, 1,
+                                  memory_order_relaxed);
+    }
+}
+
+static void *
+bench_run(void *arg)
+{
+    struct bench_work *work;
+    cpu_set_t cpus;
+
+    work = arg;
+
+    /* Spread threads over processors, ignore errors */
+    CPU_ZERO(&cpus);
+    CPU_SET(work->id % cpu_count(), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    pthread_barrier_wait(&bench_barrier);
+    work->fn(work->counter);
+    return NULL;
+}
+
+static void
+bench_one(const char *name, void (*fn)(unsigned long *counter), bool padded)
+{
+    struct bench_work works[BENCH_MAX_THREADS];
+    unsigned long long t0, duration;
+    unsigned int i;
+    int error;
+
+    error = pthread_barrier_init(&bench_barrier, NULL, bench_nr_threads + 1);
+    check(!error);
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        works[i].id = i;
+        works[i].fn = fn;
+        works[i].counter = padded ? &bench_padded[i].value : &bench_packed[i];
+        *works[i].counter = 0;
+        error = pthread_create(&works[i].thread, NULL, bench_run, &works[i]);
+        check(!error);
+    }
+
+    pthread_barrier_wait(&bench_barrier);
+    t0 = bench_now();
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        error = pthread_join(works[i].thread, NULL);
+        check(!error);
+        check(*works[i].counter == bench_nr_loops);
+    }
+
+    duration = bench_now() - t0;
+    pthread_barrier_destroy(&bench_barrier);
+
+    printf("%-8s %-8s %10.2f ns/inc %10.1f Minc/s\n",
+           name, padded ? "padded" : "packed",
+           (double)duration / bench_nr_loops,
+           ((double)bench_nr_loops * bench_nr_threads * 1000) / duration);
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench_nr_loops = strtoul(argv[1], NULL, 10);
+        check(bench_nr_loops != 0);
+    }
+
+    if (argc > 2) {
+        bench_nr_threads = strtoul(argv[2], NULL, 10);
+    } else {
+        bench_nr_threads = MAX(cpu_count(), 2);
+    }
+
+    check((bench_nr_threads != 0) && (bench_nr_threads <= BENCH_MAX_THREADS));
+
+    printf("threads: %u, cache line: %u bytes\n",
+           bench_nr_threads, cpu_l1_size());
+
+    bench_one("plain", bench_inc_plain, false);
+    bench_one("plain", bench_inc_plain, true);
+    bench_one("atomic", bench_inc_atomic, false);
+    bench_one("atomic", bench_inc_atomic, true);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *
+ * Benchmark of the fmt module against the C library.
+ *
+ * For each format, report the average time per call and the throughput,
+ * in bytes of output for print functions, and bytes of input for scan
+ * functions. The number of loops may be given as the first argument.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <check.h>
+#include <fmt.h>
+#include <macros.h>
+
+#define BENCH_NR_LOOPS 1000000
+
+static unsigned long bench_nr_loops = BENCH_NR_LOOPS;
+
+/*
+ * Used to prevent the compiler from discarding results.
+ */
+static volatile int bench_sink;
+
+static unsigned long long
+bench_now(void)
+{
+    struct timespec ts;
+    int error;
+
+    error = clock_gettime(CLOCK_MONOTONIC, &ts);
+    check(!error);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static void
+bench_report(const char *name, const char *format,
+             unsigned long long duration, unsigned long long nr_bytes)
+{
+    double ns_per_call, mb_per_sec;
+
+    if (duration == 0) {
+        duration = 1;
+    }
+
+    ns_per_call = (double)duration / bench_nr_loops;
+    mb_per_sec = ((double)nr_bytes * 1000) / duration;
+    printf("%-18s %-26s %10.1f ns/call %10.1f MB/s\n",
+           name, format, ns_per_call, mb_per_sec);
+}
+
+/*
+ * Call the C library through vsnprintf(), as fmt_snprintf() does with
+ * fmt_vsnprintf(), so that the compiler can't replace simple calls with
+ * string copies.
+ */
+static int __attribute__((format(printf, 3, 4)))
+bench_libc_snprintf(char *str, size_t size, const char *format, ...)
+{
+    va_list ap;
+    int length;
+
+    va_start(ap, format);
+    length = vsnprintf(str, size, format, ap);
+    va_end(ap);
+
+    return length;
+}
+
+/*
+ * The i variable may be used in arguments to vary them across loops.
+ */
+#define BENCH_SPRINTF(name, fn, format, ...)                            \
+MACRO_BEGIN                                                             \
+    unsigned long long t0, nr_bytes;                                    \
+    char buf[256];                                                      \
+    unsigned long i;                                                    \
+    int length;                                                         \
+                                                                        \
+    nr_bytes = 0;                                                       \
+    t0 = bench_now();                                                   \
+                                                                        \
+    for (i = 0; i < bench_nr_loops; i++) {                              \
+        length = fn(buf, sizeof(buf), format, ## __VA_ARGS__);          \
+        nr_bytes += length;                                             \
+    }                                                                   \
+                                                                        \
+    bench_report(name, format, bench_now() - t0, nr_bytes);             \
+    bench_sink = buf[0];                                                \
+MACRO_END
+
+#define BENCH_SPRINTF_ALL(format, ...)                                  \
+MACRO_BEGIN                                                             \
+    BENCH_SPRINTF("snprintf", bench_libc_snprintf,                      \
+                  format, ## __VA_ARGS__);                              \
+    BENCH_SPRINTF("fmt_snprintf", fmt_snprintf, format, ## __VA_ARGS__);\
+    BENCH_SPRINTF("fmt_snprintf_spec", fmt_snprintf_spec,               \
+                  format, ## __VA_ARGS__);                              \
+MACRO_END
+
+/*
+ * The call argument is the complete scan call expression.
+ */
+#define BENCH_SSCANF(name, str, format, call)                           \
+MACRO_BEGIN                                                             \
+    unsigned long long t0;                                              \
+    unsigned long i;                                                    \
+    int nr_convs;                                                       \
+                                                                        \
+    t0 = bench_now();                                                   \
+                                                                        \
+    for (i = 0; i < bench_nr_loops; i++) {                              \
+        nr_convs = call;                                                \
+        check(nr_convs > 0);                                            \
+    }                                                                   \
+                                                                        \
+    bench_report(name, format, bench_now() - t0,                        \
+                 (unsigned long long)strlen(str) * bench_nr_loops);     \
+MACRO_END
+
+#define BENCH_SSCANF_ALL(str, format, ...)                              \
+MACRO_BEGIN                                                             \
+    struct fmt_scan scan;                                               \
+    int error;                                                          \
+                                                                        \
+    error = fmt_scan_compile(&scan, format);                            \
+    check(!error);                                                      \
+                                                                        \
+    BENCH_SSCANF("sscanf", str, format,                                 \
+                 sscanf(str, format, __VA_ARGS__));                     \
+    BENCH_SSCANF("fmt_sscanf", str, format,                             \
+                 fmt_sscanf(str, format, __VA_ARGS__));                 \
+    BENCH_SSCANF("fmt_scan_sscanf", str, format,                        \
+                 fmt_scan_sscanf(&scan, str, __VA_ARGS__));             \
+MACRO_END
+
+static void
+bench_sprintf(void)
+{
+    BENCH_SPRINTF_ALL("%d", (int)i);
+    BENCH_SPRINTF_ALL("%d", -123456789);
+    BENCH_SPRINTF_ALL("%u", (unsigned int)i * 2654435761U);
+    BENCH_SPRINTF_ALL("%lld", (long long)i << 32);
+    BENCH_SPRINTF_ALL("%llu", -1ULL);
+    BENCH_SPRINTF_ALL("%x", (unsigned int)i);
+    BENCH_SPRINTF_ALL("%llx", (unsigned long long)i << 40);
+    BENCH_SPRINTF_ALL("%8d", (int)i);
+    BENCH_SPRINTF_ALL("%08x", (unsigned int)i);
+    BENCH_SPRINTF_ALL("%-16s|", "left");
+    BENCH_SPRINTF_ALL("%s", "a string of moderate length");
+    BENCH_SPRINTF_ALL("%s=%d (%s)", "key", (int)i, "comment");
+    BENCH_SPRINTF_ALL("no conversion at all");
+}
+
+static void
+bench_sscanf(void)
+{
+    unsigned long long ull;
+    unsigned int u;
+    char str[64];
+    int a, b;
+
+    BENCH_SSCANF_ALL("123456", "%d", &a);
+    BENCH_SSCANF_ALL("-123 456", "%d %d", &a, &b);
+    BENCH_SSCANF_ALL("18446744073709551615", "%llu", &ull);
+    BENCH_SSCANF_ALL("deadbeef", "%x", &u);
+    BENCH_SSCANF_ALL("0x1f", "%i", &a);
+    BENCH_SSCANF_ALL("key=value 42", "key=%s %d", str, &a);
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench_nr_loops = strtoul(argv[1], NULL, 10);
+        check(bench_nr_loops != 0);
+    }
+
+    bench_sprintf();
+    bench_sscanf();
+
+    return EXIT_SUCCESS;
+}
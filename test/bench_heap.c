@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *
+ * Benchmark of priority queues.
+ *
+ * Two workloads are measured : filling a queue with random keys, then
+ * draining it, and the "hold" model, where the first node is repeatedly
+ * removed, and inserted again with a greater key, as done by timer queues.
+ * The number of nodes may be given as the first argument.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <bplist.h>
+#include <check.h>
+#include <dheap.h>
+#include <list.h>
+#include <macros.h>
+#include <pheap.h>
+#include <plist.h>
+#include <rbtree.h>
+
+#define BENCH_NR_NODES      4096
+#define BENCH_NR_HOLDS      100000
+
+/*
+ * Keys are bounded for the fill/drain workload, so that the bucketed
+ * priority list can take part.
+ */
+#define BENCH_MAX_KEY       BPLIST_MAX_PRIORITIES
+
+struct bench_obj {
+    unsigned int key;
+
+    union {
+        struct pheap_node pheap_node;
+        struct dheap_node dheap_node;
+        struct plist_node plist_node;
+        struct bplist_node bplist_node;
+        struct rbtree_node rbtree_node;
+    };
+};
+
+struct bench_ops {
+    const char *name;
+    bool bounded;
+    void (*init)(void);
+    void (*insert)(struct bench_obj *obj);
+    struct bench_obj * (*remove_first)(void);
+};
+
+static unsigned int bench_nr_nodes = BENCH_NR_NODES;
+static struct bench_obj *bench_objs;
+
+static struct pheap bench_pheap;
+static struct dheap bench_dheap;
+static struct dheap_node **bench_dheap_nodes;
+static struct plist bench_plist;
+static struct bplist bench_bplist;
+static struct list bench_bplist_buckets[BPLIST_MAX_PRIORITIES];
+static struct rbtree bench_rbtree;
+
+static unsigned long long
+bench_now(void)
+{
+    struct timespec ts;
+    int error;
+
+    error = clock_gettime(CLOCK_MONOTONIC, &ts);
+    check(!error);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static int
+bench_pheap_cmp(const struct pheap_node *a, const struct pheap_node *b)
+{
+    unsigned int ka, kb;
+
+    ka = pheap_entry(a, struct bench_obj, pheap_node)->key;
+    kb = pheap_entry(b, struct bench_obj, pheap_node)->key;
+    return (ka < kb) ? -1 : ((ka > kb) ? 1 : 0);
+}
+
+static void
+bench_pheap_init(void)
+{
+    pheap_init(&bench_pheap, bench_pheap_cmp);
+}
+
+static void
+bench_pheap_insert(struct bench_obj *obj)
+{
+    pheap_node_init(&obj->pheap_node);
+    pheap_insert(&bench_pheap, &obj->pheap_node);
+}
+
+static struct bench_obj *
+bench_pheap_remove_first(void)
+{
+    struct pheap_node *node;
+
+    node = pheap_remove_first(&bench_pheap);
+    return pheap_entry(node, struct bench_obj, pheap_node);
+}
+
+static int
+bench_dheap_cmp(const struct dheap_node *a, const struct dheap_node *b)
+{
+    unsigned int ka, kb;
+
+    ka = dheap_entry(a, struct bench_obj, dheap_node)->key;
+    kb = dheap_entry(b, struct bench_obj, dheap_node)->key;
+    return (ka < kb) ? -1 : ((ka > kb) ? 1 : 0);
+}
+
+static void
+bench_dheap_init(void)
+{
+    dheap_init(&bench_dheap, bench_dheap_nodes, bench_nr_nodes,
+               bench_dheap_cmp);
+}
+
+static void
+bench_dheap_insert(struct bench_obj *obj)
+{
+    int error;
+
+    error = dheap_insert(&bench_dheap, &obj->dheap_node);
+    check(!error);
+}
+
+static struct bench_obj *
+bench_dheap_remove_first(void)
+{
+    struct dheap_node *node;
+
+    node = dheap_remove_first(&bench_dheap);
+    return dheap_entry(node, struct bench_obj, dheap_node);
+}
+
+static void
+bench_plist_init(void)
+{
+    plist_init(&bench_plist);
+}
+
+static void
+bench_plist_insert(struct bench_obj *obj)
+{
+    plist_node_init(&obj->plist_node, obj->key);
+    plist_add(&bench_plist, &obj->plist_node);
+}
+
+static struct bench_obj *
+bench_plist_remove_first(void)
+{
+    struct plist_node *node;
+
+    node = plist_first(&bench_plist);
+    plist_remove(&bench_plist, node);
+    return plist_entry(node, struct bench_obj, plist_node);
+}
+
+static void
+bench_bplist_init(void)
+{
+    bplist_init(&bench_bplist, bench_bplist_buckets,
+                ARRAY_SIZE(bench_bplist_buckets));
+}
+
+static void
+bench_bplist_insert(struct bench_obj *obj)
+{
+    bplist_node_init(&obj->bplist_node, obj->key);
+    bplist_add(&bench_bplist, &obj->bplist_node);
+}
+
+static struct bench_obj *
+bench_bplist_remove_first(void)
+{
+    struct bplist_node *node;
+
+    node = bplist_first(&bench_bplist);
+    bplist_remove(&bench_bplist, node);
+    return bplist_entry(node, struct bench_obj, bplist_node);
+}
+
+/*
+ * Nodes never compare equal in a red-black tree, break ties with
+ * addresses.
+ */
+static inline int
+bench_rbtree_cmp(struct rbtree_node *a, struct rbtree_node *b)
+{
+    struct bench_obj *oa, *ob;
+
+    oa = rbtree_entry(a, struct bench_obj, rbtree_node);
+    ob = rbtree_entry(b, struct bench_obj, rbtree_node);
+
+    if (oa->key != ob->key) {
+        return (oa->key < ob->key) ? -1 : 1;
+    }
+
+    return (oa < ob) ? -1 : ((oa > ob) ? 1 : 0);
+}
+
+static void
+bench_rbtree_init(void)
+{
+    rbtree_init(&bench_rbtree);
+}
+
+static void
+bench_rbtree_insert(struct bench_obj *obj)
+{
+    rbtree_node_init(&obj->rbtree_node);
+    rbtree_insert(&bench_rbtree, &obj->rbtree_node, bench_rbtree_cmp);
+}
+
+static struct bench_obj *
+bench_rbtree_remove_first(void)
+{
+    struct rbtree_node *node;
+
+    node = rbtree_first(&bench_rbtree);
+    rbtree_remove(&bench_rbtree, node);
+    return rbtree_entry(node, struct bench_obj, rbtree_node);
+}
+
+static const struct bench_ops bench_ops[] = {
+    {
+        "pheap", false, bench_pheap_init,
+        bench_pheap_insert, bench_pheap_remove_first,
+    },
+    {
+        "dheap", false, bench_dheap_init,
+        bench_dheap_insert, bench_dheap_remove_first,
+    },
+    {
+        "rbtree", false, bench_rbtree_init,
+        bench_rbtree_insert, bench_rbtree_remove_first,
+    },
+    {
+        "plist", false, bench_plist_init,
+        bench_plist_insert, bench_plist_remove_first,
+    },
+    {
+        "bplist", true, bench_bplist_init,
+        bench_bplist_insert, bench_bplist_remove_first,
+    },
+};
+
+static void
+bench_report(const char *name, const char *workload,
+             unsigned long long duration, unsigned long nr_ops)
+{
+    printf("%-8s %-10s %10.1f ns/op\n", name, workload,
+           (double)duration / nr_ops);
+}
+
+static void
+bench_fill_drain(const struct bench_ops *ops)
+{
+    unsigned long long t0;
+    struct bench_obj *obj;
+    unsigned int i, prev_key;
+
+    srand(1);
+
+    for (i = 0; i < bench_nr_nodes; i++) {
+        bench_objs[i].key = rand() % BENCH_MAX_KEY;
+    }
+
+    ops->init();
+    t0 = bench_now();
+
+    for (i = 0; i < bench_nr_nodes; i++) {
+        ops->insert(&bench_objs[i]);
+    }
+
+    bench_report(ops->name, "fill", bench_now() - t0, bench_nr_nodes);
+
+    prev_key = 0;
+    t0 = bench_now();
+
+    for (i = 0; i < bench_nr_nodes; i++) {
+        obj = ops->remove_first();
+        check(obj->key >= prev_key);
+        prev_key = obj->key;
+    }
+
+    bench_report(ops->name, "drain", bench_now() - t0, bench_nr_nodes);
+}
+
+static void
+bench_hold(const struct bench_ops *ops)
+{
+    unsigned long long t0;
+    struct bench_obj *obj;
+    unsigned int i;
+
+    srand(1);
+    ops->init();
+
+    for (i = 0; i < bench_nr_nodes; i++) {
+        bench_objs[i].key = rand() % bench_nr_nodes;
+        ops->insert(&bench_objs[i]);
+    }
+
+    t0 = bench_now();
+
+    for (i = 0; i < BENCH_NR_HOLDS; i++) {
+        obj = ops->remove_first();
+        obj->key += 1 + (rand() % bench_nr_nodes);
+        ops->insert(obj);
+    }
+
+    bench_report(ops->name, "hold", bench_now() - t0, BENCH_NR_HOLDS);
+
+    for (i = 0; i < bench_nr_nodes; i++) {
+        ops->remove_first();
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    size_t i;
+
+    if (argc > 1) {
+        bench_nr_nodes = strtoul(argv[1], NULL, 10);
+        check(bench_nr_nodes != 0);
+    }
+
+    bench_objs = malloc(bench_nr_nodes * sizeof(*bench_objs));
+    check(bench_objs != NULL);
+    bench_dheap_nodes = malloc(bench_nr_nodes * sizeof(*bench_dheap_nodes));
+    check(bench_dheap_nodes != NULL);
+
+    for (i = 0; i < ARRAY_SIZE(bench_ops); i++) {
+        bench_fill_drain(&bench_ops[i]);
+
+        if (!bench_ops[i].bounded) {
+            bench_hold(&bench_ops[i]);
+        }
+    }
+
+    free(bench_dheap_nodes);
+    free(bench_objs);
+    return EXIT_SUCCESS;
+}
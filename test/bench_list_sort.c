@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *
+ * Benchmark of list sorting.
+ *
+ * Sort lists of various initial orders, and check the result is sorted
+ * and stable, with both the serial and parallel sorts. The number of
+ * entries may be given as the first argument, and the number of threads
+ * for the parallel sort as the second one.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <list.h>
+#include <macros.h>
+
+#define BENCH_NR_OBJS 10000000
+
+struct obj {
+    struct list node;
+    unsigned int key;
+    unsigned int index;
+};
+
+static size_t bench_nr_objs = BENCH_NR_OBJS;
+static unsigned int bench_nr_threads;
+static struct obj *bench_objs;
+
+static unsigned long long
+bench_now(void)
+{
+    struct timespec ts;
+    int error;
+
+    error = clock_gettime(CLOCK_MONOTONIC, &ts);
+    check(!error);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static int
+bench_cmp(struct list *a, struct list *b)
+{
+    unsigned int key_a, key_b;
+
+    key_a = list_entry(a, struct obj, node)->key;
+    key_b = list_entry(b, struct obj, node)->key;
+    return (key_a < key_b) ? -1 : (key_a > key_b);
+}
+
+static unsigned int
+bench_key_random(size_t i __unused)
+{
+    return rand();
+}
+
+static unsigned int
+bench_key_few(size_t i __unused)
+{
+    return rand() % 16;
+}
+
+static unsigned int
+bench_key_sorted(size_t i)
+{
+    return i;
+}
+
+static unsigned int
+bench_key_reversed(size_t i)
+{
+    return bench_nr_objs - i;
+}
+
+static unsigned int
+bench_key_nearly_sorted(size_t i)
+{
+    return ((rand() % 100) == 0) ? (unsigned int)rand() : i;
+}
+
+static unsigned int
+bench_key_sawtooth(size_t i)
+{
+    return i % 1000;
+}
+
+/*
+ * Entries are linked in a shuffled memory order, so that list traversal
+ * doesn't benefit from sequential memory accesses.
+ */
+static void
+bench_init(struct list *list, unsigned int (*key_fn)(size_t))
+{
+    size_t i, j, tmp, *order;
+
+    order = malloc(bench_nr_objs * sizeof(*order));
+    check(order != NULL);
+
+    for (i = 0; i < bench_nr_objs; i++) {
+        order[i] = i;
+    }
+
+    for (i = bench_nr_objs - 1; i > 0; i--) {
+        j = ((size_t)rand() * RAND_MAX + rand()) % (i + 1);
+        tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    list_init(list);
+
+    for (i = 0; i < bench_nr_objs; i++) {
+        bench_objs[order[i]].key = key_fn(i);
+        bench_objs[order[i]].index = i;
+        list_insert_tail(list, &bench_objs[order[i]].node);
+    }
+
+    free(order);
+}
+
+static void
+bench_verify(struct list *list)
+{
+    struct obj *obj, *prev;
+    size_t nr_objs;
+
+    prev = NULL;
+    nr_objs = 0;
+
+    list_for_each_entry(list, obj, node) {
+        check(list_prev(&obj->node)->next == &obj->node);
+
+        if (prev != NULL) {
+            check(prev->key <= obj->key);
+
+            if (prev->key == obj->key) {
+                check(prev->index < obj->index);
+            }
+        }
+
+        prev = obj;
+        nr_objs++;
+    }
+
+    check(list->prev == &prev->node);
+    check(nr_objs == bench_nr_objs);
+}
+
+static void
+bench_report(const char *name, const char *variant,
+             unsigned long long duration)
+{
+    printf("%-16s %-10s %10zu entries %10.1f ms %8.1f ns/entry\n",
+           name, variant, bench_nr_objs, (double)duration / 1000000,
+           (double)duration / bench_nr_objs);
+}
+
+static void
+bench_run(const char *name, unsigned int (*key_fn)(size_t))
+{
+    unsigned long long t0, duration;
+    struct list list;
+    unsigned int seed;
+
+    seed = rand();
+
+    srand(seed);
+    bench_init(&list, key_fn);
+    t0 = bench_now();
+    list_sort(&list, bench_cmp);
+    duration = bench_now() - t0;
+    bench_verify(&list);
+    bench_report(name, "serial", duration);
+
+    srand(seed);
+    bench_init(&list, key_fn);
+    t0 = bench_now();
+    list_sort_parallel(&list, bench_cmp, bench_nr_threads);
+    duration = bench_now() - t0;
+    bench_verify(&list);
+    bench_report(name, "parallel", duration);
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench_nr_objs = strtoul(argv[1], NULL, 10);
+        check(bench_nr_objs != 0);
+    }
+
+    if (argc > 2) {
+        bench_nr_threads = strtoul(argv[2], NULL, 10);
+    } else {
+        bench_nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    check(bench_nr_threads != 0);
+
+    bench_objs = malloc(bench_nr_objs * sizeof(*bench_objs));
+    check(bench_objs != NULL);
+
+    bench_run("random", bench_key_random);
+    bench_run("few_unique", bench_key_few);
+    bench_run("sorted", bench_key_sorted);
+    bench_run("reversed", bench_key_reversed);
+    bench_run("nearly_sorted", bench_key_nearly_sorted);
+    bench_run("sawtooth", bench_key_sawtooth);
+
+    free(bench_objs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *
+ * Lock benchmark.
+ *
+ * Threads repeatedly acquire a lock, update shared data, release the
+ * lock, and do some work outside the critical section. Spin locks, ticket
+ * locks, MCS locks and sequence locks are compared with pthread mutexes.
+ * For sequence locks, one thread writes and the others read. The number
+ * of loops per thread and the number of threads may be given as the first
+ * and second arguments.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <check.h>
+#include <cpu.h>
+#include <macros.h>
+#include <seqlock.h>
+#include <spinlock.h>
+
+#define BENCH_NR_LOOPS      1000000
+#define BENCH_MAX_THREADS   256
+
+/*
+ * Number of iterations of the loop simulating work outside critical
+ * sections.
+ */
+#define BENCH_NR_IDLE_LOOPS 50
+
+struct bench_data {
+    unsigned long a;
+    unsigned long b;
+};
+
+static unsigned long bench_nr_loops = BENCH_NR_LOOPS;
+static unsigned int bench_nr_threads;
+
+static pthread_barrier_t bench_barrier;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct spinlock bench_spinlock __cacheline_aligned;
+static struct ticketlock bench_ticketlock __cacheline_aligned;
+static struct mcslock bench_mcslock __cacheline_aligned;
+static struct seqlock bench_seqlock __cacheline_aligned;
+
+static struct bench_data bench_data __cacheline_aligned;
+
+static unsigned long long
+bench_now(void)
+{
+    struct timespec ts;
+    int error;
+
+    error = clock_gettime(CLOCK_MONOTONIC, &ts);
+    check(!error);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static void
+bench_idle(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < BENCH_NR_IDLE_LOOPS; i++) {
+        barrier();
+    }
+}
+
+static void
+bench_update(void)
+{
+    bench_data.a++;
+    bench_data.b += 2;
+}
+
+static void
+bench_run_mutex(unsigned int id __unused)
+{
+    unsigned long i;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        pthread_mutex_lock(&bench_mutex);
+        bench_update();
+        pthread_mutex_unlock(&bench_mutex);
+        bench_idle();
+    }
+}
+
+static void
+bench_run_spinlock(unsigned int id __unused)
+{
+    unsigned long i;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        spinlock_lock(&bench_spinlock);
+        bench_update();
+        spinlock_unlock(&bench_spinlock);
+        bench_idle();
+    }
+}
+
+static void
+bench_run_ticketlock(unsigned int id __unused)
+{
+    unsigned long i;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        ticketlock_lock(&bench_ticketlock);
+        bench_update();
+        ticketlock_unlock(&bench_ticketlock);
+        bench_idle();
+    }
+}
+
+static void
+bench_run_mcslock(unsigned int id __unused)
+{
+    struct mcslock_qnode qnode;
+    unsigned long i;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        mcslock_lock(&bench_mcslock, &qnode);
+        bench_update();
+        mcslock_unlock(&bench_mcslock, &qnode);
+        bench_idle();
+    }
+}
+
+static void
+bench_run_seqlock(unsigned int id)
+{
+    unsigned long i, a, b;
+    unsigned int seq;
+
+    for (i = 0; i < bench_nr_loops; i++) {
+        if (id == 0) {
+            seqlock_write_lock(&bench_seqlock);
+            WRITE_ONCE(bench_data.a, bench_data.a + 1);
+            WRITE_ONCE(bench_data.b, bench_data.b + 2);
+            seqlock_write_unlock(&bench_seqlock);
+        } else {
+            do {
+                seq = seqlock_read_begin(&bench_seqlock);
+                a = READ_ONCE(bench_data.a);
+                b = READ_ONCE(bench_data.b);
+            } while (seqlock_read_retry(&bench_seqlock, seq));
+
+            check(b == (a * 2));
+        }
+
+        bench_idle();
+    }
+}
+
+struct bench_work {
+    pthread_t thread;
+    unsigned int id;
+    void (*fn)(unsigned int id);
+};
+
+static void *
+bench_run(void *arg)
+{
+    struct bench_work *work;
+
+    work = arg;
+    pthread_barrier_wait(&bench_barrier);
+    work->fn(work->id);
+    return NULL;
+}
+
+static void
+bench_mutex_stats(struct spinlock_stats *stats)
+{
+    stats->nr_acquires = 0;
+    stats->nr_contended = 0;
+}
+
+static void
+bench_spinlock_stats(struct spinlock_stats *stats)
+{
+    spinlock_get_stats(&bench_spinlock, stats);
+}
+
+static void
+bench_ticketlock_stats(struct spinlock_stats *stats)
+{
+    ticketlock_get_stats(&bench_ticketlock, stats);
+}
+
+static void
+bench_mcslock_stats(struct spinlock_stats *stats)
+{
+    mcslock_get_stats(&bench_mcslock, stats);
+}
+
+static void
+bench_seqlock_stats(struct spinlock_stats *stats)
+{
+    struct seqlock_stats seqlock_stats;
+
+    seqlock_get_stats(&bench_seqlock, &seqlock_stats);
+    *stats = seqlock_stats.write;
+
+    if (seqlock_stats.nr_read_retries != 0) {
+        printf("  read retries: %lu", seqlock_stats.nr_read_retries);
+    }
+}
+
+/*
+ * Contention statistics are only reported when collected, i.e. when built
+ * with --enable-lock-stats.
+ */
+static void
+bench_one(const char *name, void (*fn)(unsigned int id),
+          void (*get_stats)(struct spinlock_stats *stats))
+{
+    struct bench_work works[BENCH_MAX_THREADS];
+    struct spinlock_stats stats;
+    unsigned long long t0, duration;
+    unsigned int i;
+    int error;
+
+    bench_data.a = 0;
+    bench_data.b = 0;
+
+    error = pthread_barrier_init(&bench_barrier, NULL, bench_nr_threads + 1);
+    check(!error);
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        works[i].id = i;
+        works[i].fn = fn;
+        error = pthread_create(&works[i].thread, NULL, bench_run, &works[i]);
+        check(!error);
+    }
+
+    pthread_barrier_wait(&bench_barrier);
+    t0 = bench_now();
+
+    for (i = 0; i < bench_nr_threads; i++) {
+        error = pthread_join(works[i].thread, NULL);
+        check(!error);
+    }
+
+    duration = bench_now() - t0;
+    pthread_barrier_destroy(&bench_barrier);
+
+    printf("%-12s %10.1f ns/op %10.2f Mops/s",
+           name, (double)duration / bench_nr_loops,
+           ((double)bench_nr_loops * bench_nr_threads * 1000) / duration);
+
+    get_stats(&stats);
+
+    if (stats.nr_acquires != 0) {
+        printf("  contended: %5.1f%%",
+               (stats.nr_contended * 100.0) / stats.nr_acquires);
+    }
+
+    printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench_nr_loops = strtoul(argv[1], NULL, 10);
+        check(bench_nr_loops != 0);
+    }
+
+    if (argc > 2) {
+        bench_nr_threads = strtoul(argv[2], NULL, 10);
+    } else {
+        bench_nr_threads = cpu_count();
+    }
+
+    check((bench_nr_threads != 0) && (bench_nr_threads <= BENCH_MAX_THREADS));
+
+    printf("threads: %u, processors: %u\n", bench_nr_threads, cpu_count());
+
+    spinlock_init(&bench_spinlock);
+    ticketlock_init(&bench_ticketlock);
+    mcslock_init(&bench_mcslock);
+    seqlock_init(&bench_seqlock);
+
+    bench_one("mutex", bench_run_mutex, bench_mutex_stats);
+    bench_one("spinlock", bench_run_spinlock, bench_spinlock_stats);
+    bench_one("ticketlock", bench_run_ticketlock, bench_ticketlock_stats);
+    bench_one("mcslock", bench_run_mcslock, bench_mcslock_stats);
+    bench_one("seqlock", bench_run_seqlock, bench_seqlock_stats);
+
+    return EXIT_SUCCESS;
+}
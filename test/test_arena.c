@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arena.h>
+#include <check.h>
+#include <macros.h>
+#include <rdxtree.h>
+
+#define TEST_NR_ALLOCS      100000
+#define TEST_NR_KEYS        100000
+
+static void
+test_alloc(int flags)
+{
+    unsigned char *ptrs[TEST_NR_ALLOCS];
+    struct arena arena;
+    size_t size, align;
+    unsigned int i, j;
+    void *first;
+
+    printf("alloc, flags: %x\n", flags);
+
+    arena_init(&arena, 0, flags);
+
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++) {
+        size = 1 + (i % 200);
+        align = 1UL << (i % 8);
+        ptrs[i] = arena_alloc(&arena, size, align);
+        check(ptrs[i] != NULL);
+        check(P2ALIGNED((uintptr_t)ptrs[i], align));
+        memset(ptrs[i], (unsigned char)i, size);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++) {
+        size = 1 + (i % 200);
+
+        for (j = 0; j < size; j++) {
+            check(ptrs[i][j] == (unsigned char)i);
+        }
+    }
+
+    /* Larger than a chunk */
+    size = ARENA_CHUNK_SIZE * 3;
+    ptrs[0] = arena_alloc(&arena, size, 0);
+    check(ptrs[0] != NULL);
+    memset(ptrs[0], 0xaa, size);
+
+    ptrs[1] = arena_alloc(&arena, 64, 0);
+    check(ptrs[1] != NULL);
+    check((ptrs[1] < ptrs[0]) || (ptrs[1] >= (ptrs[0] + size)));
+
+    /* The first chunk is kept */
+    arena_reset(&arena);
+    first = arena_alloc(&arena, 1, 1);
+    check(first != NULL);
+    arena_reset(&arena);
+    check(arena_alloc(&arena, 1, 1) == first);
+
+    arena_destroy(&arena);
+}
+
+static void
+test_rewind(void)
+{
+    struct arena_mark marks[3];
+    struct arena arena;
+    void *ptrs[3], *ptr;
+    unsigned int i, j;
+
+    printf("rewind\n");
+
+    arena_init(&arena, 4096, 0);
+
+    for (i = 0; i < ARRAY_SIZE(marks); i++) {
+        arena_save(&arena, &marks[i]);
+        ptrs[i] = arena_alloc(&arena, 16, 16);
+        check(ptrs[i] != NULL);
+
+        /* Make sure new chunks are used between positions */
+        for (j = 0; j < 1000; j++) {
+            check(arena_alloc(&arena, 16, 16) != NULL);
+        }
+    }
+
+    for (i = ARRAY_SIZE(marks); i-- > 0; ) {
+        arena_rewind(&arena, &marks[i]);
+        ptr = arena_alloc(&arena, 16, 16);
+        check(ptr == ptrs[i]);
+        arena_rewind(&arena, &marks[i]);
+    }
+
+    arena_destroy(&arena);
+}
+
+static void
+test_rdxtree(void)
+{
+    struct arena_mark mark;
+    struct rdxtree tree;
+    struct arena arena;
+    unsigned long *obj;
+    rdxtree_key_t key;
+    unsigned int i;
+    int error;
+
+    printf("rdxtree\n");
+
+    arena_init(&arena, 0, 0);
+
+    for (i = 0; i < 3; i++) {
+        arena_save(&arena, &mark);
+        rdxtree_init_arena(&tree, 0, &arena);
+
+        for (key = 0; key < TEST_NR_KEYS; key++) {
+            obj = arena_alloc(&arena, sizeof(*obj), 0);
+            check(obj != NULL);
+            *obj = key * 3;
+            error = rdxtree_insert(&tree, key * 3, obj);
+            check(!error);
+        }
+
+        for (key = 0; key < TEST_NR_KEYS; key++) {
+            obj = rdxtree_lookup(&tree, key * 3);
+            check(obj != NULL);
+            check(*obj == (key * 3));
+
+            if ((key % 2) == 0) {
+                check(rdxtree_remove(&tree, key * 3) == obj);
+            }
+        }
+
+        /* Discard the whole tree at once */
+        arena_rewind(&arena, &mark);
+    }
+
+    arena_destroy(&arena);
+}
+
+int
+main(void)
+{
+    test_alloc(0);
+    test_alloc(ARENA_HUGE_PAGES);
+    test_alloc(ARENA_NUMA_LOCAL);
+    test_alloc(ARENA_HUGE_PAGES | ARENA_NUMA_INTERLEAVE);
+    test_rewind();
+    test_rdxtree();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bplist.h>
+#include <check.h>
+#include <list.h>
+#include <macros.h>
+
+#define TEST_NR_OBJS        1024
+#define TEST_NR_LOOPS       100000
+
+struct obj {
+    struct bplist_node node;
+    unsigned long seq;
+    int linked;
+};
+
+static struct obj test_objs[TEST_NR_OBJS];
+
+static void
+test_check(const struct bplist *bplist, unsigned int nr_linked)
+{
+    const struct bplist_node *pnode, *prev;
+    const struct obj *obj, *prev_obj;
+    unsigned int nr_nodes;
+
+    prev = NULL;
+    nr_nodes = 0;
+
+    bplist_for_each(bplist, pnode) {
+        obj = bplist_entry(pnode, struct obj, node);
+        check(obj->linked);
+
+        if (prev != NULL) {
+            prev_obj = bplist_entry(prev, struct obj, node);
+            check(bplist_node_priority(prev) <= bplist_node_priority(pnode));
+
+            if (bplist_node_priority(prev) == bplist_node_priority(pnode)) {
+                check(prev_obj->seq < obj->seq);
+            }
+        }
+
+        check(bplist_prev(bplist, pnode) == prev);
+        prev = pnode;
+        nr_nodes++;
+    }
+
+    check(nr_nodes == nr_linked);
+    check(bplist_last(bplist) == prev);
+    check(bplist_empty(bplist) == (nr_linked == 0));
+}
+
+static void
+test_run(unsigned int nr_priorities)
+{
+    struct bplist_node *pnode, *tmp;
+    unsigned int i, nr_linked;
+    struct list *buckets;
+    struct bplist bplist;
+    unsigned long seq;
+    struct obj *obj;
+
+    printf("nr_priorities: %u\n", nr_priorities);
+
+    buckets = malloc(nr_priorities * sizeof(*buckets));
+    check(buckets != NULL);
+    bplist_init(&bplist, buckets, nr_priorities);
+    check(bplist_first(&bplist) == NULL);
+    check(bplist_last(&bplist) == NULL);
+
+    nr_linked = 0;
+
+    for (seq = 0; seq < TEST_NR_LOOPS; seq++) {
+        obj = &test_objs[rand() % TEST_NR_OBJS];
+
+        if (obj->linked) {
+            bplist_remove(&bplist, &obj->node);
+            obj->linked = 0;
+            nr_linked--;
+        } else {
+            bplist_node_init(&obj->node, rand() % nr_priorities);
+            obj->seq = seq;
+            bplist_add(&bplist, &obj->node);
+            obj->linked = 1;
+            nr_linked++;
+        }
+
+        if ((seq % 1000) == 0) {
+            test_check(&bplist, nr_linked);
+        }
+    }
+
+    test_check(&bplist, nr_linked);
+
+    bplist_for_each_safe(&bplist, pnode, tmp) {
+        bplist_remove(&bplist, pnode);
+        bplist_entry(pnode, struct obj, node)->linked = 0;
+        nr_linked--;
+    }
+
+    check(nr_linked == 0);
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        check(!test_objs[i].linked);
+    }
+
+    test_check(&bplist, 0);
+    free(buckets);
+}
+
+int
+main(void)
+{
+    test_run(1);
+    test_run(7);
+    test_run(LONG_BIT);
+    test_run(1000);
+    test_run(BPLIST_MAX_PRIORITIES);
+    return EXIT_SUCCESS;
+}
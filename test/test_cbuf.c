@@ -28,6 +28,7 @@
 #include <cbuf.h>
 #include <check.h>
 #include <macros.h>
+#include <numa.h>
 
 #define TEST_BUF_SIZE 1024
 
@@ -325,6 +326,26 @@ test_pop_buf_overflow(void)
 #undef STRING
 }
 
+static void
+test_numa(int policy)
+{
+    struct cbuf cbuf;
+    size_t size;
+    int error;
+
+    error = cbuf_init_numa(&cbuf, TEST_BUF_SIZE * 64, policy);
+    check(!error);
+
+#define STRING "abcdef"
+    test_push(&cbuf, STRING);
+    test_check(&cbuf, cbuf_start(&cbuf), STRING, STRLEN(STRING));
+    size = cbuf_size(&cbuf);
+    check(size == sizeof(STRING));
+#undef STRING
+
+    cbuf_destroy_numa(&cbuf);
+}
+
 int
 main(void)
 {
@@ -342,6 +363,9 @@ main(void)
     test_push_buf_overflow();
     test_pop_buf();
     test_pop_buf_overflow();
+    test_numa(NUMA_POLICY_DEFAULT);
+    test_numa(NUMA_POLICY_LOCAL);
+    test_numa(NUMA_POLICY_INTERLEAVE);
 
     return 0;
 }
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <cpq.h>
+#include <macros.h>
+
+#define TEST_NR_OBJS        100000
+#define TEST_NR_PRIORITIES  1000
+#define TEST_NR_THREADS     8
+
+struct obj {
+    struct cpq_node node;
+    atomic_uint nr_pops;
+};
+
+static struct cpq test_cpq;
+static struct obj test_objs[TEST_NR_OBJS];
+static atomic_uint test_nr_pushed;
+static atomic_uint test_nr_popped;
+
+static void
+test_serial(void)
+{
+    unsigned int i, prev_priority, priority;
+    struct cpq_node *node;
+    int error;
+
+    printf("serial\n");
+
+    error = cpq_init(&test_cpq);
+    check(!error);
+    check(cpq_empty(&test_cpq));
+    check(cpq_pop(&test_cpq) == NULL);
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        cpq_node_init(&test_objs[i].node, rand() % TEST_NR_PRIORITIES);
+        cpq_push(&test_cpq, &test_objs[i].node);
+    }
+
+    check(!cpq_empty(&test_cpq));
+    prev_priority = 0;
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        node = cpq_pop(&test_cpq);
+        check(node != NULL);
+        priority = cpq_node_priority(node);
+        check(priority >= prev_priority);
+        prev_priority = priority;
+    }
+
+    check(cpq_empty(&test_cpq));
+    check(cpq_pop(&test_cpq) == NULL);
+    cpq_destroy(&test_cpq);
+}
+
+static void *
+test_producer(void *arg)
+{
+    unsigned int i, seed;
+
+    seed = (unsigned int)(uintptr_t)arg;
+
+    for (;;) {
+        i = atomic_fetch_add(&test_nr_pushed, 1);
+
+        if (i >= TEST_NR_OBJS) {
+            break;
+        }
+
+        cpq_node_init(&test_objs[i].node, rand_r(&seed) % TEST_NR_PRIORITIES);
+        atomic_init(&test_objs[i].nr_pops, 0);
+        cpq_push(&test_cpq, &test_objs[i].node);
+    }
+
+    return NULL;
+}
+
+static void *
+test_consumer(void *arg __unused)
+{
+    struct cpq_node *node;
+    struct obj *obj;
+
+    while (atomic_load(&test_nr_popped) < TEST_NR_OBJS) {
+        node = cpq_pop(&test_cpq);
+
+        if (node == NULL) {
+            continue;
+        }
+
+        obj = cpq_entry(node, struct obj, node);
+        check(atomic_fetch_add(&obj->nr_pops, 1) == 0);
+        atomic_fetch_add(&test_nr_popped, 1);
+    }
+
+    return NULL;
+}
+
+static void
+test_concurrent(void)
+{
+    pthread_t threads[TEST_NR_THREADS * 2];
+    unsigned int i;
+    int error;
+
+    printf("concurrent\n");
+
+    error = cpq_init(&test_cpq);
+    check(!error);
+    atomic_init(&test_nr_pushed, 0);
+    atomic_init(&test_nr_popped, 0);
+
+    for (i = 0; i < TEST_NR_THREADS; i++) {
+        error = pthread_create(&threads[i * 2], NULL, test_producer,
+                               (void *)(uintptr_t)(i + 1));
+        check(!error);
+        error = pthread_create(&threads[(i * 2) + 1], NULL, test_consumer,
+                               NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    check(cpq_empty(&test_cpq));
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        check(atomic_load(&test_objs[i].nr_pops) == 1);
+    }
+
+    cpq_destroy(&test_cpq);
+}
+
+int
+main(void)
+{
+    test_serial();
+    test_concurrent();
+    return EXIT_SUCCESS;
+}
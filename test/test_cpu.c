@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <cpu.h>
+#include <macros.h>
+
+int
+main(void)
+{
+    unsigned int cpu, nr_cpus, llc;
+
+    nr_cpus = cpu_count();
+    printf("nr_cpus: %u (max: %u)\n", nr_cpus, NR_CPUS);
+    printf("l1_size: %u\n", cpu_l1_size());
+    printf("nr_nodes: %u\n", cpu_nr_nodes());
+
+    check((nr_cpus >= 1) && (nr_cpus <= NR_CPUS));
+    check(ISP2(cpu_l1_size()));
+    check(cpu_nr_nodes() >= 1);
+
+    if (cpu_ids_bounded()) {
+        check((unsigned int)cpu_id() < nr_cpus);
+    }
+
+    for (cpu = 0; cpu < nr_cpus; cpu++) {
+        llc = cpu_llc(cpu);
+        printf("cpu%u: node: %u llc: %u\n", cpu, cpu_node(cpu), llc);
+        check(cpu_node(cpu) < cpu_nr_nodes());
+        check(llc <= cpu);
+        check(cpu_llc(llc) == llc);
+    }
+
+    return EXIT_SUCCESS;
+}
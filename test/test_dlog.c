@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <check.h>
+#include <dlog.h>
+#include <macros.h>
+
+#define TEST_NR_THREADS     4
+#define TEST_NR_MSGS        10000
+#define TEST_BUFFER_SIZE    4096
+
+struct test_output {
+    pthread_mutex_t lock;
+    char last_line[DLOG_MAX_LINE_SIZE];
+    unsigned long nr_lines;
+    unsigned int next_msg[TEST_NR_THREADS];
+};
+
+static struct test_output test_output;
+
+static void
+test_write(void *arg, const char *str, size_t size)
+{
+    struct test_output *output;
+    unsigned int thread_id, msg_id;
+    int ret;
+
+    output = arg;
+    check(strlen(str) == size);
+
+    pthread_mutex_lock(&output->lock);
+
+    memcpy(output->last_line, str, size + 1);
+    output->nr_lines++;
+
+    ret = sscanf(str, "thread:%u msg:%u", &thread_id, &msg_id);
+
+    if (ret == 2) {
+        check(thread_id < ARRAY_SIZE(output->next_msg));
+        check(output->next_msg[thread_id] == msg_id);
+        output->next_msg[thread_id]++;
+    }
+
+    pthread_mutex_unlock(&output->lock);
+}
+
+static void
+test_output_init(struct test_output *output)
+{
+    pthread_mutex_init(&output->lock, NULL);
+    output->last_line[0] = '\0';
+    output->nr_lines = 0;
+    memset(output->next_msg, 0, sizeof(output->next_msg));
+}
+
+static void
+test_regular(void)
+{
+    char buf[TEST_BUFFER_SIZE], expected[DLOG_MAX_LINE_SIZE];
+    struct dlog_buffer buffer;
+    struct dlog dlog;
+    int error;
+
+    test_output_init(&test_output);
+    dlog_init(&dlog, test_write, &test_output);
+
+    error = dlog_printf("unregistered");
+    check(error == ENOENT);
+
+    dlog_register(&dlog, &buffer, buf, sizeof(buf));
+
+#define FORMAT "%d:%-5s:%#lx:%c:%.2s:%p"
+    error = dlog_printf(FORMAT, -12, "abc", 0x1234L, 'z', "xyz", &buffer);
+    check(!error);
+    snprintf(expected, sizeof(expected), FORMAT,
+             -12, "abc", 0x1234L, 'z', "xyz", &buffer);
+#undef FORMAT
+
+    check(test_output.nr_lines == 0);
+    dlog_flush(&dlog);
+    check(test_output.nr_lines == 1);
+    check(strcmp(test_output.last_line, expected) == 0);
+
+    error = dlog_printf("%d%n", 1, &error);
+    check(error == EINVAL);
+
+    dlog_unregister(&buffer);
+}
+
+static void
+test_drops(void)
+{
+    char buf[DLOG_MAX_MSG_SIZE];
+    struct dlog_buffer buffer;
+    struct dlog dlog;
+    unsigned long i;
+    int error;
+
+    test_output_init(&test_output);
+    dlog_init(&dlog, test_write, &test_output);
+    dlog_register(&dlog, &buffer, buf, sizeof(buf));
+
+    for (i = 0; /* no condition */; i++) {
+        error = dlog_printf("%lu", i);
+
+        if (error) {
+            check(error == EMSGSIZE);
+            break;
+        }
+    }
+
+    check(dlog_buffer_nr_drops(&buffer) == 1);
+    dlog_unregister(&buffer);
+    check(test_output.nr_lines == i);
+}
+
+struct test_thread {
+    pthread_t thread;
+    struct dlog *dlog;
+    unsigned int id;
+};
+
+static void *
+test_produce(void *arg)
+{
+    struct test_thread *thread;
+    char buf[TEST_BUFFER_SIZE];
+    struct dlog_buffer buffer;
+    unsigned int i;
+    int error;
+
+    thread = arg;
+    dlog_register(thread->dlog, &buffer, buf, sizeof(buf));
+
+    for (i = 0; i < TEST_NR_MSGS; i++) {
+        do {
+            error = dlog_printf("thread:%u msg:%u", thread->id, i);
+
+            if (error) {
+                check(error == EMSGSIZE);
+                sched_yield();
+            }
+        } while (error);
+    }
+
+    dlog_unregister(&buffer);
+    return NULL;
+}
+
+static void
+test_threads(void)
+{
+    struct test_thread threads[TEST_NR_THREADS];
+    struct dlog dlog;
+    unsigned int i;
+    int error;
+
+    test_output_init(&test_output);
+    dlog_init(&dlog, test_write, &test_output);
+    error = dlog_start(&dlog);
+    check(!error);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        threads[i].dlog = &dlog;
+        threads[i].id = i;
+        error = pthread_create(&threads[i].thread, NULL,
+                               test_produce, &threads[i]);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+
+    dlog_stop(&dlog);
+
+    check(test_output.nr_lines == (TEST_NR_THREADS * TEST_NR_MSGS));
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        check(test_output.next_msg[i] == TEST_NR_MSGS);
+    }
+}
+
+int
+main(void)
+{
+    test_regular();
+    test_drops();
+    test_threads();
+    return EXIT_SUCCESS;
+}
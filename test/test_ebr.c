@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <ebr.h>
+#include <macros.h>
+#include <rcu.h>
+#include <rdxtree.h>
+
+#define TEST_NR_READERS     4
+#define TEST_NR_WRITERS     2
+#define TEST_NR_UPDATES     20000
+#define TEST_NR_SLOTS       16
+
+#define TEST_NR_KEYS        4096
+#define TEST_NR_ROUNDS      20
+
+struct obj {
+    struct ebr_node ebr_node;
+    unsigned long value;
+    atomic_bool valid;
+};
+
+static struct obj test_objs[TEST_NR_WRITERS][TEST_NR_UPDATES];
+static struct obj *test_slots[TEST_NR_SLOTS];
+static atomic_bool test_done;
+static atomic_uint test_nr_released;
+
+static pthread_barrier_t test_barrier;
+
+static struct rdxtree test_tree;
+
+static void
+test_init_obj(struct obj *obj, unsigned long value)
+{
+    obj->value = value;
+    atomic_init(&obj->valid, true);
+}
+
+static void
+test_check_obj(struct obj *obj)
+{
+    check(atomic_load_explicit(&obj->valid, memory_order_relaxed));
+    check(obj->value == (unsigned long)(obj - &test_objs[0][0]));
+}
+
+static void
+test_invalidate(struct ebr_node *node)
+{
+    struct obj *obj;
+
+    obj = structof(node, struct obj, ebr_node);
+    atomic_store_explicit(&obj->valid, false, memory_order_relaxed);
+    atomic_fetch_add(&test_nr_released, 1);
+}
+
+static void
+test_start(void)
+{
+    int error;
+
+    atomic_store(&test_done, false);
+    atomic_store(&test_nr_released, 0);
+    error = pthread_barrier_init(&test_barrier, NULL, 2);
+    check(!error);
+}
+
+static void *
+test_blocker(void *arg __unused)
+{
+    ebr_register_thread();
+
+    ebr_enter();
+    ebr_enter();
+    ebr_exit();
+    pthread_barrier_wait(&test_barrier);
+
+    while (!atomic_load(&test_done)) {
+        sched_yield();
+    }
+
+    ebr_exit();
+    ebr_unregister_thread();
+    return NULL;
+}
+
+/*
+ * Check that a thread inside a critical section prevents the release of
+ * objects retired meanwhile, including with nested critical sections.
+ */
+static void
+test_blocking(void)
+{
+    pthread_t thread;
+    unsigned int i;
+    int error;
+
+    printf("blocking\n");
+
+    test_start();
+
+    error = pthread_create(&thread, NULL, test_blocker, NULL);
+    check(!error);
+    pthread_barrier_wait(&test_barrier);
+
+    ebr_register_thread();
+
+    for (i = 0; i < TEST_NR_UPDATES; i++) {
+        test_init_obj(&test_objs[0][i], i);
+        ebr_retire(&test_objs[0][i].ebr_node, test_invalidate);
+    }
+
+    for (i = 0; i < 16; i++) {
+        ebr_collect();
+    }
+
+    check(atomic_load(&test_nr_released) == 0);
+
+    atomic_store(&test_done, true);
+    error = pthread_join(thread, NULL);
+    check(!error);
+
+    ebr_barrier();
+    check(atomic_load(&test_nr_released) == TEST_NR_UPDATES);
+
+    for (i = 0; i < TEST_NR_UPDATES; i++) {
+        check(!atomic_load(&test_objs[0][i].valid));
+    }
+
+    ebr_unregister_thread();
+    pthread_barrier_destroy(&test_barrier);
+}
+
+static void *
+test_reader(void *arg __unused)
+{
+    unsigned int i;
+    struct obj *obj;
+
+    ebr_register_thread();
+
+    while (!atomic_load(&test_done)) {
+        ebr_enter();
+
+        for (i = 0; i < ARRAY_SIZE(test_slots); i++) {
+            obj = rcu_load_ptr(test_slots[i]);
+            test_check_obj(obj);
+        }
+
+        ebr_exit();
+    }
+
+    ebr_unregister_thread();
+    return NULL;
+}
+
+static void *
+test_writer(void *arg)
+{
+    unsigned int i, id, slot;
+    struct obj *obj, *old;
+
+    id = (uintptr_t)arg;
+
+    ebr_register_thread();
+
+    for (i = TEST_NR_SLOTS; i < TEST_NR_UPDATES; i++) {
+        obj = &test_objs[id][i];
+        test_init_obj(obj, obj - &test_objs[0][0]);
+        slot = (i % (TEST_NR_SLOTS / TEST_NR_WRITERS)) * TEST_NR_WRITERS + id;
+        old = __atomic_exchange_n(&test_slots[slot], obj, __ATOMIC_RELEASE);
+        ebr_retire(&old->ebr_node, test_invalidate);
+
+        if ((i % 256) == 0) {
+            sched_yield();
+        }
+    }
+
+    ebr_unregister_thread();
+    return NULL;
+}
+
+/*
+ * Readers check the objects referenced from shared slots while writers
+ * replace and retire them.
+ */
+static void
+test_concurrent(void)
+{
+    pthread_t readers[TEST_NR_READERS], writers[TEST_NR_WRITERS];
+    unsigned int i, nr_retired;
+    struct obj *obj;
+    int error;
+
+    printf("concurrent\n");
+
+    atomic_store(&test_done, false);
+    atomic_store(&test_nr_released, 0);
+
+    for (i = 0; i < ARRAY_SIZE(test_slots); i++) {
+        obj = &test_objs[i % TEST_NR_WRITERS][i];
+        test_init_obj(obj, obj - &test_objs[0][0]);
+        test_slots[i] = obj;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(readers); i++) {
+        error = pthread_create(&readers[i], NULL, test_reader, NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(writers); i++) {
+        error = pthread_create(&writers[i], NULL, test_writer,
+                               (void *)(uintptr_t)i);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(writers); i++) {
+        error = pthread_join(writers[i], NULL);
+        check(!error);
+    }
+
+    nr_retired = TEST_NR_WRITERS * (TEST_NR_UPDATES - TEST_NR_SLOTS);
+    check(atomic_load(&test_nr_released) == nr_retired);
+
+    atomic_store(&test_done, true);
+
+    for (i = 0; i < ARRAY_SIZE(readers); i++) {
+        error = pthread_join(readers[i], NULL);
+        check(!error);
+    }
+}
+
+static void *
+test_value(rdxtree_key_t key)
+{
+    return (void *)(uintptr_t)((key + 1) * 4);
+}
+
+static void *
+test_tree_reader(void *arg __unused)
+{
+    rdxtree_key_t key;
+    void *ptr;
+
+    ebr_register_thread();
+
+    while (!atomic_load(&test_done)) {
+        ebr_enter();
+
+        for (key = 0; key < TEST_NR_KEYS; key++) {
+            ptr = rdxtree_lookup(&test_tree, key);
+            check((ptr == NULL) || (ptr == test_value(key)));
+        }
+
+        ebr_exit();
+    }
+
+    ebr_unregister_thread();
+    return NULL;
+}
+
+/*
+ * Readers look up keys in a radix tree, while a writer repeatedly fills
+ * and empties it, so that nodes are constantly created and retired.
+ */
+static void
+test_rdxtree(void)
+{
+    pthread_t readers[TEST_NR_READERS];
+    unsigned int i, round;
+    rdxtree_key_t key;
+    void *ptr;
+    int error;
+
+    printf("rdxtree\n");
+
+    atomic_store(&test_done, false);
+    rdxtree_init(&test_tree, RDXTREE_EBR);
+    ebr_register_thread();
+
+    for (i = 0; i < ARRAY_SIZE(readers); i++) {
+        error = pthread_create(&readers[i], NULL, test_tree_reader, NULL);
+        check(!error);
+    }
+
+    for (round = 0; round < TEST_NR_ROUNDS; round++) {
+        for (key = 0; key < TEST_NR_KEYS; key++) {
+            error = rdxtree_insert(&test_tree, key * (round + 1),
+                                   test_value(key * (round + 1)));
+            check(!error);
+        }
+
+        for (key = 0; key < TEST_NR_KEYS; key++) {
+            ptr = rdxtree_remove(&test_tree, key * (round + 1));
+            check((ptr == NULL) || (ptr == test_value(key * (round + 1))));
+
+            if ((key % 256) == 0) {
+                sched_yield();
+            }
+        }
+    }
+
+    atomic_store(&test_done, true);
+
+    for (i = 0; i < ARRAY_SIZE(readers); i++) {
+        error = pthread_join(readers[i], NULL);
+        check(!error);
+    }
+
+    rdxtree_remove_all(&test_tree);
+    ebr_unregister_thread();
+}
+
+int
+main(void)
+{
+    test_blocking();
+    test_concurrent();
+    test_rdxtree();
+    return EXIT_SUCCESS;
+}
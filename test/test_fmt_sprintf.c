@@ -20,7 +20,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <errno.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,6 +44,35 @@ MACRO_BEGIN                                                         \
     check(strcmp(stra, strb) == 0);                                 \
 MACRO_END
 
+#define TEST_SPRINTF_PACKED(format, ...)                            \
+MACRO_BEGIN                                                         \
+    char stra[256], strb[256], args_buf[256];                       \
+    struct fmt_args args;                                           \
+    size_t size;                                                    \
+    int la, lb, error;                                              \
+                                                                    \
+    error = fmt_args_compile(&args, format);                        \
+    check(!error);                                                  \
+    size = sizeof(args_buf);                                        \
+    error = fmt_args_pack(&args, args_buf, &size, ## __VA_ARGS__);  \
+    check(!error);                                                  \
+    la = snprintf(stra, sizeof(stra), format, ## __VA_ARGS__);      \
+    lb = fmt_snprintf_packed(strb, sizeof(strb), format, args_buf); \
+    check(la == lb);                                                \
+    check(strcmp(stra, strb) == 0);                                 \
+MACRO_END
+
+#define TEST_SPRINTF_SPEC(format, ...)                                  \
+MACRO_BEGIN                                                             \
+    char stra[256], strb[256];                                          \
+    int la, lb;                                                         \
+                                                                        \
+    la = snprintf(stra, sizeof(stra), format, ## __VA_ARGS__);          \
+    lb = fmt_snprintf_spec(strb, sizeof(strb), format, ## __VA_ARGS__); \
+    check(la == lb);                                                    \
+    check(strcmp(stra, strb) == 0);                                     \
+MACRO_END
+
 static void
 test_1(void)
 {
@@ -518,6 +549,225 @@ test_58(void)
     check(la == lb);
 }
 
+static void
+test_59(void)
+{
+#define FORMAT "%d %hhu %ld %llx %zu %td %p %c"
+    TEST_SPRINTF_PACKED("%s: " FORMAT, FORMAT, -123, 300, -1L, 1ULL << 40,
+                        (size_t)-1, (ptrdiff_t)-2, (void *)0x1234, 'a');
+#undef FORMAT
+}
+
+static void
+test_60(void)
+{
+#define FORMAT "%*d|%-*.*s|%.*s|%s"
+    TEST_SPRINTF_PACKED("%s: " FORMAT, FORMAT, 8, 123, 10, 3, "abcdef",
+                        2, "xyz", "");
+#undef FORMAT
+}
+
+static void
+test_61(void)
+{
+    char args_buf[8];
+    struct fmt_args args;
+    size_t size;
+    int error;
+
+    error = fmt_args_compile(&args, "%d%n");
+    check(error == EINVAL);
+
+    error = fmt_args_compile(&args, "%d %s");
+    check(!error);
+    size = sizeof(args_buf);
+    error = fmt_args_pack(&args, args_buf, &size, 1, "too long");
+    check(error == EMSGSIZE);
+}
+
+static void
+test_62(void)
+{
+#define FORMAT "%d %i %u %x %X"
+    TEST_SPRINTF_SPEC("%s: " FORMAT, FORMAT, -123, 0, -1, 0xbeef, -2);
+#undef FORMAT
+}
+
+static void
+test_63(void)
+{
+#define FORMAT "%hhd %hu %ld %llu %llx %zu %td"
+    TEST_SPRINTF_SPEC("%s: " FORMAT, FORMAT, 300, -1, -1L, -1ULL,
+                      1ULL << 40, (size_t)-1, (ptrdiff_t)-2);
+#undef FORMAT
+}
+
+static void
+test_64(void)
+{
+    long long n;
+
+#define FORMAT "%s|%c|%%|%s|%lld"
+    n = -9223372036854775807LL - 1;
+    TEST_SPRINTF_SPEC("%s: " FORMAT, FORMAT, "abc", 'z', "", n);
+#undef FORMAT
+}
+
+static void
+test_65(void)
+{
+    char stra[256], strb[256];
+    int la, lb;
+
+    la = fmt_snprintf(stra, sizeof(stra), "%p %p", (void *)0x1234, NULL);
+    lb = fmt_snprintf_spec(strb, sizeof(strb), "%p %p", (void *)0x1234, NULL);
+    check(la == lb);
+    check(strcmp(stra, strb) == 0);
+
+    la = snprintf(stra, sizeof(stra), "no conversion");
+    lb = fmt_snprintf_spec(strb, sizeof(strb), "no conversion");
+    check(la == lb);
+    check(strcmp(stra, strb) == 0);
+}
+
+static void
+test_66(void)
+{
+    char stra[8], strb[8];
+    size_t size;
+    int la, lb;
+
+    for (size = 0; size <= sizeof(stra); size++) {
+        memset(stra, 'x', sizeof(stra));
+        memset(strb, 'x', sizeof(strb));
+        la = fmt_snprintf(stra, size, "ab%dcd%s", 1234, "efgh");
+        lb = fmt_snprintf_spec(strb, size, "ab%dcd%s", 1234, "efgh");
+        check(la == lb);
+        check(memcmp(stra, strb, sizeof(stra)) == 0);
+    }
+}
+
+static void
+test_67(void)
+{
+    const char *format;
+
+    /* Formats that can't be specialized */
+#define FORMAT "%5d|%-4s|%08x|%.2s"
+    TEST_SPRINTF_SPEC("%s: " FORMAT, FORMAT, 12, "ab", 0x1f, "xyz");
+#undef FORMAT
+
+    format = "%d %s";
+    TEST_SPRINTF_SPEC(format, 123, "abc");
+}
+
+#define TEST_SPRINTF_EXPECT(expected, format, ...)                  \
+MACRO_BEGIN                                                         \
+    char str[256];                                                  \
+    int length;                                                     \
+                                                                    \
+    length = fmt_snprintf(str, sizeof(str), format, ## __VA_ARGS__);\
+    check(length == (int)strlen(expected));                         \
+    check(strcmp(str, expected) == 0);                              \
+MACRO_END
+
+static void
+test_68(void)
+{
+    TEST_SPRINTF_EXPECT("{\"k\":\"a\\\"b\\\\c\\n\\u0001\\u001f end\"}",
+                        "{\"k\":\"%pJ\"}", "a\"b\\c\n\x01\x1f end");
+    TEST_SPRINTF_EXPECT("a clean string longer than a word, \xc3\xa9",
+                        "%pJ", "a clean string longer than a word, \xc3\xa9");
+    TEST_SPRINTF_EXPECT("ab\\\"c", "%.4pJ", "ab\"cdef");
+    TEST_SPRINTF_EXPECT("(null)", "%pJ", NULL);
+}
+
+static void
+test_69(void)
+{
+    TEST_SPRINTF_EXPECT("tab\\there\\177\\303\\251\\007?",
+                        "%pE", "tab\there\x7f\xc3\xa9\a?");
+    TEST_SPRINTF_EXPECT("0123456789abcdef\\r\\n", "%pE",
+                        "0123456789abcdef\r\n");
+}
+
+static void
+test_70(void)
+{
+    unsigned char bytes[20];
+    char expected[64];
+    size_t i;
+
+    TEST_SPRINTF_EXPECT("00 01 ab ff|", "%.4pH|", "\x00\x01\xab\xff");
+    TEST_SPRINTF_EXPECT("|", "%pH|", "ignored");
+
+    for (i = 0; i < ARRAY_SIZE(bytes); i++) {
+        bytes[i] = i * 13;
+        sprintf(&expected[i * 3], "%02x ", bytes[i]);
+    }
+
+    expected[(ARRAY_SIZE(bytes) * 3) - 1] = '\0';
+    TEST_SPRINTF_EXPECT(expected, "%.*pH", (int)ARRAY_SIZE(bytes), bytes);
+}
+
+static void
+test_71(void)
+{
+    char str[8], args_buf[64];
+    struct fmt_args args;
+    size_t size;
+    int length, error;
+
+    length = fmt_snprintf(str, sizeof(str), "%pJ", "\"\"\"\"");
+    check(length == 8);
+    check(strcmp(str, "\\\"\\\"\\\"\\") == 0);
+
+    length = fmt_snprintf_spec(str, sizeof(str), "%pE", "\n");
+    check(length == 2);
+    check(strcmp(str, "\\n") == 0);
+
+    error = fmt_args_compile(&args, "%.2pH");
+    check(error == EINVAL);
+
+    error = fmt_args_compile(&args, "%pJ");
+    check(!error);
+    size = sizeof(args_buf);
+    error = fmt_args_pack(&args, args_buf, &size, "a\"b");
+    check(!error);
+    length = fmt_snprintf_packed(str, sizeof(str), "%pJ", args_buf);
+    check(length == 4);
+    check(strcmp(str, "a\\\"b") == 0);
+}
+
+/*
+ * Strings with a precision need not be null-terminated.
+ */
+static const char test_unterminated_str[3] = { 'a', 'b', 'c' };
+
+static void
+test_72(void)
+{
+    TEST_SPRINTF_PACKED("%.3s|%.*s|%.5s", test_unterminated_str,
+                        2, test_unterminated_str, "de");
+}
+
+static void
+test_73(void)
+{
+    char args_buf[32];
+    struct fmt_args args;
+    size_t size;
+    int error;
+
+    error = fmt_args_compile(&args, "%.3s%.*s");
+    check(!error);
+    size = sizeof(args_buf);
+    error = fmt_args_pack(&args, args_buf, &size, test_unterminated_str,
+                          2, test_unterminated_str);
+    check(!error);
+    check(size == (sizeof("abc") + sizeof(int) + sizeof("ab")));
+}
+
 int
 main(void)
 {
@@ -579,6 +829,21 @@ main(void)
     test_56();
     test_57();
     test_58();
+    test_59();
+    test_60();
+    test_61();
+    test_62();
+    test_63();
+    test_64();
+    test_65();
+    test_66();
+    test_67();
+    test_68();
+    test_69();
+    test_70();
+    test_71();
+    test_72();
+    test_73();
 
     return EXIT_SUCCESS;
 }
@@ -20,6 +20,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -738,6 +740,200 @@ test_42(void)
 #undef STRING
 }
 
+static void
+test_43(void)
+{
+    struct fmt_scan scan;
+    int reta, retb, error;
+    int ia, ib;
+    int na, nb;
+    int ja, jb;
+
+#define STRING QUOTE(TEST_INT) ":abc:" QUOTE(TEST_INT_NEGATIVE)
+#define FORMAT "%d:abc:%n%d"
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    check(fmt_scan_nr_args(&scan) == 3);
+    reta = sscanf(STRING, FORMAT, &ia, &na, &ja);
+    retb = fmt_scan_sscanf(&scan, STRING, &ib, &nb, &jb);
+    check(reta == retb);
+    check(ia == ib);
+    check(na == nb);
+    check(ja == jb);
+#undef FORMAT
+#undef STRING
+}
+
+static void
+test_44(void)
+{
+    struct fmt_scan scan;
+    int reta, retb, error;
+    int ia, ib;
+    int ja, jb;
+
+#define STRING "  " QUOTE(TEST_INT) "  a%b " QUOTE(TEST_INT_HEX) " "
+#define FORMAT "    %d    a%%b%i   "
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    reta = sscanf(STRING, FORMAT, &ia, &ja);
+    retb = fmt_scan_sscanf(&scan, STRING, &ib, &jb);
+    check(reta == retb);
+    check(ia == ib);
+    check(ja == jb);
+#undef FORMAT
+#undef STRING
+}
+
+static void
+test_45(void)
+{
+    struct fmt_scan scan;
+    int reta, retb, error;
+    int ia, ib;
+
+#define STRING "az" QUOTE(TEST_INT) "c"
+#define FORMAT "ab%dc"
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    reta = sscanf(STRING, FORMAT, &ia);
+    retb = fmt_scan_sscanf(&scan, STRING, &ib);
+    check(reta == retb);
+#undef FORMAT
+#undef STRING
+
+    error = fmt_scan_compile(&scan, "%d%y");
+    check(error == EINVAL);
+}
+
+struct test_record {
+    unsigned int id;
+    char name[TEST_STR_SIZE];
+    long value;
+};
+
+static void
+test_46(void)
+{
+    static const size_t offsets[] = {
+        offsetof(struct test_record, id),
+        offsetof(struct test_record, name),
+        offsetof(struct test_record, value),
+    };
+
+    struct test_record records[4];
+    struct fmt_scan scan;
+    size_t size, nr_records;
+    int error;
+
+#define STRING "1 abc -12\n2 def 0x10\n3 ghi 77\n4 jk"
+#define FORMAT "%u %s %li"
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    check(fmt_scan_nr_args(&scan) == ARRAY_SIZE(offsets));
+    size = STRLEN(STRING);
+    nr_records = ARRAY_SIZE(records);
+    error = fmt_scan_lines(&scan, STRING, &size, records, sizeof(records[0]),
+                           &nr_records, offsets);
+    check(!error);
+    check(nr_records == 3);
+    check(size == (STRLEN(STRING) - STRLEN("4 jk")));
+    check(records[0].id == 1);
+    check(strcmp(records[0].name, "abc") == 0);
+    check(records[0].value == -12);
+    check(records[1].id == 2);
+    check(strcmp(records[1].name, "def") == 0);
+    check(records[1].value == 0x10);
+    check(records[2].id == 3);
+    check(strcmp(records[2].name, "ghi") == 0);
+    check(records[2].value == 77);
+#undef FORMAT
+#undef STRING
+}
+
+static void
+test_47(void)
+{
+    static const size_t offsets[] = {
+        offsetof(struct test_record, id),
+        offsetof(struct test_record, value),
+    };
+
+    struct test_record records[4];
+    struct fmt_scan scan;
+    size_t size, nr_records;
+    int error;
+
+#define STRING "id=1 value=2\nid=3 valeu=4\nid=5 value=6\n"
+#define FORMAT "id=%u value=%ld"
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    size = STRLEN(STRING);
+    nr_records = ARRAY_SIZE(records);
+    error = fmt_scan_lines(&scan, STRING, &size, records, sizeof(records[0]),
+                           &nr_records, offsets);
+    check(error == EINVAL);
+    check(nr_records == 1);
+    check(size == STRLEN("id=1 value=2\n"));
+    check(records[0].id == 1);
+    check(records[0].value == 2);
+#undef FORMAT
+#undef STRING
+}
+
+static void
+test_48(void)
+{
+    struct fmt_scan scan;
+    size_t size, nr_records;
+    char records[4];
+    int error;
+
+#define STRING "header\nheader \nheadr\nheader\n"
+#define FORMAT "header"
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    size = STRLEN(STRING);
+    nr_records = ARRAY_SIZE(records);
+    error = fmt_scan_lines(&scan, STRING, &size, records, sizeof(records[0]),
+                           &nr_records, NULL);
+    check(error == EINVAL);
+    check(nr_records == 2);
+    check(size == STRLEN("header\nheader \n"));
+#undef FORMAT
+#undef STRING
+}
+
+static void
+test_49(void)
+{
+    static const size_t offsets[] = {
+        offsetof(struct test_record, id),
+        offsetof(struct test_record, value),
+    };
+
+    struct test_record records[4];
+    struct fmt_scan scan;
+    size_t size, nr_records;
+    int error;
+
+#define STRING "1 2\n3 4 \n5 6 x\n7 8\n"
+#define FORMAT "%u %ld"
+    error = fmt_scan_compile(&scan, FORMAT);
+    check(!error);
+    size = STRLEN(STRING);
+    nr_records = ARRAY_SIZE(records);
+    error = fmt_scan_lines(&scan, STRING, &size, records, sizeof(records[0]),
+                           &nr_records, offsets);
+    check(error == EINVAL);
+    check(nr_records == 2);
+    check(size == STRLEN("1 2\n3 4 \n"));
+    check(records[1].id == 3);
+    check(records[1].value == 4);
+#undef FORMAT
+#undef STRING
+}
+
 int
 main(void)
 {
@@ -783,6 +979,13 @@ main(void)
     test_40();
     test_41();
     test_42();
+    test_43();
+    test_44();
+    test_45();
+    test_46();
+    test_47();
+    test_48();
+    test_49();
 
     return 0;
 }
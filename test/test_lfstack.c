@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <lfstack.h>
+#include <macros.h>
+#include <slist.h>
+
+#define TEST_NR_THREADS     8
+#define TEST_NR_OBJS        64
+#define TEST_NR_LOOPS       100000
+
+struct obj {
+    struct slist_node node;
+    atomic_int owned;
+};
+
+static struct lfstack test_stack;
+static struct obj test_objs[TEST_NR_OBJS];
+
+static struct obj *
+test_acquire(struct slist_node *node)
+{
+    struct obj *obj;
+
+    obj = slist_entry(node, struct obj, node);
+    check(atomic_exchange(&obj->owned, 1) == 0);
+    return obj;
+}
+
+static void
+test_release(struct obj *obj)
+{
+    check(atomic_exchange(&obj->owned, 0) == 1);
+    lfstack_push(&test_stack, &obj->node);
+}
+
+static void
+test_serial(void)
+{
+    struct slist_node *node;
+    struct slist list;
+    unsigned int i;
+
+    printf("serial\n");
+
+    lfstack_init(&test_stack);
+    check(lfstack_empty(&test_stack));
+    check(lfstack_pop(&test_stack) == NULL);
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        lfstack_push(&test_stack, &test_objs[i].node);
+    }
+
+    check(!lfstack_empty(&test_stack));
+    check(lfstack_pop(&test_stack) == &test_objs[TEST_NR_OBJS - 1].node);
+    check(lfstack_pop(&test_stack) == &test_objs[TEST_NR_OBJS - 2].node);
+
+    slist_init(&list);
+    lfstack_pop_all(&test_stack, &list);
+    check(lfstack_empty(&test_stack));
+    i = TEST_NR_OBJS - 2;
+
+    slist_for_each(&list, node) {
+        i--;
+        check(node == &test_objs[i].node);
+    }
+
+    check(i == 0);
+    check(slist_last(&list) == &test_objs[0].node);
+
+    lfstack_pop_all(&test_stack, &list);
+    check(slist_last(&list) == &test_objs[0].node);
+}
+
+static void *
+test_run(void *arg __unused)
+{
+    struct slist_node *node, *tmp;
+    struct obj *objs[4];
+    struct slist list;
+    unsigned int i, j, seed;
+
+    seed = (unsigned int)pthread_self();
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        if ((rand_r(&seed) % 64) == 0) {
+            slist_init(&list);
+            lfstack_pop_all(&test_stack, &list);
+
+            slist_for_each(&list, node) {
+                test_acquire(node);
+            }
+
+            slist_for_each_safe(&list, node, tmp) {
+                test_release(slist_entry(node, struct obj, node));
+            }
+
+            continue;
+        }
+
+        for (j = 0; j < ARRAY_SIZE(objs); j++) {
+            node = lfstack_pop(&test_stack);
+            objs[j] = (node == NULL) ? NULL : test_acquire(node);
+        }
+
+        for (j = 0; j < ARRAY_SIZE(objs); j++) {
+            if (objs[j] != NULL) {
+                test_release(objs[j]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_concurrent(void)
+{
+    pthread_t threads[TEST_NR_THREADS];
+    struct slist_node *node;
+    unsigned int i, nr_objs;
+    struct slist list;
+    int error;
+
+    printf("concurrent\n");
+
+    lfstack_init(&test_stack);
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        atomic_init(&test_objs[i].owned, 0);
+        lfstack_push(&test_stack, &test_objs[i].node);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_run, NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    slist_init(&list);
+    lfstack_pop_all(&test_stack, &list);
+    nr_objs = 0;
+
+    slist_for_each(&list, node) {
+        test_acquire(node);
+        nr_objs++;
+    }
+
+    check(nr_objs == TEST_NR_OBJS);
+}
+
+int
+main(void)
+{
+    test_serial();
+    test_concurrent();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <macros.h>
+#include <mpscq.h>
+#include <slist.h>
+
+#define TEST_NR_PRODUCERS   4
+#define TEST_NR_OBJS        200000
+
+struct obj {
+    struct slist_node node;
+    unsigned int producer;
+    unsigned int seq;
+};
+
+static struct mpscq test_queue;
+static struct obj test_objs[TEST_NR_PRODUCERS][TEST_NR_OBJS];
+
+static void
+test_serial(void)
+{
+    struct slist_node *node;
+    struct slist list;
+    unsigned int i;
+
+    printf("serial\n");
+
+    mpscq_init(&test_queue);
+    check(mpscq_empty(&test_queue));
+    check(mpscq_pop(&test_queue) == NULL);
+
+    for (i = 0; i < 10; i++) {
+        test_objs[0][i].seq = i;
+        mpscq_push(&test_queue, &test_objs[0][i].node);
+        check(!mpscq_empty(&test_queue));
+    }
+
+    for (i = 0; i < 5; i++) {
+        node = mpscq_pop(&test_queue);
+        check(node == &test_objs[0][i].node);
+    }
+
+    slist_init(&list);
+    mpscq_pop_all(&test_queue, &list);
+    check(mpscq_empty(&test_queue));
+    check(mpscq_pop(&test_queue) == NULL);
+
+    i = 5;
+
+    slist_for_each(&list, node) {
+        check(node == &test_objs[0][i].node);
+        i++;
+    }
+
+    check(i == 10);
+
+    mpscq_pop_all(&test_queue, &list);
+    check(slist_last(&list) == &test_objs[0][9].node);
+
+    mpscq_push(&test_queue, &test_objs[0][10].node);
+    check(mpscq_pop(&test_queue) == &test_objs[0][10].node);
+    check(mpscq_empty(&test_queue));
+}
+
+static void
+test_check_list(struct slist *list, unsigned int first, unsigned int last)
+{
+    struct slist_node *node;
+    unsigned int i;
+
+    i = first;
+
+    slist_for_each(list, node) {
+        check(node == &test_objs[0][i].node);
+        i++;
+    }
+
+    check(i == (last + 1));
+}
+
+/*
+ * Reproduce the state where mpscq_pop() pushes the stub back after a
+ * producer pushed a node following the head, leaving the stub in the
+ * middle of the queue, and optionally followed by other nodes.
+ */
+static void
+test_stub(unsigned int nr_trailing)
+{
+    struct slist list;
+    unsigned int i;
+
+    printf("stub, trailing nodes: %u\n", nr_trailing);
+
+    mpscq_init(&test_queue);
+    mpscq_push(&test_queue, &test_objs[0][0].node);
+    mpscq_push(&test_queue, &test_objs[0][1].node);
+    check(mpscq_pop(&test_queue) == &test_objs[0][0].node);
+    mpscq_push(&test_queue, &test_queue.stub);
+
+    for (i = 0; i < nr_trailing; i++) {
+        mpscq_push(&test_queue, &test_objs[0][2 + i].node);
+    }
+
+    slist_init(&list);
+    mpscq_pop_all(&test_queue, &list);
+    test_check_list(&list, 1, 1 + nr_trailing);
+    check(mpscq_empty(&test_queue));
+    check(mpscq_pop(&test_queue) == NULL);
+
+    mpscq_push(&test_queue, &test_objs[0][10].node);
+    check(mpscq_pop(&test_queue) == &test_objs[0][10].node);
+    check(mpscq_empty(&test_queue));
+}
+
+static void *
+test_producer(void *arg)
+{
+    unsigned int i, producer;
+
+    producer = (uintptr_t)arg;
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        test_objs[producer][i].producer = producer;
+        test_objs[producer][i].seq = i;
+        mpscq_push(&test_queue, &test_objs[producer][i].node);
+    }
+
+    return NULL;
+}
+
+static void
+test_consume(struct slist_node *node, unsigned int *next_seqs)
+{
+    struct obj *obj;
+
+    obj = slist_entry(node, struct obj, node);
+    check(obj->producer < TEST_NR_PRODUCERS);
+    check(obj->seq == next_seqs[obj->producer]);
+    next_seqs[obj->producer]++;
+}
+
+static void
+test_concurrent(void)
+{
+    unsigned int i, nr_objs, next_seqs[TEST_NR_PRODUCERS] = { 0 };
+    pthread_t threads[TEST_NR_PRODUCERS];
+    struct slist_node *node;
+    struct slist list;
+    int error;
+
+    printf("concurrent\n");
+
+    mpscq_init(&test_queue);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_producer,
+                               (void *)(uintptr_t)i);
+        check(!error);
+    }
+
+    nr_objs = 0;
+
+    while (nr_objs < (TEST_NR_PRODUCERS * TEST_NR_OBJS)) {
+        if ((rand() % 16) == 0) {
+            slist_init(&list);
+            mpscq_pop_all(&test_queue, &list);
+
+            slist_for_each(&list, node) {
+                test_consume(node, next_seqs);
+                nr_objs++;
+            }
+        } else {
+            node = mpscq_pop(&test_queue);
+
+            if (node != NULL) {
+                test_consume(node, next_seqs);
+                nr_objs++;
+            }
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+        check(next_seqs[i] == TEST_NR_OBJS);
+    }
+
+    check(mpscq_empty(&test_queue));
+}
+
+int
+main(void)
+{
+    test_serial();
+    test_stub(0);
+    test_stub(3);
+    test_concurrent();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <cpu.h>
+#include <macros.h>
+#include <numa.h>
+
+#define TEST_SIZE (4UL << 20)
+
+/*
+ * Memory policies may be unsupported by the kernel, or forbidden in
+ * containers.
+ */
+static void
+test_check_error(int error)
+{
+    check(!error || (error == ENOSYS) || (error == EPERM));
+}
+
+static void
+test_alloc(int policy)
+{
+    unsigned char *ptr;
+    size_t i;
+
+    printf("alloc, policy: %d\n", policy);
+
+    ptr = numa_alloc(TEST_SIZE, policy);
+    check(ptr != NULL);
+    check(P2ALIGNED((uintptr_t)ptr, (uintptr_t)sysconf(_SC_PAGESIZE)));
+
+    for (i = 0; i < TEST_SIZE; i++) {
+        check(ptr[i] == 0);
+    }
+
+    memset(ptr, 0xaa, TEST_SIZE);
+    numa_free(ptr, TEST_SIZE);
+}
+
+static void
+test_nodes(void)
+{
+    unsigned int node;
+    unsigned char *ptr;
+    int error;
+
+    printf("nodes: %u\n", cpu_nr_nodes());
+
+    check(numa_local_node() < cpu_nr_nodes());
+
+    for (node = 0; node < cpu_nr_nodes(); node++) {
+        ptr = numa_alloc_node(TEST_SIZE, node);
+        check(ptr != NULL);
+        memset(ptr, 0x55, TEST_SIZE);
+        numa_free(ptr, TEST_SIZE);
+    }
+
+    ptr = numa_alloc(TEST_SIZE, NUMA_POLICY_DEFAULT);
+    check(ptr != NULL);
+    error = numa_bind(ptr, TEST_SIZE, NUMA_POLICY_INTERLEAVE);
+    test_check_error(error);
+    error = numa_bind_node(ptr, TEST_SIZE, numa_local_node());
+    test_check_error(error);
+    error = numa_bind(ptr, TEST_SIZE, NUMA_POLICY_DEFAULT);
+    test_check_error(error);
+    memset(ptr, 0x55, TEST_SIZE);
+    numa_free(ptr, TEST_SIZE);
+}
+
+static void
+test_thread_policy(void)
+{
+    void *ptr;
+    int error;
+
+    printf("thread policy\n");
+
+    error = numa_set_thread_policy(NUMA_POLICY_INTERLEAVE);
+    test_check_error(error);
+    ptr = malloc(TEST_SIZE);
+    check(ptr != NULL);
+    memset(ptr, 0, TEST_SIZE);
+    free(ptr);
+
+    error = numa_set_thread_policy(NUMA_POLICY_LOCAL);
+    test_check_error(error);
+    error = numa_set_thread_policy(NUMA_POLICY_DEFAULT);
+    test_check_error(error);
+}
+
+int
+main(void)
+{
+    test_alloc(NUMA_POLICY_DEFAULT);
+    test_alloc(NUMA_POLICY_LOCAL);
+    test_alloc(NUMA_POLICY_INTERLEAVE);
+    test_nodes();
+    test_thread_policy();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <cpu.h>
+#include <macros.h>
+#include <percpu.h>
+#include <slist.h>
+
+#define TEST_NR_THREADS     8
+#define TEST_NR_LOOPS       1000000
+#define TEST_NR_OBJS        64
+
+struct obj {
+    struct slist_node node;
+    atomic_int owned;
+};
+
+struct test_stats {
+    unsigned long nr_calls;
+};
+
+static PERCPU_DEFINE(struct test_stats, test_stats);
+static struct percpu_counter test_counter;
+static struct percpu_freelist test_freelist;
+static struct obj test_objs[TEST_NR_OBJS];
+
+static void
+test_layout(void)
+{
+    uintptr_t prev, addr;
+    unsigned int cpu;
+
+    printf("layout\n");
+
+    prev = 0;
+
+    percpu_for_each_cpu(cpu) {
+        addr = (uintptr_t)percpu_ptr(test_stats, cpu);
+        check(P2ALIGNED(addr, CPU_L1_SIZE));
+
+        if (cpu != 0) {
+            check((addr - prev) >= CPU_L1_SIZE);
+        }
+
+        check(percpu_ptr(test_stats, cpu)->nr_calls == 0);
+        prev = addr;
+    }
+
+    percpu_local_ptr(test_stats)->nr_calls++;
+    check(percpu_ptr(test_stats, cpu_id())->nr_calls <= 1);
+}
+
+static void
+test_area(void)
+{
+    struct percpu_area area;
+    struct test_stats *stats;
+    unsigned int cpu;
+    uintptr_t addr;
+    int error;
+
+    printf("area\n");
+
+    error = percpu_area_init(&area, sizeof(struct test_stats));
+    check(!error);
+    check(percpu_area_nr_cpus(&area) == cpu_count());
+    check(percpu_area_local_cpu(&area) < percpu_area_nr_cpus(&area));
+
+    for (cpu = 0; cpu < percpu_area_nr_cpus(&area); cpu++) {
+        addr = (uintptr_t)percpu_area_ptr(&area, cpu);
+        check(P2ALIGNED(addr, cpu_l1_size()));
+        stats = percpu_area_ptr(&area, cpu);
+        check(stats->nr_calls == 0);
+    }
+
+    stats = percpu_area_local_ptr(&area);
+    stats->nr_calls++;
+    percpu_area_destroy(&area);
+}
+
+static void *
+test_run(void *arg __unused)
+{
+    unsigned long i;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        if ((i % 2) == 0) {
+            percpu_counter_inc(&test_counter);
+        } else {
+            percpu_counter_add(&test_counter, 2);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_counters(void)
+{
+    pthread_t threads[TEST_NR_THREADS];
+    struct percpu_counter counter;
+    unsigned int i;
+    int error;
+
+    printf("counters\n");
+
+    error = percpu_counter_init(&counter);
+    check(!error);
+    check(percpu_counter_read(&counter) == 0);
+    percpu_counter_add(&counter, 10);
+    percpu_counter_inc(&counter);
+    check(percpu_counter_read(&counter) == 11);
+    percpu_counter_destroy(&counter);
+
+    error = percpu_counter_init(&test_counter);
+    check(!error);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_run, NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    check(percpu_counter_read(&test_counter)
+          == (TEST_NR_THREADS * (TEST_NR_LOOPS / 2) * 3));
+    percpu_counter_destroy(&test_counter);
+}
+
+static void *
+test_run_freelist(void *arg __unused)
+{
+    struct slist_node *node;
+    struct obj *objs[4];
+    unsigned long i;
+    unsigned int j;
+
+    for (i = 0; i < (TEST_NR_LOOPS / 10); i++) {
+        for (j = 0; j < ARRAY_SIZE(objs); j++) {
+            node = percpu_freelist_pop(&test_freelist);
+
+            if (node == NULL) {
+                objs[j] = NULL;
+                continue;
+            }
+
+            objs[j] = slist_entry(node, struct obj, node);
+            check(atomic_exchange(&objs[j]->owned, 1) == 0);
+        }
+
+        for (j = 0; j < ARRAY_SIZE(objs); j++) {
+            if (objs[j] != NULL) {
+                check(atomic_exchange(&objs[j]->owned, 0) == 1);
+                percpu_freelist_push(&test_freelist, &objs[j]->node);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_freelists(void)
+{
+    pthread_t threads[TEST_NR_THREADS];
+    struct slist_node *node;
+    unsigned int i, nr_objs;
+    int error;
+
+    printf("freelists\n");
+
+    error = percpu_freelist_init(&test_freelist);
+    check(!error);
+    check(percpu_freelist_pop(&test_freelist) == NULL);
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        atomic_init(&test_objs[i].owned, 0);
+        percpu_freelist_push(&test_freelist, &test_objs[i].node);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_run_freelist, NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    /*
+     * Nodes may have been pushed on the list of any processor, so only
+     * check those that can be popped from the current one.
+     */
+    nr_objs = 0;
+
+    while ((node = percpu_freelist_pop(&test_freelist)) != NULL) {
+        check(atomic_load(&slist_entry(node, struct obj, node)->owned) == 0);
+        nr_objs++;
+    }
+
+    check(nr_objs <= TEST_NR_OBJS);
+    percpu_freelist_destroy(&test_freelist);
+}
+
+int
+main(void)
+{
+    test_layout();
+    test_area();
+    test_counters();
+    test_freelists();
+    return EXIT_SUCCESS;
+}
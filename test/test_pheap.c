@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <macros.h>
+#include <pheap.h>
+
+#define TEST_NR_OBJS    1024
+#define TEST_NR_LOOPS   100000
+#define TEST_MAX_KEY    10000
+
+struct obj {
+    struct pheap_node node;
+    unsigned int key;
+    int linked;
+};
+
+static struct obj test_objs[TEST_NR_OBJS];
+
+static int
+test_obj_cmp(const struct pheap_node *a, const struct pheap_node *b)
+{
+    unsigned int ka, kb;
+
+    ka = pheap_entry(a, struct obj, node)->key;
+    kb = pheap_entry(b, struct obj, node)->key;
+    return (ka < kb) ? -1 : ((ka > kb) ? 1 : 0);
+}
+
+/*
+ * Return the smallest key of all linked objects, or -1 if there is none.
+ */
+static int
+test_min_key(void)
+{
+    int min_key;
+    size_t i;
+
+    min_key = -1;
+
+    for (i = 0; i < ARRAY_SIZE(test_objs); i++) {
+        if (test_objs[i].linked
+            && ((min_key == -1) || ((int)test_objs[i].key < min_key))) {
+            min_key = test_objs[i].key;
+        }
+    }
+
+    return min_key;
+}
+
+static void
+test_check_first(const struct pheap *heap)
+{
+    struct pheap_node *node;
+    int min_key;
+
+    node = pheap_first(heap);
+    min_key = test_min_key();
+
+    if (min_key == -1) {
+        check(node == NULL);
+        check(pheap_empty(heap));
+    } else {
+        check(node != NULL);
+        check((int)pheap_entry(node, struct obj, node)->key == min_key);
+    }
+}
+
+int
+main(void)
+{
+    struct pheap_node *node;
+    unsigned int i, prev_key;
+    struct pheap heap;
+    struct obj *obj;
+
+    pheap_init(&heap, test_obj_cmp);
+    check(pheap_remove_first(&heap) == NULL);
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        obj = &test_objs[rand() % ARRAY_SIZE(test_objs)];
+
+        if (!obj->linked) {
+            obj->key = rand() % TEST_MAX_KEY;
+            pheap_node_init(&obj->node);
+            pheap_insert(&heap, &obj->node);
+            obj->linked = 1;
+        } else {
+            switch (rand() % 3) {
+            case 0:
+                pheap_remove(&heap, &obj->node);
+                obj->linked = 0;
+                break;
+            case 1:
+                if (obj->key != 0) {
+                    obj->key = rand() % obj->key;
+                    pheap_decrease(&heap, &obj->node);
+                }
+
+                break;
+            default:
+                node = pheap_remove_first(&heap);
+                pheap_entry(node, struct obj, node)->linked = 0;
+                break;
+            }
+        }
+
+        if ((i % 100) == 0) {
+            test_check_first(&heap);
+        }
+    }
+
+    prev_key = 0;
+
+    while (!pheap_empty(&heap)) {
+        test_check_first(&heap);
+        node = pheap_remove_first(&heap);
+        obj = pheap_entry(node, struct obj, node);
+        check(prev_key <= obj->key);
+        prev_key = obj->key;
+        obj->linked = 0;
+    }
+
+    check(test_min_key() == -1);
+
+    return EXIT_SUCCESS;
+}
@@ -25,6 +25,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <check.h>
+#include <list.h>
 #include <macros.h>
 #include <plist.h>
 
@@ -78,12 +80,111 @@ print_list(const struct plist *list)
     }
 }
 
+/*
+ * Check that the entries of the given priority list are the given objects,
+ * in order, and that there is exactly one entry on the internal list of
+ * priorities for each priority, referring to the first object of that
+ * priority.
+ */
+static void
+check_list(const struct plist *list, struct obj **objs, size_t nr_objs)
+{
+    struct plist_node *pnode;
+    size_t i, nr_prios;
+
+    i = 0;
+    nr_prios = 0;
+
+    plist_for_each(list, pnode) {
+        check(i < nr_objs);
+        check(pnode == &objs[i]->node);
+
+        if ((i == 0) || (objs[i - 1]->priority != objs[i]->priority)) {
+            check(!list_node_unlinked(&pnode->prio_node));
+            nr_prios++;
+        } else {
+            check(list_node_unlinked(&pnode->prio_node));
+        }
+
+        i++;
+    }
+
+    check(i == nr_objs);
+
+    i = 0;
+
+    list_for_each_entry(&list->prio_list, pnode, prio_node) {
+        check(i < nr_prios);
+
+        if (i != 0) {
+            check(list_prev_entry(pnode, prio_node)->priority
+                  < pnode->priority);
+        }
+
+        i++;
+    }
+
+    check(i == nr_prios);
+}
+
+static void
+test_equal_priorities(void)
+{
+    struct obj objs[6], *expected[ARRAY_SIZE(objs)];
+    struct plist list;
+    size_t i;
+
+    plist_init(&list);
+
+    for (i = 0; i < ARRAY_SIZE(objs); i++) {
+        objs[i].priority = (i < 4) ? 2 : ((i == 4) ? 1 : 3);
+        plist_node_init(&objs[i].node, objs[i].priority);
+        plist_add(&list, &objs[i].node);
+    }
+
+    expected[0] = &objs[4];
+    expected[1] = &objs[0];
+    expected[2] = &objs[1];
+    expected[3] = &objs[2];
+    expected[4] = &objs[3];
+    expected[5] = &objs[5];
+    check_list(&list, expected, 6);
+
+    /* Remove the first node of a priority, then one in the middle */
+    plist_remove(&list, &objs[0].node);
+    expected[1] = &objs[1];
+    expected[2] = &objs[2];
+    expected[3] = &objs[3];
+    expected[4] = &objs[5];
+    check_list(&list, expected, 5);
+
+    plist_remove(&list, &objs[2].node);
+    expected[2] = &objs[3];
+    expected[3] = &objs[5];
+    check_list(&list, expected, 4);
+
+    plist_add(&list, &objs[0].node);
+    expected[3] = &objs[0];
+    expected[4] = &objs[5];
+    check_list(&list, expected, 5);
+
+    /* Empty the list front to back */
+    for (i = 0; i < 5; i++) {
+        plist_remove(&list, &expected[i]->node);
+        check_list(&list, &expected[i + 1], 5 - (i + 1));
+    }
+
+    check(plist_empty(&list));
+}
+
 int
 main(void)
 {
     struct obj *obj, *tmp;
     unsigned int prev_priority __attribute__((unused));
 
+    test_equal_priorities();
+
     add_obj(&obj_list, 1);
     add_obj(&obj_list, 3);
     obj = plist_first_entry(&obj_list, struct obj, node);
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <list.h>
+#include <macros.h>
+#include <rcu.h>
+
+#define TEST_NR_READERS     4
+#define TEST_NR_UPDATES     20000
+#define TEST_LIST_SIZE      64
+
+struct obj {
+    struct list node;
+    struct rcu_head rcu_head;
+    unsigned long value;
+    atomic_bool valid;
+};
+
+static struct obj test_objs[TEST_NR_UPDATES];
+static struct obj *test_ptr;
+static struct list test_list;
+static atomic_bool test_done;
+static atomic_uint test_nr_deferred;
+
+static void
+test_check_obj(struct obj *obj)
+{
+    check(atomic_load_explicit(&obj->valid, memory_order_relaxed));
+    check(obj->value == (unsigned long)(obj - test_objs));
+}
+
+static void *
+test_reader(void *arg __unused)
+{
+    unsigned long nr_reads;
+    struct obj *obj;
+
+    rcu_register_thread();
+    nr_reads = 0;
+
+    while (!atomic_load(&test_done)) {
+        rcu_read_lock();
+
+        obj = rcu_load_ptr(test_ptr);
+        test_check_obj(obj);
+
+        list_rcu_for_each_entry(&test_list, obj, node) {
+            test_check_obj(obj);
+        }
+
+        rcu_read_unlock();
+
+        nr_reads++;
+
+        if ((nr_reads % 256) == 0) {
+            rcu_thread_offline();
+            rcu_thread_online();
+        } else {
+            rcu_quiescent_state();
+        }
+    }
+
+    rcu_unregister_thread();
+    return NULL;
+}
+
+static void
+test_invalidate(struct rcu_head *head)
+{
+    struct obj *obj;
+
+    obj = structof(head, struct obj, rcu_head);
+    atomic_store_explicit(&obj->valid, false, memory_order_relaxed);
+    atomic_fetch_add(&test_nr_deferred, 1);
+}
+
+static void
+test_init_obj(unsigned int i)
+{
+    test_objs[i].value = i;
+    atomic_init(&test_objs[i].valid, true);
+}
+
+int
+main(void)
+{
+    pthread_t threads[TEST_NR_READERS];
+    unsigned int i, nr_deferred;
+    struct obj *old, *first;
+    int error;
+
+    list_init(&test_list);
+    test_init_obj(0);
+    test_ptr = &test_objs[0];
+    atomic_init(&test_done, false);
+    atomic_init(&test_nr_deferred, 0);
+
+    error = rcu_start();
+    check(!error);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_reader, NULL);
+        check(!error);
+    }
+
+    nr_deferred = 0;
+
+    for (i = 1; i < TEST_NR_UPDATES; i++) {
+        test_init_obj(i);
+
+        if ((i % 2) == 0) {
+            old = test_ptr;
+            rcu_store_ptr(test_ptr, &test_objs[i]);
+        } else {
+            list_rcu_insert_tail(&test_list, &test_objs[i].node);
+
+            if (i < TEST_LIST_SIZE) {
+                continue;
+            }
+
+            first = list_first_entry(&test_list, struct obj, node);
+            list_rcu_remove(&first->node);
+            old = first;
+        }
+
+        if ((i % 256) == 0) {
+            rcu_synchronize();
+            test_invalidate(&old->rcu_head);
+        } else {
+            rcu_defer(&old->rcu_head, test_invalidate);
+        }
+
+        nr_deferred++;
+    }
+
+    rcu_barrier();
+    check(atomic_load(&test_nr_deferred) == nr_deferred);
+
+    atomic_store(&test_done, true);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    /*
+     * Stopping the worker processes pending deferred functions.
+     */
+    rcu_defer(&test_ptr->rcu_head, test_invalidate);
+    rcu_stop();
+    check(atomic_load(&test_nr_deferred) == (nr_deferred + 1));
+
+    return EXIT_SUCCESS;
+}
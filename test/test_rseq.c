@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <macros.h>
+#include <rseq.h>
+
+#define TEST_NR_THREADS     8
+#define TEST_NR_LOOPS       1000000
+#define TEST_NR_CPUS        1024
+
+struct test_slot {
+    intptr_t value;
+} __attribute__((aligned(64)));
+
+static struct test_slot test_slots[TEST_NR_CPUS];
+
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+
+static void *
+test_run(void *arg __unused)
+{
+    unsigned long i;
+    int cpu, error;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        do {
+            cpu = rseq_cpu_id();
+            check((cpu >= 0) && (cpu < TEST_NR_CPUS));
+            error = rseq_addv(&test_slots[cpu].value, 1, cpu);
+        } while (error);
+    }
+
+    return NULL;
+}
+
+static void
+test_addv(void)
+{
+    pthread_t threads[TEST_NR_THREADS];
+    unsigned int i;
+    intptr_t sum;
+    int error;
+
+    printf("addv\n");
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_run, NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    sum = 0;
+
+    for (i = 0; i < ARRAY_SIZE(test_slots); i++) {
+        sum += test_slots[i].value;
+    }
+
+    check(sum == (TEST_NR_THREADS * TEST_NR_LOOPS));
+}
+
+static void
+test_list(void)
+{
+    intptr_t head, node, nodes[3];
+    int cpu, error;
+
+    printf("list\n");
+
+    nodes[0] = 0;
+    nodes[1] = (intptr_t)&nodes[0];
+    nodes[2] = (intptr_t)&nodes[1];
+    head = 0;
+
+    do {
+        cpu = rseq_cpu_id();
+        error = rseq_cmpeqv_storev(&head, 0, (intptr_t)&nodes[2], cpu);
+    } while (error == -1);
+
+    check(error == 0);
+    check(head == (intptr_t)&nodes[2]);
+
+    do {
+        cpu = rseq_cpu_id();
+        error = rseq_cmpeqv_storev(&head, 0, (intptr_t)&nodes[1], cpu);
+    } while (error == -1);
+
+    check(error == 1);
+    check(head == (intptr_t)&nodes[2]);
+
+    for (int i = 2; i >= 0; i--) {
+        do {
+            cpu = rseq_cpu_id();
+            error = rseq_list_pop(&head, &node, cpu);
+        } while (error == -1);
+
+        check(error == 0);
+        check(node == (intptr_t)&nodes[i]);
+    }
+
+    do {
+        cpu = rseq_cpu_id();
+        error = rseq_list_pop(&head, &node, cpu);
+    } while (error == -1);
+
+    check(error == 1);
+}
+
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+
+/*
+ * Compare the processor ID with the one reported by the C library.
+ *
+ * The thread may migrate between the two calls, in which case the
+ * comparison is retried.
+ */
+static void
+test_cpu_id(void)
+{
+    int cpu, libc_cpu;
+
+    for (;;) {
+        cpu = rseq_cpu_id();
+        libc_cpu = sched_getcpu();
+
+        if (cpu == rseq_cpu_id()) {
+            break;
+        }
+    }
+
+    check(cpu == libc_cpu);
+}
+
+int
+main(void)
+{
+    int cpu;
+
+    cpu = rseq_cpu_id();
+    printf("cpu: %d\n", cpu);
+
+    if (cpu == -1) {
+        printf("restartable sequences not available\n");
+        return EXIT_SUCCESS;
+    }
+
+    test_cpu_id();
+
+#ifdef RSEQ_HAVE_CRITICAL_SECTIONS
+    test_addv();
+    test_list();
+#endif /* RSEQ_HAVE_CRITICAL_SECTIONS */
+
+    return EXIT_SUCCESS;
+}
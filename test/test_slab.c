@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <check.h>
+#include <macros.h>
+#include <slab.h>
+
+#define TEST_NR_OBJS        10000
+#define TEST_NR_THREADS     8
+#define TEST_NR_LOOPS       1000
+#define TEST_BATCH_SIZE     256
+
+struct obj {
+    unsigned long id;
+    char data[40];
+};
+
+static struct slab_cache test_obj_cache;
+
+static void
+test_fill(void *obj, size_t size, unsigned long id)
+{
+    memset(obj, (unsigned char)id, size);
+}
+
+static void
+test_check_fill(const void *obj, size_t size, unsigned long id)
+{
+    const unsigned char *bytes;
+    size_t i;
+
+    bytes = obj;
+
+    for (i = 0; i < size; i++) {
+        check(bytes[i] == (unsigned char)id);
+    }
+}
+
+static void
+test_sizes(size_t obj_size, size_t align)
+{
+    struct slab_cache_stats stats;
+    struct slab_cache cache;
+    void **objs;
+    unsigned int i;
+    int error;
+
+    printf("size: %zu align: %zu\n", obj_size, align);
+
+    error = slab_cache_init(&cache, "test_sizes", obj_size, align);
+    check(!error);
+
+    objs = malloc(TEST_NR_OBJS * sizeof(*objs));
+    check(objs != NULL);
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        objs[i] = slab_cache_alloc(&cache);
+        check(objs[i] != NULL);
+
+        if (align != 0) {
+            check(P2ALIGNED((uintptr_t)objs[i], align));
+        }
+
+        test_fill(objs[i], obj_size, i);
+    }
+
+    slab_cache_stats(&cache, &stats);
+    check(stats.obj_size == obj_size);
+    check(stats.buf_size >= obj_size);
+    check(stats.bufs_per_slab != 0);
+    check(stats.nr_objs == TEST_NR_OBJS);
+    check(stats.nr_allocs == TEST_NR_OBJS);
+    check(stats.nr_bufs >= (stats.nr_objs + stats.nr_cached_objs));
+    check(stats.nr_bufs == (stats.nr_slabs * stats.bufs_per_slab));
+
+    for (i = 0; i < TEST_NR_OBJS; i++) {
+        test_check_fill(objs[i], obj_size, i);
+        slab_cache_free(&cache, objs[i]);
+    }
+
+    slab_cache_stats(&cache, &stats);
+    check(stats.nr_objs == 0);
+    check(stats.nr_frees == TEST_NR_OBJS);
+    check(stats.nr_slabs <= (stats.nr_free_slabs * 2));
+
+    slab_cache_reap(&cache);
+    slab_cache_stats(&cache, &stats);
+    check(stats.nr_cached_objs == 0);
+    check(stats.nr_slabs == 0);
+    check(stats.nr_bufs == 0);
+
+    free(objs);
+    slab_cache_destroy(&cache);
+}
+
+static void
+test_coloring(void)
+{
+    struct slab_cache_stats stats;
+    struct slab_cache cache;
+    uintptr_t offsets[2], delta;
+    unsigned int i, nr_objs;
+    void *objs[64];
+    int error;
+
+    printf("coloring\n");
+
+    /* Waste enough memory per slab to allow several colors */
+    error = slab_cache_init(&cache, "test_coloring", 1000, 8);
+    check(!error);
+    slab_cache_stats(&cache, &stats);
+
+    objs[0] = slab_cache_alloc(&cache);
+    check(objs[0] != NULL);
+    offsets[0] = (uintptr_t)objs[0] & (stats.slab_size - 1);
+
+    /* Allocate until another slab is created */
+    for (nr_objs = 1; nr_objs < ARRAY_SIZE(objs); nr_objs++) {
+        objs[nr_objs] = slab_cache_alloc(&cache);
+        check(objs[nr_objs] != NULL);
+
+        if (((uintptr_t)objs[nr_objs] & -stats.slab_size)
+            != ((uintptr_t)objs[0] & -stats.slab_size)) {
+            break;
+        }
+    }
+
+    check(nr_objs < ARRAY_SIZE(objs));
+    offsets[1] = (uintptr_t)objs[nr_objs] & (stats.slab_size - 1);
+    nr_objs++;
+
+    /* Buffers of different slabs don't start at the same offsets */
+    delta = (offsets[1] > offsets[0])
+            ? offsets[1] - offsets[0]
+            : offsets[0] - offsets[1];
+    delta %= stats.buf_size;
+    check(delta != 0);
+
+    for (i = 0; i < nr_objs; i++) {
+        slab_cache_free(&cache, objs[i]);
+    }
+
+    slab_cache_destroy(&cache);
+}
+
+static void *
+test_run(void *arg)
+{
+    struct obj *objs[TEST_BATCH_SIZE];
+    unsigned long base;
+    unsigned int i, j;
+
+    base = (uintptr_t)arg * TEST_BATCH_SIZE;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        for (j = 0; j < ARRAY_SIZE(objs); j++) {
+            objs[j] = slab_cache_alloc(&test_obj_cache);
+            check(objs[j] != NULL);
+            objs[j]->id = base + j;
+            test_fill(objs[j]->data, sizeof(objs[j]->data), base + j);
+        }
+
+        for (j = 0; j < ARRAY_SIZE(objs); j++) {
+            check(objs[j]->id == (base + j));
+            test_check_fill(objs[j]->data, sizeof(objs[j]->data), base + j);
+            slab_cache_free(&test_obj_cache, objs[j]);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_concurrent(void)
+{
+    pthread_t threads[TEST_NR_THREADS];
+    struct slab_cache_stats stats;
+    unsigned int i;
+    int error;
+
+    printf("concurrent\n");
+
+    error = slab_cache_init(&test_obj_cache, "obj", sizeof(struct obj), 0);
+    check(!error);
+    check(strcmp(slab_cache_name(&test_obj_cache), "obj") == 0);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_run,
+                               (void *)(uintptr_t)i);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    slab_cache_stats(&test_obj_cache, &stats);
+    check(stats.nr_objs == 0);
+    check(stats.nr_allocs == (TEST_NR_THREADS * TEST_NR_LOOPS
+                              * TEST_BATCH_SIZE));
+    check(stats.nr_allocs == stats.nr_frees);
+    printf("slabs: %lu, magazine misses: %lu\n",
+           stats.nr_slabs, stats.nr_magazine_misses);
+
+    slab_cache_destroy(&test_obj_cache);
+}
+
+int
+main(void)
+{
+    test_sizes(1, 0);
+    test_sizes(24, 8);
+    test_sizes(64, 64);
+    test_sizes(200, 0);
+    test_sizes(3000, 16);
+    test_sizes(5000, 4096);
+    test_sizes(100000, 0);
+    test_coloring();
+    test_concurrent();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <macros.h>
+#include <seqlock.h>
+#include <spinlock.h>
+
+#define TEST_NR_THREADS     4
+#define TEST_NR_LOOPS       100000
+
+static struct spinlock test_spinlock = SPINLOCK_INITIALIZER;
+static struct ticketlock test_ticketlock = TICKETLOCK_INITIALIZER;
+static struct mcslock test_mcslock = MCSLOCK_INITIALIZER;
+static struct seqlock test_seqlock = SEQLOCK_INITIALIZER;
+
+/*
+ * Protected data, deliberately updated with non-atomic operations.
+ */
+static unsigned long test_counter;
+static unsigned long test_x;
+static unsigned long test_y;
+
+static atomic_bool test_writer_done;
+
+static void *
+test_run_spinlock(void *arg __unused)
+{
+    unsigned long i;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        spinlock_lock(&test_spinlock);
+        test_counter++;
+        spinlock_unlock(&test_spinlock);
+    }
+
+    return NULL;
+}
+
+static void *
+test_run_ticketlock(void *arg __unused)
+{
+    unsigned long i;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        ticketlock_lock(&test_ticketlock);
+        test_counter++;
+        ticketlock_unlock(&test_ticketlock);
+    }
+
+    return NULL;
+}
+
+static void *
+test_run_mcslock(void *arg __unused)
+{
+    struct mcslock_qnode qnode;
+    unsigned long i;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        mcslock_lock(&test_mcslock, &qnode);
+        test_counter++;
+        mcslock_unlock(&test_mcslock, &qnode);
+    }
+
+    return NULL;
+}
+
+static void
+test_threads(const char *name, void *(*fn)(void *))
+{
+    pthread_t threads[TEST_NR_THREADS];
+    unsigned int i;
+    int error;
+
+    printf("%s\n", name);
+
+    test_counter = 0;
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, fn, NULL);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    check(test_counter == (TEST_NR_THREADS * TEST_NR_LOOPS));
+}
+
+static void
+test_trylock(void)
+{
+    struct mcslock_qnode qnodes[2];
+    struct spinlock_stats stats;
+    int error;
+
+    printf("trylock\n");
+
+    spinlock_init(&test_spinlock);
+    error = spinlock_trylock(&test_spinlock);
+    check(!error);
+    error = spinlock_trylock(&test_spinlock);
+    check(error == EBUSY);
+    spinlock_unlock(&test_spinlock);
+    spinlock_get_stats(&test_spinlock, &stats);
+#ifdef CONFIG_LOCK_STATS
+    check(stats.nr_acquires == 1);
+#else /* CONFIG_LOCK_STATS */
+    check(stats.nr_acquires == 0);
+#endif /* CONFIG_LOCK_STATS */
+    check(stats.nr_contended == 0);
+
+    ticketlock_init(&test_ticketlock);
+    error = ticketlock_trylock(&test_ticketlock);
+    check(!error);
+    error = ticketlock_trylock(&test_ticketlock);
+    check(error == EBUSY);
+    ticketlock_unlock(&test_ticketlock);
+    error = ticketlock_trylock(&test_ticketlock);
+    check(!error);
+    ticketlock_unlock(&test_ticketlock);
+
+    mcslock_init(&test_mcslock);
+    error = mcslock_trylock(&test_mcslock, &qnodes[0]);
+    check(!error);
+    error = mcslock_trylock(&test_mcslock, &qnodes[1]);
+    check(error == EBUSY);
+    mcslock_unlock(&test_mcslock, &qnodes[0]);
+    error = mcslock_trylock(&test_mcslock, &qnodes[1]);
+    check(!error);
+    mcslock_unlock(&test_mcslock, &qnodes[1]);
+}
+
+static void *
+test_run_seqlock_reader(void *arg __unused)
+{
+    unsigned long x, y, nr_reads;
+    unsigned int seq;
+
+    nr_reads = 0;
+
+    while (!atomic_load(&test_writer_done)) {
+        do {
+            seq = seqlock_read_begin(&test_seqlock);
+            x = READ_ONCE(test_x);
+            y = READ_ONCE(test_y);
+        } while (seqlock_read_retry(&test_seqlock, seq));
+
+        check(y == (x * 2));
+        nr_reads++;
+    }
+
+    return (void *)nr_reads;
+}
+
+static void
+test_seqlocks(void)
+{
+    pthread_t threads[TEST_NR_THREADS];
+    struct seqlock_stats stats;
+    unsigned long i;
+    int error;
+
+    printf("seqlock\n");
+
+    test_x = 0;
+    test_y = 0;
+    atomic_init(&test_writer_done, false);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL,
+                               test_run_seqlock_reader, NULL);
+        check(!error);
+    }
+
+    for (i = 1; i <= TEST_NR_LOOPS; i++) {
+        seqlock_write_lock(&test_seqlock);
+        WRITE_ONCE(test_x, i);
+        WRITE_ONCE(test_y, i * 2);
+        seqlock_write_unlock(&test_seqlock);
+    }
+
+    atomic_store(&test_writer_done, true);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    seqlock_get_stats(&test_seqlock, &stats);
+    printf("read retries: %lu\n", stats.nr_read_retries);
+}
+
+int
+main(void)
+{
+    test_trylock();
+    test_threads("spinlock", test_run_spinlock);
+    test_threads("ticketlock", test_run_ticketlock);
+    test_threads("mcslock", test_run_mcslock);
+    test_seqlocks();
+    return EXIT_SUCCESS;
+}
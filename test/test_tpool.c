@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <macros.h>
+#include <tpool.h>
+
+#define TEST_FIB_N          27
+#define TEST_FIB_CUTOFF     12
+#define TEST_NR_ELEMS       (1 << 20)
+#define TEST_SUM_CUTOFF     1024
+#define TEST_NR_SUBMITTERS  4
+#define TEST_NR_SUBMITS     1000
+
+static struct tpool test_pool;
+
+struct test_fib {
+    struct tpool_task task;
+    unsigned int n;
+    unsigned long result;
+};
+
+static unsigned long
+test_fib_serial(unsigned int n)
+{
+    return (n < 2) ? n : test_fib_serial(n - 1) + test_fib_serial(n - 2);
+}
+
+static void
+test_fib_run(struct tpool_task *task)
+{
+    struct test_fib *fib, child;
+    unsigned long result;
+
+    fib = structof(task, struct test_fib, task);
+
+    if (fib->n < TEST_FIB_CUTOFF) {
+        fib->result = test_fib_serial(fib->n);
+        return;
+    }
+
+    tpool_task_init(&child.task, test_fib_run);
+    child.n = fib->n - 1;
+    tpool_fork(&test_pool, &child.task);
+
+    fib->n -= 2;
+    test_fib_run(&fib->task);
+    result = fib->result;
+
+    tpool_join(&test_pool, &child.task);
+    fib->result = result + child.result;
+}
+
+static void
+test_fib(void)
+{
+    struct test_fib fib;
+
+    printf("fib\n");
+
+    tpool_task_init(&fib.task, test_fib_run);
+    fib.n = TEST_FIB_N;
+    tpool_fork(&test_pool, &fib.task);
+    tpool_join(&test_pool, &fib.task);
+    check(fib.result == test_fib_serial(TEST_FIB_N));
+}
+
+static unsigned int test_elems[TEST_NR_ELEMS];
+
+struct test_sum {
+    struct tpool_task task;
+    const unsigned int *elems;
+    size_t nr_elems;
+    unsigned long long result;
+};
+
+static void
+test_sum_run(struct tpool_task *task)
+{
+    struct test_sum *sum, left, right;
+    size_t i;
+
+    sum = structof(task, struct test_sum, task);
+
+    if (sum->nr_elems <= TEST_SUM_CUTOFF) {
+        sum->result = 0;
+
+        for (i = 0; i < sum->nr_elems; i++) {
+            sum->result += sum->elems[i];
+        }
+
+        return;
+    }
+
+    tpool_task_init(&left.task, test_sum_run);
+    left.elems = sum->elems;
+    left.nr_elems = sum->nr_elems / 2;
+    tpool_task_init(&right.task, test_sum_run);
+    right.elems = sum->elems + left.nr_elems;
+    right.nr_elems = sum->nr_elems - left.nr_elems;
+
+    tpool_fork(&test_pool, &left.task);
+    tpool_fork(&test_pool, &right.task);
+    tpool_join(&test_pool, &right.task);
+    tpool_join(&test_pool, &left.task);
+
+    sum->result = left.result + right.result;
+}
+
+static void
+test_sum(void)
+{
+    unsigned long long expected;
+    struct test_sum sum;
+    size_t i;
+
+    printf("sum\n");
+
+    expected = 0;
+
+    for (i = 0; i < ARRAY_SIZE(test_elems); i++) {
+        test_elems[i] = rand();
+        expected += test_elems[i];
+    }
+
+    tpool_task_init(&sum.task, test_sum_run);
+    sum.elems = test_elems;
+    sum.nr_elems = ARRAY_SIZE(test_elems);
+    tpool_fork(&test_pool, &sum.task);
+    tpool_join(&test_pool, &sum.task);
+    check(sum.result == expected);
+}
+
+struct test_inc {
+    struct tpool_task task;
+    atomic_ulong *counter;
+};
+
+static void
+test_inc_run(struct tpool_task *task)
+{
+    struct test_inc *inc;
+
+    inc = structof(task, struct test_inc, task);
+    atomic_fetch_add(inc->counter, 1);
+}
+
+static void *
+test_submit(void *arg)
+{
+    struct test_inc incs[16];
+    unsigned int i, j;
+
+    for (i = 0; i < TEST_NR_SUBMITS; i++) {
+        for (j = 0; j < ARRAY_SIZE(incs); j++) {
+            tpool_task_init(&incs[j].task, test_inc_run);
+            incs[j].counter = arg;
+            tpool_fork(&test_pool, &incs[j].task);
+        }
+
+        for (j = 0; j < ARRAY_SIZE(incs); j++) {
+            tpool_join(&test_pool, &incs[j].task);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_submitters(void)
+{
+    pthread_t threads[TEST_NR_SUBMITTERS];
+    atomic_ulong counter;
+    unsigned int i;
+    int error;
+
+    printf("submitters\n");
+
+    atomic_init(&counter, 0);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_create(&threads[i], NULL, test_submit, &counter);
+        check(!error);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        error = pthread_join(threads[i], NULL);
+        check(!error);
+    }
+
+    check(atomic_load(&counter) == (TEST_NR_SUBMITTERS * TEST_NR_SUBMITS * 16));
+}
+
+static void
+test_run(unsigned int nr_workers, int flags)
+{
+    int error;
+
+    error = tpool_init(&test_pool, nr_workers, flags);
+    check(!error);
+    check(tpool_nr_workers(&test_pool) != 0);
+    printf("workers: %u, flags: %x\n", tpool_nr_workers(&test_pool), flags);
+
+    test_fib();
+    test_sum();
+    test_submitters();
+
+    tpool_destroy(&test_pool);
+}
+
+int
+main(void)
+{
+    test_run(1, 0);
+    test_run(0, TPOOL_AFFINITY);
+    test_run(8, 0);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <list.h>
+#include <macros.h>
+#include <twheel.h>
+
+#define TEST_NR_TIMERS  4096
+#define TEST_NR_LOOPS   200000
+
+struct test_timer {
+    struct twheel_timer timer;
+    uint64_t deadline;
+    bool armed;
+};
+
+static struct test_timer test_timers[TEST_NR_TIMERS];
+
+static uint64_t
+test_rand64(void)
+{
+    return ((uint64_t)rand() << 31) ^ rand();
+}
+
+/*
+ * Return a random delay, of any order of magnitude.
+ */
+static uint64_t
+test_rand_delay(void)
+{
+    return test_rand64() & ((1ULL << (rand() % 48)) - 1);
+}
+
+static void
+test_arm(struct twheel *wheel, struct test_timer *timer)
+{
+    uint64_t now, expires;
+
+    now = twheel_now(wheel);
+
+    if ((now >= 100) && ((rand() % 16) == 0)) {
+        expires = now - (rand() % 100);
+    } else {
+        expires = now + test_rand_delay();
+    }
+
+    twheel_arm(wheel, &timer->timer, expires);
+    check(twheel_timer_expires(&timer->timer) == expires);
+
+    /* Expiration can't be earlier than the current time */
+    timer->deadline = (expires < now) ? now : expires;
+    timer->armed = true;
+}
+
+static void
+test_advance(struct twheel *wheel, uint64_t now)
+{
+    struct twheel_timer *timer, *tmp;
+    struct test_timer *test_timer;
+    uint64_t prev_deadline, ticks;
+    struct list expired;
+    size_t i;
+
+    if (twheel_next_event(wheel, &ticks)) {
+        for (i = 0; i < ARRAY_SIZE(test_timers); i++) {
+            if (test_timers[i].armed) {
+                check(test_timers[i].deadline >= ticks);
+            }
+        }
+    }
+
+    list_init(&expired);
+    twheel_advance(wheel, now, &expired);
+    check(twheel_now(wheel) == now);
+
+    prev_deadline = 0;
+
+    list_for_each_entry_safe(&expired, timer, tmp, node) {
+        test_timer = twheel_entry(timer, struct test_timer, timer);
+        check(test_timer->armed);
+        check(test_timer->deadline <= now);
+        check(test_timer->deadline >= prev_deadline);
+        prev_deadline = test_timer->deadline;
+        test_timer->armed = false;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(test_timers); i++) {
+        if (test_timers[i].armed) {
+            check(test_timers[i].deadline > now);
+        }
+    }
+}
+
+static void
+test_run(uint64_t start)
+{
+    struct test_timer *timer;
+    struct twheel *wheel;
+    unsigned long i;
+    uint64_t now;
+
+    printf("start: %llu\n", (unsigned long long)start);
+
+    wheel = malloc(sizeof(*wheel));
+    check(wheel != NULL);
+    twheel_init(wheel, start);
+    check(!twheel_next_event(wheel, &now));
+
+    now = start;
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        timer = &test_timers[rand() % ARRAY_SIZE(test_timers)];
+
+        if (!timer->armed) {
+            test_arm(wheel, timer);
+        } else if ((rand() % 4) == 0) {
+            twheel_cancel(wheel, &timer->timer);
+            timer->armed = false;
+        }
+
+        if ((i % 64) == 0) {
+            now += ((rand() % 8) == 0)
+                   ? test_rand_delay()
+                   : (uint64_t)(rand() % 256);
+            test_advance(wheel, now);
+        }
+    }
+
+    test_advance(wheel, now + (1ULL << 48));
+
+    for (i = 0; i < ARRAY_SIZE(test_timers); i++) {
+        check(!test_timers[i].armed);
+    }
+
+    check(!twheel_next_event(wheel, &now));
+    free(wheel);
+}
+
+int
+main(void)
+{
+    test_run(0);
+    test_run(12345);
+    test_run((1ULL << 63) - 12345);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 Richard Braun.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+#include <macros.h>
+#include <ulist.h>
+
+#define TEST_NR_OBJS        10000
+#define TEST_NR_LOOPS       100
+
+static unsigned int test_objs[TEST_NR_OBJS];
+
+/*
+ * Reference array of the pointers expected in the list, in order.
+ */
+static unsigned int *test_ref[TEST_NR_OBJS];
+static size_t test_ref_size;
+
+static void
+test_check(struct ulist *ulist)
+{
+    struct ulist_iter iter;
+    unsigned int *ptr;
+    size_t i;
+
+    check(ulist_size(ulist) == test_ref_size);
+    check(ulist_empty(ulist) == (test_ref_size == 0));
+
+    i = 0;
+
+    ulist_for_each(ulist, &iter, ptr) {
+        check(i < test_ref_size);
+        check(ptr == test_ref[i]);
+        check(ulist_iter_get(&iter) == ptr);
+        i++;
+    }
+
+    check(i == test_ref_size);
+    check(ulist_iter_get(&iter) == NULL);
+}
+
+static void
+test_append(struct ulist *ulist, unsigned int nr_objs)
+{
+    unsigned int i;
+    int error;
+
+    for (i = 0; (i < nr_objs) && (test_ref_size < TEST_NR_OBJS); i++) {
+        test_ref[test_ref_size] = &test_objs[rand() % TEST_NR_OBJS];
+        error = ulist_append(ulist, test_ref[test_ref_size]);
+        check(!error);
+        test_ref_size++;
+    }
+}
+
+/*
+ * Remove pointers at random, keeping the reference array in sync.
+ */
+static void
+test_remove(struct ulist *ulist, unsigned int ratio)
+{
+    struct ulist_iter iter;
+    size_t i, j;
+    void *ptr;
+
+    ptr = ulist_iter_first(ulist, &iter);
+    i = 0;
+    j = 0;
+
+    while (ptr != NULL) {
+        check(ptr == test_ref[i]);
+
+        if (((unsigned int)rand() % 100) < ratio) {
+            ptr = ulist_remove(&iter);
+        } else {
+            test_ref[j] = test_ref[i];
+            j++;
+            ptr = ulist_iter_next(&iter);
+        }
+
+        i++;
+    }
+
+    check(i == test_ref_size);
+    test_ref_size = j;
+}
+
+int
+main(void)
+{
+    struct ulist ulist;
+    unsigned int i;
+
+    ulist_init(&ulist);
+    test_check(&ulist);
+
+    test_append(&ulist, 1);
+    test_check(&ulist);
+    test_remove(&ulist, 100);
+    test_check(&ulist);
+
+    for (i = 0; i < TEST_NR_LOOPS; i++) {
+        test_append(&ulist, rand() % 1000);
+        test_check(&ulist);
+        test_remove(&ulist, rand() % 101);
+        test_check(&ulist);
+    }
+
+    printf("size: %zu\n", ulist_size(&ulist));
+
+    ulist_remove_all(&ulist);
+    test_ref_size = 0;
+    test_check(&ulist);
+
+    return EXIT_SUCCESS;
+}